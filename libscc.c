@@ -0,0 +1,3662 @@
+/*
+@(#)File:           $RCSfile: libscc.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/16 23:20:00 $
+@(#)Purpose:        Strip C comments - scanner library
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 1991-2022,2026
+*/
+
+/*TABSTOP=4*/
+
+/*
+**  The SCC processor removes any C comments and replaces them by a
+**  single space.  It will be used as part of a formatting pipeline
+**  for checking the equivalence of C code.
+**
+**  If the code won't compile, it is unwise to use this tool to modify
+**  it.  It assumes that the code is syntactically correct.
+**
+**  Note that backslashes at the end of a line can extend even a C++
+**  style comment over several lines.  It matters not whether there is
+**  one backslash or several -- the line splicing (logically) takes
+**  place before any other tokenisation.
+**
+**  The -s option was added to simplify the analysis of C++ keywords.
+**  After stripping comments, keywords appearing in (double quoted)
+**  strings should be ignored too, so a replacement character such as X
+**  works.  Without that, the command has to recognize C comments to
+**  know whether the unmatched quotes in them matter (they shouldn't).
+**  The -q option was added for symmetry with -s.
+**
+**  Digraphs do not present a problem; the characters they represent do
+**  not need special handling.  Trigraphs do present a problem in theory
+**  because ??/ is an encoding for backslash.  However, this program
+**  ignores trigraphs altogether - calling upon GCC for precedent, and
+**  noting that C++14 has deprecated trigraphs.  The JLSS programs
+**  digraphs and trigraphs can manipulate (encode, decode) digraphs and
+**  trigraphs.  This more of a theoretical problem than a practical one.
+**
+**  C++14 adds quotes inside numeric literals: 10'000'000 for 10000000,
+**  10'000 for 10000, etc.  Unfortunately, that means SCC has to
+**  recognize literal values fully, because these can appear in hex too:
+**  0xFFFF'ABCD.  C++14 also adds binary constants: 0b0001'1010 (b or
+**  B).  (See N3797 for draft C++14 standard.)
+**
+**  C++11 raw strings are another problem: R"x(...)x" is not bound to
+**  have a close quote by end of line.  (The parentheses are mandatory;
+**  the x's are optional and are not limited to a single character (but
+**  must not be more than 16 characters long), but must match.  The
+**  replacable portion (for -s) is the '...' in between parentheses.)
+**  C++11 also has encoding prefixes u8, u, U, L which can preceded the
+**  R of a R string.  Note that within a raw string, there are no
+**  trigraphs.
+**
+**  Hence we add -S <std> for standards C++98, C++03, C++11, C++14,
+**  C++17, C89, C90, C99, C11, C18.  For the purposes of this code,
+**  C++98 and C++03 are identical, C89 and C90 are identical, and C99,
+**  C11 and C18 are identical.  The default is C18.
+**
+**  C11 and C++11 add support for u"literal", U"literal", u8"literal",
+**  and for u'char' and U'char' (but not u8'char').  Previously, the
+**  code needed no special handling for wide character strings L"x" or
+**  constants L'x', but now they have to be handled appropriately.
+**
+**  Note that comment stripping does not require 100% accurate
+**  tokenization.  For example, C++11 and later supports user-defined
+**  literals such as 1.234_km; it does not matter that SCC treats that
+**  as a number and an identifier, but a program that formally tokenizes
+**  C++ must recognize them.
+*/
+
+#include "posixver.h"
+#include "libscc.h"
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sccskip.h"
+
+/*
+** Lexical state between steps of the scan.  A string literal or
+** character constant (InQuote) or a raw string (InRaw) can be left
+** open at the end of the data scanned so far, like a comment.
+*/
+typedef enum { NonComment, CComment, CppComment, InQuote, InRaw } Comment;
+
+/* The digits of a number left at the end of the data so far (hold_number()) */
+typedef enum { NUM_NONE, NUM_DECIMAL, NUM_HEX, NUM_BINARY, NUM_OCTAL, NUM_EXPONENT } NumPart;
+
+/*
+** Character classification for the lexer, independent of the locale
+** (and cheaper than <ctype.h>, which is only used for option names).
+** The table is indexed by the character plus one, so that EOF (-1) can
+** be classified too - as nothing.
+*/
+enum
+{
+    CC_IDENT  = 0x01,       /* Letter, digit or underscore */
+    CC_ALPHA  = 0x02,       /* Letter */
+    CC_DIGIT  = 0x04,       /* Decimal digit */
+    CC_XDIGIT = 0x08,       /* Hexadecimal digit */
+    CC_OCTAL  = 0x10,       /* Octal digit */
+    CC_BINARY = 0x20,       /* Binary digit */
+    CC_BLANK  = 0x40,       /* Space or tab */
+};
+
+#define CC_BIN  (CC_IDENT | CC_DIGIT | CC_XDIGIT | CC_OCTAL | CC_BINARY)
+#define CC_OCT  (CC_IDENT | CC_DIGIT | CC_XDIGIT | CC_OCTAL)
+#define CC_DEC  (CC_IDENT | CC_DIGIT | CC_XDIGIT)
+#define CC_HEX  (CC_IDENT | CC_ALPHA | CC_XDIGIT)
+#define CC_LET  (CC_IDENT | CC_ALPHA)
+
+static const unsigned char char_class[UCHAR_MAX + 2] =
+{
+    [1 + ' '] = CC_BLANK, [1 + '\t'] = CC_BLANK,
+    [1 + '_'] = CC_IDENT,
+    [1 + '0'] = CC_BIN, [1 + '1'] = CC_BIN,
+    [1 + '2'] = CC_OCT, [1 + '3'] = CC_OCT, [1 + '4'] = CC_OCT, [1 + '5'] = CC_OCT,
+    [1 + '6'] = CC_OCT, [1 + '7'] = CC_OCT,
+    [1 + '8'] = CC_DEC, [1 + '9'] = CC_DEC,
+    [1 + 'a'] = CC_HEX, [1 + 'b'] = CC_HEX, [1 + 'c'] = CC_HEX,
+    [1 + 'd'] = CC_HEX, [1 + 'e'] = CC_HEX, [1 + 'f'] = CC_HEX,
+    [1 + 'A'] = CC_HEX, [1 + 'B'] = CC_HEX, [1 + 'C'] = CC_HEX,
+    [1 + 'D'] = CC_HEX, [1 + 'E'] = CC_HEX, [1 + 'F'] = CC_HEX,
+    [1 + 'g'] = CC_LET, [1 + 'h'] = CC_LET, [1 + 'i'] = CC_LET, [1 + 'j'] = CC_LET, [1 + 'k'] = CC_LET,
+    [1 + 'l'] = CC_LET, [1 + 'm'] = CC_LET, [1 + 'n'] = CC_LET, [1 + 'o'] = CC_LET, [1 + 'p'] = CC_LET,
+    [1 + 'q'] = CC_LET, [1 + 'r'] = CC_LET, [1 + 's'] = CC_LET, [1 + 't'] = CC_LET, [1 + 'u'] = CC_LET,
+    [1 + 'v'] = CC_LET, [1 + 'w'] = CC_LET, [1 + 'x'] = CC_LET, [1 + 'y'] = CC_LET, [1 + 'z'] = CC_LET,
+    [1 + 'G'] = CC_LET, [1 + 'H'] = CC_LET, [1 + 'I'] = CC_LET, [1 + 'J'] = CC_LET, [1 + 'K'] = CC_LET,
+    [1 + 'L'] = CC_LET, [1 + 'M'] = CC_LET, [1 + 'N'] = CC_LET, [1 + 'O'] = CC_LET, [1 + 'P'] = CC_LET,
+    [1 + 'Q'] = CC_LET, [1 + 'R'] = CC_LET, [1 + 'S'] = CC_LET, [1 + 'T'] = CC_LET, [1 + 'U'] = CC_LET,
+    [1 + 'V'] = CC_LET, [1 + 'W'] = CC_LET, [1 + 'X'] = CC_LET, [1 + 'Y'] = CC_LET, [1 + 'Z'] = CC_LET,
+};
+
+static inline bool char_is(int c, unsigned cls)
+{
+    assert(c == EOF || (c >= 0 && c <= UCHAR_MAX));
+    return (char_class[c + 1] & cls) != 0;
+}
+
+static inline bool is_idchar(int c)  { return char_is(c, CC_IDENT); }
+static inline bool is_alpha(int c)   { return char_is(c, CC_ALPHA); }
+static inline bool is_digit(int c)   { return char_is(c, CC_DIGIT); }
+static inline bool is_xdigit(int c)  { return char_is(c, CC_XDIGIT); }
+static inline bool is_octal(int c)   { return char_is(c, CC_OCTAL); }
+static inline bool is_binary(int c)  { return char_is(c, CC_BINARY); }
+static inline bool is_blank(int c)   { return char_is(c, CC_BLANK); }
+
+/*
+** The input is held in memory - either the caller's buffer or the
+** stream buffer - so getch() and peek() are simple index operations.
+** When streaming, len is normally the end of the last complete line
+** received (see scc_stream_write()).
+*/
+typedef struct Source
+{
+    const char *base;       /* Start of input data */
+    size_t      len;        /* Number of bytes of input data */
+    size_t      pos;        /* Offset of next byte to be read */
+    size_t      lpos;       /* Offset at which line number was last computed */
+    int         lline;      /* Line number at offset lpos */
+    size_t      origin;     /* Offset of base in the whole input (streaming) */
+    bool        final;      /* No more data will follow len */
+    bool        careful;    /* Check that each step fits before len (step_fits()) */
+    bool        starved;    /* Tried to read at len before the end of the input */
+    bool        stalled;    /* Token at pos needs data beyond len */
+} Source;
+
+typedef enum
+{
+    C, C89, C90, C94, C99, C11, C18,
+    CXX, CXX98, CXX03, CXX11, CXX14, CXX17
+} Standard;
+
+enum { MAX_RAW_MARKER = 16 };
+enum { LPAREN = '(', RPAREN = ')' };
+enum { OUT_IOV_MAX = 64 };              /* Iovecs passed to sink at once */
+enum { ZC_MIN = 1024 };                 /* Shortest run of input passed by reference */
+enum { MAP_LOOKBACK = MAX_RAW_MARKER + 4 };  /* Input searched for a character (map_putc()) */
+
+static const char std_name[][6] =
+{
+    [C]     = "C",      // Current C standard (C18)
+    [CXX]   = "C++",    // Current C++ standard (C++17)
+    [C89]   = "C89",
+    [C90]   = "C90",
+    [C94]   = "C94",
+    [C99]   = "C99",
+    [C11]   = "C11",
+    [C18]   = "C18",
+    [CXX98] = "C++98",
+    [CXX03] = "C++03",
+    [CXX11] = "C++11",
+    [CXX14] = "C++14",
+    [CXX17] = "C++17",
+};
+enum { NUM_STDNAMES = sizeof(std_name) / sizeof(std_name[0]) };
+
+enum Feature { F_HEXFLOAT, F_RAWSTRING, F_DOUBLESLASH, F_UNICODE, F_BINARY, F_NUMPUNCT, F_UNIVERSAL };
+static const char *feature_name[] =
+{
+    [F_HEXFLOAT]    = "Hexadecimal floating point constant",
+    [F_RAWSTRING]   = "Raw string",
+    [F_DOUBLESLASH] = "Double slash comment",
+    [F_UNICODE]     = "Unicode character or string",
+    [F_BINARY]      = "Binary literal",
+    [F_NUMPUNCT]    = "Numeric punctuation",
+    [F_UNIVERSAL]   = "Universal character name",
+};
+
+static const char * const dq_reg_prefix[] = { "L", "u", "U", "u8", };
+static const char * const dq_raw_prefix[] = { "R", "LR", "uR", "UR", "u8R" };
+enum { NUM_DQ_REG_PREFIX = sizeof(dq_reg_prefix) / sizeof(dq_reg_prefix[0]) };
+enum { NUM_DQ_RAW_PREFIX = sizeof(dq_raw_prefix) / sizeof(dq_raw_prefix[0]) };
+
+/*
+** The distinct sets of features recognized by the standards.  The lexer
+** is specialized for each of them (see LEX_INSTANCE).
+*/
+#define FEATURE_SETS(X) \
+    X(C89,   0) \
+    X(C99,   SCC_F_HEXFLOAT | SCC_F_UNIVERSAL | SCC_F_DOUBLESLASH) \
+    X(C11,   SCC_F_HEXFLOAT | SCC_F_UNIVERSAL | SCC_F_DOUBLESLASH | SCC_F_UNICODE) \
+    X(CXX98, SCC_F_UNIVERSAL | SCC_F_DOUBLESLASH) \
+    X(CXX11, SCC_F_UNIVERSAL | SCC_F_DOUBLESLASH | SCC_F_RAWSTRING | SCC_F_UNICODE) \
+    X(CXX14, SCC_F_UNIVERSAL | SCC_F_DOUBLESLASH | SCC_F_RAWSTRING | SCC_F_UNICODE | \
+             SCC_F_BINARY | SCC_F_NUMPUNCT) \
+    X(CXX17, SCC_F_UNIVERSAL | SCC_F_DOUBLESLASH | SCC_F_RAWSTRING | SCC_F_UNICODE | \
+             SCC_F_BINARY | SCC_F_NUMPUNCT | SCC_F_HEXFLOAT)
+
+typedef enum
+{
+#define FS_ENUM(name, features) FS_##name,
+    FEATURE_SETS(FS_ENUM)
+#undef FS_ENUM
+} FeatureSet;
+
+static const unsigned char std_feature_set[] =
+{
+    [C]     = FS_C11,   // Current C standard (C18)
+    [CXX]   = FS_CXX17, // Current C++ standard (C++17)
+    [C89]   = FS_C89,
+    [C90]   = FS_C89,
+    [C94]   = FS_C89,
+    [C99]   = FS_C99,
+    [C11]   = FS_C11,
+    [C18]   = FS_C11,
+    [CXX98] = FS_CXX98,
+    [CXX03] = FS_CXX98,
+    [CXX11] = FS_CXX11,
+    [CXX14] = FS_CXX14,
+    [CXX17] = FS_CXX17,
+};
+
+/*
+** The lexer functions that depend on the features take them as their
+** last argument and are always inlined, down to one instance of
+** lex_buffer(sc, features) for each feature set, where the features
+** are a constant.
+*/
+#if defined(__GNUC__)
+#define LEX_INLINE  static inline __attribute__((always_inline))
+#else
+#define LEX_INLINE  static inline
+#endif /* __GNUC__ */
+
+/*
+** Everything a scan needs: the options, the features of the selected
+** standard, the input and output buffers and the lexical state.  There
+** is no file-scope mutable state in the library, so separate scanners
+** can process separate inputs at the same time (on separate threads).
+*/
+typedef struct Scanner
+{
+    SCC_Options opt;
+    unsigned    features;       /* Features recognized (SCC_F_*) */
+    void      (*scan)(struct Scanner *sc);  /* scan_buffer(sc) for the features */
+    /* Input */
+    const char *fn;             /* Name of current input */
+    Source      src;            /* Contents of current input */
+    char       *sbuf;           /* Stream buffer */
+    size_t      sbuf_len;
+    size_t      sbuf_size;
+    size_t      sbuf_line;      /* Unscanned data that is scanned without a line end */
+    size_t      sbuf_wait;      /* Unscanned data needed before trying again */
+    /* Lexical state */
+    Comment     state;          /* Comment status at src.pos */
+    int         oc;             /* Character before src.pos */
+    int         l_nest;         /* Last line with a nested comment warning */
+    int         l_cend;         /* Last line with a comment end warning */
+    bool        l_comment;      /* Line contained a comment - print newline in -c mode */
+    bool        in_ident;       /* Data scanned so far ends in an identifier */
+    bool        after_number;   /* Last token was a number (1 of 1.5) */
+    char        quote;          /* Quote of open literal (InQuote) */
+    const char *quote_msg;      /* Description of open literal (InQuote) */
+    bool        bs_odd;         /* Odd number of backslashes written before src.pos (InQuote) */
+    char        bsnl_char;      /* Slash or star before backslash-newlines at src.pos, or 0 */
+    size_t      bsnl_held;      /* Backslash-newlines read between it and src.pos */
+    NumPart     num_part;       /* Part of a number that continues at src.pos */
+    int         num_oc;         /* Last character of that number */
+    bool        num_warned;     /* Hexadecimal floating point warned about in it */
+    int         raw_line;       /* Line where open raw string started (InRaw) */
+    int         raw_marklen;
+    char        raw_mark[MAX_RAW_MARKER + 2];   /* Delimiter of open raw string (InRaw) */
+    /* Output */
+    SCC_Sink    sink;
+    struct Scanner *comments;   /* Output of the comments as well, or null (see below) */
+    int         error;          /* Error number (errno) of first failure */
+    bool        dry;            /* Suppress output and warnings (step_fits()) */
+    size_t      whisp_held;     /* Pending white space at the end of the output */
+    char       *whisp;          /* Pending white space set aside from the output */
+    size_t      whisp_size;
+    size_t      whisp_off;
+    size_t      whisp_max;      /* Spill white space beyond this to whisp_fp, or 0 */
+    FILE       *whisp_fp;
+    size_t      whisp_spilt;    /* White space in whisp_fp, preceding whisp */
+    bool        whisp_entry;    /* Unknown white space precedes whisp (chunk scan) */
+    size_t      whisp_at;       /* Where it was written, or WHISP_PENDING or WHISP_CLEARED */
+    size_t      whisp_diag;     /* Warnings issued before it was written */
+    size_t      in_total;       /* Bytes of input */
+    char        in_last;        /* Last byte of input */
+    size_t      out_total;      /* Bytes passed to sink */
+    /* Source map (sink.map) */
+    bool        map_any;        /* A point has been reported */
+    size_t      map_delta;      /* Input offset less output offset at the last point */
+    size_t      map_next;       /* Input offset following the last character mapped */
+    int         map_out_line;   /* Output line at out_count(sc) */
+    size_t      map_out_bol;    /* Output offset of the start of map_out_line */
+    size_t      map_in_pos;     /* Input offset at which map_in_line was computed */
+    int         map_in_line;
+    size_t      map_in_bol;     /* Input offset of the start of map_in_line */
+    size_t      map_clean_from; /* Input offsets of a stretch with no line end, */
+    size_t      map_clean_to;   /* which may end at one (map_continues()) */
+    size_t      num_diag;       /* Warnings issued */
+    SCC_Stats   stats;
+    const char *zc_limit;       /* End of input that can be passed by reference, or null */
+    const char *zc_start;       /* Output identical to input zc_start..zc_end-1 */
+    const char *zc_end;
+    int         iov_cnt;        /* Output described by iovecs, not yet sent */
+    size_t      iov_len;
+    size_t      obuffer_mark;   /* Start of obuffer not yet described by an iovec */
+    struct iovec iov[OUT_IOV_MAX];
+    size_t      obuffer_len;
+    char        obuffer[64 * 1024];
+} Scanner;
+
+enum { WHISP_PENDING = -1, WHISP_CLEARED = -2 };
+enum { WHISP_HOLD = 16 * 1024 };        /* Pending white space kept in the output */
+enum { WHISP_MAX = 64 * 1024 };         /* White space held in memory (streaming) */
+enum { STREAM_SLICE = 64 * 1024 };      /* Input appended to stream buffer at once */
+enum { STREAM_LINE_MAX = 256 * 1024 };  /* Unscanned part of line held (streaming) */
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_libscc_c[];
+const char jlss_id_libscc_c[] = "@(#)$Id: libscc.c,v 1.1 2026/10/16 23:20:00 jleffler Exp $";
+#endif /* lint */
+
+/*
+** Output is accumulated in sc->obuffer and passed to the sink in large
+** blocks; runs of unchanged source are copied in with memcpy() rather
+** than one character at a time.  After the sink fails, output is
+** discarded.
+**
+** If the sink has a writev function and the input stays in place for
+** the whole scan (scc_strip() and scc_strip_parallel()), the output is
+** not copied while it is identical to the input: sc->zc_start and
+** sc->zc_end track the stretch of input it matches.  When the output
+** diverges, a long stretch is passed to the sink as an iovec pointing
+** into the input, between iovecs describing the contents of obuffer;
+** a short one is copied into obuffer as usual.
+*/
+static void out_send(Scanner *sc, const char *str, size_t len)
+{
+    if (sc->error == 0 && (*sc->sink.write)(sc->sink.data, str, len) != 0)
+        sc->error = (errno != 0) ? errno : EIO;
+    sc->out_total += len;
+}
+
+static void out_iov(Scanner *sc, const char *str, size_t len)
+{
+    sc->iov[sc->iov_cnt++] = (struct iovec){ .iov_base = (void *)str, .iov_len = len };
+    sc->iov_len += len;
+}
+
+static void out_close(Scanner *sc);
+static bool whisp_detach(Scanner *sc);
+static void whisp_attach(Scanner *sc);
+
+static void out_flush(Scanner *sc)
+{
+    /* Pending white space must not reach the sink, since it may be cut */
+    bool held = whisp_detach(sc);
+    if (sc->zc_end != 0)
+        out_close(sc);
+    if (sc->iov_cnt > 0)
+    {
+        if (sc->obuffer_len > sc->obuffer_mark)
+            out_iov(sc, sc->obuffer + sc->obuffer_mark, sc->obuffer_len - sc->obuffer_mark);
+        if (sc->error == 0 && (*sc->sink.writev)(sc->sink.data, sc->iov, sc->iov_cnt) != 0)
+            sc->error = (errno != 0) ? errno : EIO;
+        sc->out_total += sc->iov_len;
+        sc->iov_cnt = 0;
+        sc->iov_len = 0;
+        sc->obuffer_mark = 0;
+        sc->obuffer_len = 0;
+    }
+    else if (sc->obuffer_len > 0)
+    {
+        out_send(sc, sc->obuffer, sc->obuffer_len);
+        sc->obuffer_len = 0;
+    }
+    if (held)
+        whisp_attach(sc);
+}
+
+/* Output so far, whether or not it has been passed to the sink */
+static size_t out_count(const Scanner *sc)
+{
+    size_t count = sc->out_total + sc->iov_len + sc->obuffer_len - sc->obuffer_mark;
+    if (sc->zc_end != 0)
+        count += (size_t)(sc->zc_end - sc->zc_start);
+    return count;
+}
+
+static void out_copy(Scanner *sc, const char *str, size_t len)
+{
+    if (len > sizeof(sc->obuffer) - sc->obuffer_len)
+    {
+        out_flush(sc);
+        if (len > sizeof(sc->obuffer) - sc->obuffer_len)
+        {
+            out_send(sc, str, len);
+            return;
+        }
+    }
+    memcpy(sc->obuffer + sc->obuffer_len, str, len);
+    sc->obuffer_len += len;
+}
+
+/* The output has diverged from the input */
+static void out_close(Scanner *sc)
+{
+    const char *str = sc->zc_start;
+    size_t len = (size_t)(sc->zc_end - sc->zc_start);
+
+    sc->zc_start = sc->zc_end = 0;
+    /* Not flushed here, since the output is not all accounted for */
+    if (len < ZC_MIN && len <= sizeof(sc->obuffer) - sc->obuffer_len)
+    {
+        memcpy(sc->obuffer + sc->obuffer_len, str, len);
+        sc->obuffer_len += len;
+    }
+    else
+    {
+        if (sc->obuffer_len > sc->obuffer_mark)
+            out_iov(sc, sc->obuffer + sc->obuffer_mark, sc->obuffer_len - sc->obuffer_mark);
+        sc->obuffer_mark = sc->obuffer_len;
+        out_iov(sc, str, len);
+        if (sc->iov_cnt >= OUT_IOV_MAX - 1)
+            out_flush(sc);
+    }
+}
+
+/* Extend or start the stretch of input matched by the output */
+static bool out_match(Scanner *sc, const char *str, size_t len)
+{
+    if (sc->zc_end != 0)
+    {
+        if (len <= (size_t)(sc->zc_limit - sc->zc_end) &&
+            (str == sc->zc_end || memcmp(str, sc->zc_end, len) == 0))
+        {
+            sc->zc_end += len;
+            return true;
+        }
+        out_close(sc);
+    }
+    if (str >= sc->src.base && str < sc->zc_limit && len <= (size_t)(sc->zc_limit - str))
+    {
+        sc->zc_start = str;
+        sc->zc_end = str + len;
+        return true;
+    }
+    return false;
+}
+
+static inline void out_putc(Scanner *sc, char c)
+{
+    if (sc->zc_end != 0)
+    {
+        if (sc->zc_end < sc->zc_limit && *sc->zc_end == c)
+        {
+            sc->zc_end++;
+            return;
+        }
+        out_close(sc);
+    }
+    if (sc->obuffer_len >= sizeof(sc->obuffer))
+        out_flush(sc);
+    sc->obuffer[sc->obuffer_len++] = c;
+}
+
+static void out_write(Scanner *sc, const char *str, size_t len)
+{
+    if (sc->zc_limit != 0 && out_match(sc, str, len))
+        return;
+    out_copy(sc, str, len);
+}
+
+/*
+** Remove the last len bytes of output, which must not have been passed
+** to the sink, copying them to save if it is not null.  They are taken
+** from the end of the stretch of input matched, the end of obuffer and
+** the ends of the iovecs, in that order.
+*/
+static void out_cut(Scanner *sc, size_t len, char *save)
+{
+    size_t n;
+
+    if (sc->zc_end != 0)
+    {
+        n = (size_t)(sc->zc_end - sc->zc_start);
+        n = (len < n) ? len : n;
+        sc->zc_end -= n;
+        len -= n;
+        if (save != 0)
+            memcpy(save + len, sc->zc_end, n);
+        if (sc->zc_end == sc->zc_start)
+            sc->zc_start = sc->zc_end = 0;
+    }
+    n = sc->obuffer_len - sc->obuffer_mark;
+    n = (len < n) ? len : n;
+    sc->obuffer_len -= n;
+    len -= n;
+    if (save != 0)
+        memcpy(save + len, sc->obuffer + sc->obuffer_len, n);
+    while (len > 0 && sc->iov_cnt > 0)
+    {
+        struct iovec *iov = &sc->iov[sc->iov_cnt - 1];
+        char *base = iov->iov_base;
+        n = (len < iov->iov_len) ? len : iov->iov_len;
+        iov->iov_len -= n;
+        sc->iov_len -= n;
+        len -= n;
+        if (save != 0)
+            memcpy(save + len, base + iov->iov_len, n);
+        if (base >= sc->obuffer && base < sc->obuffer + sizeof(sc->obuffer))
+            sc->obuffer_len = sc->obuffer_mark = (size_t)(base + iov->iov_len - sc->obuffer);
+        if (iov->iov_len == 0)
+            sc->iov_cnt--;
+    }
+}
+
+/*
+** Source map (sink.map).  A point is reported wherever the output stops
+** following the input character for character: where the offset in
+** the input of an output character, less its offset in the output,
+** differs from that at the previous point.  Only characters other than
+** blanks are checked, since white space held in sc->whisp has no one
+** origin.  A character written without a known origin is taken to
+** continue the current stretch if it matches the input there and only
+** blanks were passed over since the last character mapped; otherwise
+** it comes from the last place it was read (it may be written after a
+** character or two of lookahead).  Either way, it must be on the line
+** of the last character read, counting backslash-newline as part of a
+** line: when streaming, earlier lines may have been discarded, and the
+** map must not depend on that.  The lines and columns are found by
+** counting the newlines since the previous point.
+*/
+static void map_seek(Scanner *sc, size_t pos)
+{
+    const char *base = sc->src.base;
+    size_t from = sc->map_in_pos - sc->src.origin;
+
+    if (pos >= from)
+    {
+        sc->map_in_line += (int)scc_count_newlines(base + from, base + pos);
+        for (size_t i = pos; i > from; i--)
+        {
+            if (base[i - 1] == '\n')
+            {
+                sc->map_in_bol = sc->src.origin + i;
+                break;
+            }
+        }
+    }
+    else if (sc->src.origin + pos < sc->map_in_bol)
+    {
+        /* Back to an earlier line: back within the line needs no search */
+        sc->map_in_line -= (int)scc_count_newlines(base + pos, base + from);
+        sc->map_in_bol = sc->src.origin;
+        for (size_t i = pos; i > 0; i--)
+        {
+            if (base[i - 1] == '\n')
+            {
+                sc->map_in_bol = sc->src.origin + i;
+                break;
+            }
+        }
+    }
+    sc->map_in_pos = sc->src.origin + pos;
+}
+
+static void map_send(Scanner *sc, size_t out, size_t in)
+{
+    (*sc->sink.map)(sc->sink.data, sc->map_out_line, out - sc->map_out_bol,
+                    sc->map_in_line, in - sc->map_in_bol);
+}
+
+/* The output about to be written comes from src.base[pos] onwards */
+static void map_point(Scanner *sc, size_t pos)
+{
+    size_t out = out_count(sc);
+    size_t in = sc->src.origin + pos;
+    if (sc->map_any && in - out == sc->map_delta)
+        return;
+    sc->map_any = true;
+    sc->map_delta = in - out;
+    map_seek(sc, pos);
+    map_send(sc, out, in);
+}
+
+/* Whether a line ends at the newline src.base[pos], which it does unless escaped */
+static bool map_line_end(const Scanner *sc, size_t pos)
+{
+    return sc->src.base[pos] == '\n' && (pos == 0 || sc->src.base[pos - 1] != '\\');
+}
+
+/*
+** Whether c, without a known origin, continues the current stretch.
+** The input between it and the current position must not hold a line
+** end; that input is a long run when a long token is written after it
+** has been read (a run of backslashes, for example), so the stretch
+** already known to be free of line ends is remembered and only the
+** input beyond it is searched, keeping the search linear overall.
+*/
+static bool map_continues(Scanner *sc, char c)
+{
+    size_t in = out_count(sc) + sc->map_delta;
+    if (!sc->map_any || in < sc->map_next || sc->map_next < sc->src.origin)
+        return false;
+    size_t pos = in - sc->src.origin;
+    if (pos >= sc->src.pos || sc->src.base[pos] != c)
+        return false;
+    size_t i = pos + 1;
+    if (sc->map_clean_from >= sc->src.origin && sc->map_clean_from <= in + 1 &&
+        in + 1 <= sc->map_clean_to)
+        i = sc->map_clean_to - sc->src.origin;
+    else
+        sc->map_clean_from = in + 1;
+    while (i < sc->src.pos - 1 && !map_line_end(sc, i))
+        i++;
+    sc->map_clean_to = sc->src.origin + i;
+    if (i < sc->src.pos - 1)
+        return false;
+    for (size_t i = sc->map_next - sc->src.origin; i < pos; i++)
+    {
+        if (!is_blank((unsigned char)sc->src.base[i]))
+            return false;
+    }
+    return true;
+}
+
+/* Where c, without a known origin, was read: the last c on the line, nearby */
+static size_t map_lookback(const Scanner *sc, char c)
+{
+    size_t last = (sc->src.pos > 0) ? sc->src.pos - 1 : 0;
+    for (size_t pos = last; last - pos < MAP_LOOKBACK; pos--)
+    {
+        if (sc->src.base[pos] == c)
+            return pos;
+        if (pos == 0 || (pos < last && map_line_end(sc, pos)))
+            break;
+    }
+    return last;
+}
+
+/* Write c, which comes from *at if at is not null */
+static void map_putc(Scanner *sc, char c, const char *at)
+{
+    if (at != 0 && at >= sc->src.base && at < sc->src.base + sc->src.len)
+        map_point(sc, (size_t)(at - sc->src.base));
+    else if (!map_continues(sc, c))
+        map_point(sc, map_lookback(sc, c));
+    out_putc(sc, c);
+    sc->map_next = out_count(sc) + sc->map_delta;
+    if (c == '\n')
+    {
+        sc->map_out_line++;
+        sc->map_out_bol = out_count(sc);
+    }
+}
+
+/* After the last of the output, report the ends of the output and input */
+static void map_end(Scanner *sc)
+{
+    map_seek(sc, sc->src.len);
+    map_send(sc, out_count(sc), sc->src.origin + sc->src.len);
+}
+
+/*
+** White space is pending until the rest of its line shows whether it
+** is trailing.  It is written to the output straight away, with
+** sc->whisp_held counting it, and if a newline follows, the output is
+** cut back to where it started; it is never copied twice.  While
+** it is pending, out_flush() sets it aside in sc->whisp and puts it
+** back.  A run of more than WHISP_HOLD bytes is set aside for good and
+** gathered in sc->whisp; a stream can have a run of any length pending,
+** so beyond sc->whisp_max bytes that is moved to a temporary file (if
+** one can be created) rather than growing sc->whisp.
+*/
+static bool whisp_spill(Scanner *sc)
+{
+    if (sc->whisp_fp == 0 && (sc->whisp_fp = tmpfile()) == 0)
+        return false;
+    if (fwrite(sc->whisp, sizeof(char), sc->whisp_off, sc->whisp_fp) != sc->whisp_off)
+    {
+        rewind(sc->whisp_fp);
+        return false;
+    }
+    sc->whisp_spilt += sc->whisp_off;
+    sc->whisp_off = 0;
+    return true;
+}
+
+/* Make room in sc->whisp for len bytes and a null */
+static bool whisp_reserve(Scanner *sc, size_t len)
+{
+    if (len < sc->whisp_size)
+        return true;
+    void *new_whisp = realloc(sc->whisp, len + 1);
+    if (new_whisp == 0)
+    {
+        sc->error = ENOMEM;
+        return false;
+    }
+    sc->whisp = new_whisp;
+    sc->whisp_size = len + 1;
+    return true;
+}
+
+/* Set the pending white space in the output aside in sc->whisp */
+static bool whisp_detach(Scanner *sc)
+{
+    size_t len = sc->whisp_held;
+    if (len == 0)
+        return false;
+    sc->whisp_held = 0;
+    if (!whisp_reserve(sc, len))
+        return false;
+    out_cut(sc, len, sc->whisp);
+    sc->whisp_off = len;
+    return true;
+}
+
+/* Put the white space set aside back in the output, still pending */
+static void whisp_attach(Scanner *sc)
+{
+    sc->whisp_held = sc->whisp_off;
+    out_copy(sc, sc->whisp, sc->whisp_off);
+    sc->whisp_off = 0;
+}
+
+/* Always maintain enough space in sc->whisp for a null to be added */
+static void whisp_push(Scanner *sc, char c)
+{
+    if (sc->whisp == 0 || sc->whisp_off >= sc->whisp_size - 1)
+    {
+        if (sc->whisp_max != 0 && sc->whisp_off >= sc->whisp_max && whisp_spill(sc))
+        {
+            sc->whisp[sc->whisp_off++] = c;
+            return;
+        }
+        /* Once memory has run out, the rest of a run is dropped, not retried byte by byte */
+        if (sc->error != 0)
+            return;
+        size_t new_size = sc->whisp_size * 2 + 2;
+        void *new_whisp = realloc(sc->whisp, new_size);
+        if (new_whisp == 0)
+        {
+            sc->error = ENOMEM;
+            return;
+        }
+        sc->whisp = new_whisp;
+        sc->whisp_size = new_size;
+    }
+    sc->whisp[sc->whisp_off++] = c;
+}
+
+/* Copy the spilt white space to the output, or discard it */
+static void whisp_unspill(Scanner *sc, bool written)
+{
+    rewind(sc->whisp_fp);
+    while (written && sc->whisp_spilt > 0)
+    {
+        char buffer[BUFSIZ];
+        size_t nbytes = (sc->whisp_spilt < sizeof(buffer)) ? sc->whisp_spilt : sizeof(buffer);
+        if (fread(buffer, sizeof(char), nbytes, sc->whisp_fp) != nbytes)
+        {
+            sc->error = (sc->error != 0) ? sc->error : EIO;
+            break;
+        }
+        out_write(sc, buffer, nbytes);
+        sc->whisp_spilt -= nbytes;
+    }
+    rewind(sc->whisp_fp);
+    sc->whisp_spilt = 0;
+}
+
+/*
+** When a chunk of a file is scanned speculatively (scc_strip_parallel),
+** the white space pending from the preceding chunk is unknown; note
+** where it would have been written, or that it would have been
+** discarded, so that it can be accounted for afterwards.
+*/
+static void whisp_resolve_entry(Scanner *sc, bool written)
+{
+    sc->whisp_entry = false;
+    if (!written)
+        sc->whisp_at = (size_t)WHISP_CLEARED;
+    else
+        sc->whisp_at = out_count(sc) - sc->whisp_held;
+    sc->whisp_diag = sc->num_diag;
+}
+
+/* Pending white space is written */
+static void whisp_write(Scanner *sc)
+{
+    if (sc->whisp_entry)
+        whisp_resolve_entry(sc, true);
+    sc->whisp_held = 0;
+    if (sc->whisp_spilt > 0)
+        whisp_unspill(sc, true);
+    if (sc->whisp_off > 0)
+    {
+        out_write(sc, sc->whisp, sc->whisp_off);
+        sc->whisp_off = 0;
+    }
+}
+
+/* Pending white space is discarded */
+static void whisp_clear(Scanner *sc)
+{
+    if (sc->whisp_entry)
+        whisp_resolve_entry(sc, false);
+    if (sc->whisp_held > 0)
+    {
+        out_cut(sc, sc->whisp_held, 0);
+        sc->whisp_held = 0;
+    }
+    if (sc->whisp_spilt > 0)
+        whisp_unspill(sc, false);
+    sc->whisp_off = 0;
+}
+
+/* Add the blanks str[0..len-1] to the pending white space */
+static void whisp_blanks(Scanner *sc, const char *str, size_t len)
+{
+    if (sc->whisp_held + len > WHISP_HOLD)
+        whisp_detach(sc);
+    if (sc->whisp_off > 0 || sc->whisp_spilt > 0 || len > WHISP_HOLD)
+    {
+        for (size_t i = 0; i < len; i++)
+            whisp_push(sc, str[i]);
+        return;
+    }
+    sc->whisp_held += len;
+    out_write(sc, str, len);
+}
+
+/* Put character c, which comes from input *at if at is not null */
+static inline void whisp_putchar(Scanner *sc, char c, const char *at)
+{
+    if (sc->dry)
+        return;
+    if (is_blank((unsigned char)c))
+    {
+        if (sc->whisp_held < WHISP_HOLD && sc->whisp_off == 0 && sc->whisp_spilt == 0)
+        {
+            sc->whisp_held++;
+            out_putc(sc, c);
+        }
+        else
+            whisp_blanks(sc, &c, 1);
+    }
+    else
+    {
+        if (sc->opt.tflag || c != '\n')
+            whisp_write(sc);
+        else if (c == '\n')
+            whisp_clear(sc);
+        if (sc->sink.map != 0)
+            map_putc(sc, c, at);
+        else
+            out_putc(sc, c);
+    }
+}
+
+/*
+** Equivalent to calling whisp_putchar(sc) for each character in turn,
+** but copies everything up to the last non-blank on each line as a
+** single block.
+*/
+static void whisp_putspan(Scanner *sc, const char *str, size_t len)
+{
+    if (sc->dry)
+        return;
+    /* Otherwise a replacement for the body of a literal */
+    bool in_src = (str >= sc->src.base && str < sc->src.base + sc->src.len);
+    while (len > 0)
+    {
+        const char *nl = memchr(str, '\n', len);
+        size_t seg = (nl != 0) ? (size_t)(nl - str) : len;
+        size_t end = seg;
+        while (end > 0 && is_blank((unsigned char)str[end - 1]))
+            end--;
+        if (end > 0)
+        {
+            whisp_write(sc);
+            if (sc->sink.map != 0 && in_src)
+                map_point(sc, (size_t)(str - sc->src.base));
+            out_write(sc, str, end);
+            if (sc->sink.map != 0)
+                sc->map_next = out_count(sc) + sc->map_delta;
+        }
+        if (end < seg)
+            whisp_blanks(sc, str + end, seg - end);
+        if (nl == 0)
+            break;
+        whisp_putchar(sc, '\n', in_src ? nl : 0);
+        str += seg + 1;
+        len -= seg + 1;
+    }
+}
+
+static int getch(Scanner *sc)
+{
+    if (sc->src.pos >= sc->src.len)
+    {
+        if (!sc->src.final)
+            sc->src.starved = true;
+        return(EOF);
+    }
+    return((unsigned char)sc->src.base[sc->src.pos++]);
+}
+
+static int peek(Scanner *sc)
+{
+    if (sc->src.pos >= sc->src.len)
+    {
+        if (!sc->src.final)
+            sc->src.starved = true;
+        return(EOF);
+    }
+    return((unsigned char)sc->src.base[sc->src.pos]);
+}
+
+/*
+** Line number of the next character to be read.  Line numbers are only
+** needed for warnings, so they are not maintained as characters are
+** read; instead, the newlines between the previous enquiry and the
+** current position are counted when needed.
+*/
+static int src_line(Scanner *sc)
+{
+    if (sc->src.pos >= sc->src.lpos)
+        sc->src.lline += scc_count_newlines(sc->src.base + sc->src.lpos, sc->src.base + sc->src.pos);
+    else
+        sc->src.lline -= scc_count_newlines(sc->src.base + sc->src.pos, sc->src.base + sc->src.lpos);
+    sc->src.lpos = sc->src.pos;
+    return sc->src.lline;
+}
+
+/*
+** With a sink for the comments (scc_set_comment_sink()), sc->comments
+** is a second scanner, with the same options and -c, that does no
+** scanning: each character put by sc is put by it too, so its output
+** is what a separate run with -c would produce.  It is not given the
+** characters of a step tried with the output suppressed (step_fits()).
+*/
+static inline Scanner *comment_view(const Scanner *sc)
+{
+    return sc->dry ? 0 : sc->comments;
+}
+
+/* Put source code character, from input *at if at is not null */
+static inline void s_putch_at(Scanner *sc, char c, const char *at)
+{
+    if (!sc->opt.cflag || ((sc->opt.nflag || sc->l_comment) && c == '\n'))
+        whisp_putchar(sc, c, at);
+    if (c == '\n')
+        sc->l_comment = false;
+    Scanner *cv = comment_view(sc);
+    if (cv != 0)
+        s_putch_at(cv, c, at);
+}
+
+static void s_putch(Scanner *sc, char c)
+{
+    s_putch_at(sc, c, 0);
+}
+
+/* Put comment (non-code) character, from input *at if at is not null */
+static inline void c_putch_at(Scanner *sc, char c, const char *at)
+{
+    if (sc->opt.cflag || (sc->opt.nflag && c == '\n'))
+        whisp_putchar(sc, c, at);
+    Scanner *cv = comment_view(sc);
+    if (cv != 0)
+        c_putch_at(cv, c, at);
+}
+
+static void c_putch(Scanner *sc, char c)
+{
+    c_putch_at(sc, c, 0);
+}
+
+/* Output string of statement characters */
+static void s_putstr(Scanner *sc, const char *str)
+{
+    char c;
+    while ((c = *str++) != '\0')
+        s_putch(sc, c);
+}
+
+/* Put block of source code characters - same as s_putch(sc) on each */
+static void s_putspan(Scanner *sc, const char *str, size_t len)
+{
+    Scanner *cv = comment_view(sc);
+    if (cv != 0)
+        s_putspan(cv, str, len);
+    if (!sc->opt.cflag)
+        whisp_putspan(sc, str, len);
+    else
+    {
+        /* Only newlines can reach the output */
+        const char *end = str + len;
+        while ((str = memchr(str, '\n', (size_t)(end - str))) != 0)
+        {
+            s_putch_at(sc, '\n', str);
+            str++;
+        }
+    }
+}
+
+/* Put block of comment characters - same as c_putch(sc) on each */
+static void c_putspan(Scanner *sc, const char *str, size_t len)
+{
+    Scanner *cv = comment_view(sc);
+    if (cv != 0)
+        c_putspan(cv, str, len);
+    if (sc->opt.cflag)
+        whisp_putspan(sc, str, len);
+    else if (sc->opt.nflag)
+    {
+        const char *end = str + len;
+        while ((str = memchr(str, '\n', (size_t)(end - str))) != 0)
+        {
+            whisp_putchar(sc, '\n', str);
+            str++;
+        }
+    }
+}
+
+/* Pass a warning to the sink; warning(sc) also counts it by type */
+static void diag_send(Scanner *sc, const char *str, int line)
+{
+    if ((sc->sink.flags & SCC_SINK_UNORDERED) == 0)
+        out_flush(sc);
+    sc->num_diag++;
+    if (sc->sink.diag != 0)
+        (*sc->sink.diag)(sc->sink.data, sc->fn, line, str);
+}
+
+static void warning(Scanner *sc, int type, const char *str, int line)
+{
+    if (sc->dry)
+        return;
+    sc->stats.warnings[type]++;
+    diag_send(sc, str, line);
+}
+
+static void warning2(Scanner *sc, int type, const char *s1, const char *s2, int line)
+{
+    char buffer[BUFSIZ];
+    snprintf(buffer, sizeof(buffer), "%s %s", s1, s2);
+    warning(sc, type, buffer, line);
+}
+
+static void warningv(Scanner *sc, int type, const char *fmt, int line, ...)
+{
+    char buffer[BUFSIZ];
+    va_list args;
+    va_start(args, line);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    warning(sc, type, buffer, line);
+}
+
+static void warn_feature(Scanner *sc, enum Feature feature)
+{
+    assert(sc->fn != 0);
+    assert(feature >= F_HEXFLOAT && feature <= F_UNIVERSAL);
+    warningv(sc, SCC_W_FEATURE, "%s feature used but not supported in %s", src_line(sc),
+             feature_name[feature], std_name[sc->opt.std_code]);
+}
+
+static void put_quote_char(Scanner *sc, char q, char c)
+{
+    if (q == '\'' && sc->opt.qchar != 0)
+        s_putch(sc, sc->opt.qchar);
+    else if (q == '"' && sc->opt.schar != 0)
+        s_putch(sc, sc->opt.schar);
+    else
+        s_putch(sc, c);
+}
+
+static void put_quote_str(Scanner *sc, char q, char *str)
+{
+    char c;
+    while ((c = *str++) != '\0')
+        put_quote_char(sc, q, c);
+}
+
+/* Same as put_quote_char(sc) on each of a block of characters */
+static void put_quote_span(Scanner *sc, char q, const char *str, size_t len)
+{
+    int rep = (q == '\'') ? sc->opt.qchar : (q == '"') ? sc->opt.schar : 0;
+    if (rep == 0)
+        s_putspan(sc, str, len);
+    else
+    {
+        char buffer[256];
+        memset(buffer, rep, (len < sizeof(buffer)) ? len : sizeof(buffer));
+        while (len > 0)
+        {
+            size_t nbytes = (len < sizeof(buffer)) ? len : sizeof(buffer);
+            s_putspan(sc, buffer, nbytes);
+            len -= nbytes;
+        }
+    }
+}
+
+/*
+** The opening quote of a string literal or character constant has been
+** output; the body is scanned by quote_body(sc) in state InQuote.
+*/
+static Comment begin_quote(Scanner *sc, char q, const char *msg)
+{
+    if (q == '"')
+        sc->stats.strings++;
+    else
+        sc->stats.chars++;
+    sc->quote = q;
+    sc->quote_msg = msg;
+    return InQuote;
+}
+
+/*
+** Scan the part of the body of a literal that starts with c: an
+** unescaped closing quote or newline ends the literal; a backslash
+** sequence is dealt with as a whole; and a run of ordinary characters
+** is copied as a block.  At EOF in the body, scan_end(sc) reports it.
+*/
+LEX_INLINE Comment quote_body(Scanner *sc, int c1, unsigned features)
+{
+    char q = sc->quote;
+
+    if (c1 == q)
+    {
+        s_putch(sc, q);
+        return NonComment;
+    }
+    if (c1 == '\\')
+    {
+        /*
+        ** All but the last backslash of a run are written the same way
+        ** whatever follows the run, so they are written as they are
+        ** counted.  When streaming, a run that reaches the end of the
+        ** data so far leaves its last backslash to be read again by the
+        ** next step, with the parity of those written in sc->bs_odd.
+        */
+        bool odd = sc->bs_odd;
+        size_t start = sc->src.pos;
+        sc->bs_odd = false;
+        while (sc->src.pos < sc->src.len && sc->src.base[sc->src.pos] == '\\')
+            sc->src.pos++;
+        size_t count = sc->src.pos - start;
+        if (count > 0)
+            put_quote_span(sc, q, sc->src.base + start - 1, count);
+        if (count > 0 && sc->src.pos == sc->src.len && !sc->src.final)
+        {
+            sc->src.pos--;
+            sc->bs_odd = (odd != (count % 2 == 1));
+            return InQuote;
+        }
+        int c2 = getch(sc);
+        if (c2 == EOF)
+        {
+            /* Stream of backslashes and newline - bug in source code */
+            put_quote_char(sc, q, c1);
+            s_putch(sc, q);
+            return NonComment;
+        }
+        if (c2 == '\n')
+        {
+            /* The backslash-newline would be processed first */
+            s_putch(sc, c1);
+            s_putch(sc, c2);
+        }
+        else if (odd == (count % 2 == 1))
+        {
+            /* Odd number of backslashes: the last one escapes c2 */
+            put_quote_char(sc, q, c1);
+            put_quote_char(sc, q, c2);
+            if ((c2 == 'u' || c2 == 'U') && !(features & SCC_F_UNIVERSAL))
+                warn_feature(sc, F_UNIVERSAL);
+        }
+        else
+        {
+            /* Pairs of backslashes: c2 is not escaped */
+            put_quote_char(sc, q, c1);
+            s_putch(sc, c2);
+            if (c2 == q)
+                return NonComment;
+        }
+    }
+    else if (c1 == '\n')
+    {
+        put_quote_char(sc, q, c1);
+        warning2(sc, SCC_W_LITERAL, "newline in", sc->quote_msg, src_line(sc) - 1);
+        /* Heuristic recovery - assume close quote at end of line */
+        return NonComment;
+    }
+    else
+    {
+        /* Copy the run of ordinary characters as a block */
+        const char *start = sc->src.base + sc->src.pos - 1;
+        const char *end = scc_skip_any3(sc->src.base + sc->src.pos,
+                                    sc->src.base + sc->src.len, q, '\\', '\n');
+        sc->src.pos = (size_t)(end - sc->src.base);
+        put_quote_span(sc, q, start, (size_t)(end - start));
+    }
+    return InQuote;
+}
+
+/*
+** read_bsnl(sc) - Count the number of backslash newline pairs that
+** immediately follow in the input buffer.  On entry, peek(sc) might
+** return the backslash of a backslash newline pair, or some other
+** character.  On exit, getch(sc) will return the first character
+** after the sequence of n (n >= 0) backslash newline pairs.  Since
+** the whole input is in memory, looking two characters ahead needs
+** no pushback at all (unlike the old stdio version, which relied on
+** a non-portable double ungetc()).
+**
+** The pairs follow the slash or star c, and what they mean depends on
+** the character after them.  When streaming, a sequence that reaches
+** the end of the data so far is carried over to the next step: the
+** last pair is left to be read again, with c in sc->bsnl_char and the
+** number of pairs before it in sc->bsnl_held, and read_bsnl(sc)
+** returns false.  The caller returns straight away, and the next step
+** calls it again with c (see scan_step()).  It also returns false,
+** with nothing changed, when the step has to wait for more data.
+*/
+static bool read_bsnl(Scanner *sc, char c, size_t *bsnl)
+{
+    bool resumed = (sc->bsnl_char != 0);
+    size_t held = sc->bsnl_held;
+    size_t n = held;
+    size_t start = sc->src.pos;
+
+    sc->bsnl_char = 0;
+    sc->bsnl_held = 0;
+    while (sc->src.pos + 1 < sc->src.len && sc->src.base[sc->src.pos] == '\\' &&
+           sc->src.base[sc->src.pos + 1] == '\n')
+    {
+        sc->src.pos += 2;
+        n++;
+    }
+    bool at_end = (sc->src.pos == sc->src.len ||
+                   (sc->src.pos + 1 == sc->src.len && sc->src.base[sc->src.pos] == '\\'));
+    if (at_end && !sc->src.final)
+    {
+        if (sc->src.pos - start < (resumed ? 4 : 2))
+        {
+            /* Nothing new to carry over: wait for more data as it was */
+            sc->src.starved = true;
+            sc->src.pos = start;
+            sc->bsnl_char = resumed ? c : 0;
+            sc->bsnl_held = held;
+            return false;
+        }
+        sc->src.pos -= 2;
+        sc->bsnl_char = c;
+        sc->bsnl_held = n - 1;
+        return false;
+    }
+    *bsnl = n;
+    return true;
+}
+
+static void write_bsnl(Scanner *sc, size_t bsnl, void (*put)(Scanner *, char))
+{
+    while (bsnl-- > 0)
+    {
+        (*put)(sc, '\\');
+        (*put)(sc, '\n');
+    }
+}
+
+static Comment c_comment(Scanner *sc, int c)
+{
+    Comment status = CComment;
+    if (c == '*')
+    {
+        size_t bsnl;
+        if (!read_bsnl(sc, c, &bsnl))
+            return status;
+        if (peek(sc) == '/')
+        {
+            sc->l_comment = true;
+            if (comment_view(sc) != 0)
+                sc->comments->l_comment = true;
+            status = NonComment;
+            c = getch(sc);
+            c_putch(sc, '*');
+            write_bsnl(sc, bsnl, c_putch);
+            c_putch(sc, '/');
+            s_putch(sc, ' ');
+            if (sc->opt.eflag)
+            {
+                s_putch(sc, '*');
+                s_putch(sc, '/');
+            }
+        }
+        else
+        {
+            c_putch(sc, c);
+            write_bsnl(sc, bsnl, c_putch);
+        }
+    }
+    else if (sc->opt.wflag && c == '/' && peek(sc) == '*')
+    {
+        int line = src_line(sc);
+        if (sc->l_nest != line)
+            warning(sc, SCC_W_COMMENT, "nested C-style comment", line);
+        sc->l_nest = line;
+        c_putch(sc, c);
+    }
+    else
+        c_putch(sc, c);
+    return status;
+}
+
+static Comment cpp_comment(Scanner *sc, int c, int oc)
+{
+    Comment status = CppComment;
+    if (c == '\n' && oc != '\\')
+    {
+        status = NonComment;
+        s_putch(sc, c);
+        if (!sc->opt.nflag)
+            c_putch(sc, c);
+    }
+    else
+        c_putch(sc, c);
+    return status;
+}
+
+/* Backslash was read but not printed! u or U was peeked but not read */
+/*
+** There's no compelling reason to handle UCNs - the code is supposed to
+** be valid before using SCC on it, and invalid UCNs therefore should
+** not appear.  OTOH, to report their use when not supported, you have
+** to detect their existence.
+*/
+LEX_INLINE void scan_ucn(Scanner *sc, int letter, int nbytes, unsigned features)
+{
+    assert(letter == 'u' || letter == 'U');
+    assert(nbytes == 4 || nbytes == 8);
+    bool ok = true;
+    int i;
+    char str[8];
+    if (!(features & SCC_F_UNIVERSAL))
+        warn_feature(sc, F_UNIVERSAL);
+    s_putch(sc, '\\');
+    int c = getch(sc);
+    assert(c == letter);
+    s_putch(sc, c);
+    for (i = 0; i < nbytes; i++)
+    {
+        c = getch(sc);
+        if (c == EOF)
+        {
+            ok = false;
+            break;
+        }
+        if (!is_xdigit(c))
+        {
+            ok = false;
+            s_putch(sc, c);
+            break;
+        }
+        str[i] = c;
+        s_putch(sc, c);
+    }
+    if (!ok)
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Invalid UCN \\%c%.*s%c detected", letter, i, str, c);
+        warning(sc, SCC_W_UCN, msg, src_line(sc));
+    }
+}
+
+/*
+** Numeric punctuation in a number of the radix given by the class of
+** its digits (CC_DIGIT, CC_XDIGIT, CC_OCTAL or CC_BINARY).  Each call
+** passes a constant class, so check_punct(sc) is specialized for each
+** radix when inlined.
+*/
+LEX_INLINE int check_punct(Scanner *sc, int oc, unsigned digits, unsigned features)
+{
+    int sq = getch(sc);
+    assert(sq == '\'');
+    s_putch(sc, sq);
+    if (!(features & SCC_F_NUMPUNCT))
+        warn_feature(sc, F_NUMPUNCT);
+    if (!char_is(oc, digits))
+    {
+        warning(sc, SCC_W_NUMBER, "Single quote in numeric context not preceded by a valid digit", src_line(sc));
+        return sq;
+    }
+    int pc = peek(sc);
+    if (pc == EOF)
+    {
+        warning(sc, SCC_W_NUMBER, "Single quote in numeric context followed by EOF", src_line(sc));
+        return sq;
+    }
+    if (!char_is(pc, digits))
+        warning(sc, SCC_W_NUMBER, "Single quote in numeric context not followed by a valid digit", src_line(sc));
+    return pc;
+}
+
+/*
+** The digits of a number can run on for any length.  When streaming, a
+** number that reaches the end of the data so far is carried over to
+** the next step: the part being read, its last character and whether
+** a hexadecimal floating point constant has been reported are kept,
+** and number_resume(sc) carries on from there.  A prefix, exponent
+** sign or numeric punctuation still has to wait for the next data.
+*/
+enum { MORE = -2 };     /* End of the data so far, but not of the input */
+
+static int peek_digit(const Scanner *sc)
+{
+    if (sc->src.pos >= sc->src.len)
+        return sc->src.final ? EOF : MORE;
+    return (unsigned char)sc->src.base[sc->src.pos];
+}
+
+static void hold_number(Scanner *sc, NumPart part, int oc, bool warned)
+{
+    sc->num_part = part;
+    sc->num_oc = oc;
+    sc->num_warned = warned;
+}
+
+/* Digits of the exponent introduced by c, of which some have been read if digits */
+static void exponent_digits(Scanner *sc, int c, bool digits)
+{
+    int pc;
+    while ((pc = peek_digit(sc)) != MORE && is_digit(pc))
+    {
+        digits = true;
+        s_putch(sc, getch(sc));
+    }
+    if (pc == MORE && digits)
+        hold_number(sc, NUM_EXPONENT, c, false);
+    else if (pc == MORE)
+        sc->src.starved = true;
+    else if (!digits)
+    {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "Exponent %c not followed by (optional sign and) one or more digits", c);
+        warning(sc, SCC_W_NUMBER, msg, src_line(sc));
+    }
+}
+
+static inline void parse_exponent(Scanner *sc)
+{
+    assert(sc != 0 && sc->fn != 0);
+    /* First character is known to be valid exponent (p, P, e, E) */
+    int c = getch(sc);
+    assert(c == 'e' || c == 'E' || c == 'p' || c == 'P');
+    s_putch(sc, c);
+    int pc = peek(sc);
+    if (pc == '+' || pc == '-')
+        s_putch(sc, getch(sc));
+    exponent_digits(sc, c, false);
+}
+
+LEX_INLINE void hex_digits(Scanner *sc, int oc, bool warned, unsigned features)
+{
+    int pc;
+    while ((pc = peek_digit(sc)) != MORE && (pc == '\'' || is_xdigit(pc) || pc == '.'))
+    {
+        if (pc == '\'')
+            oc = check_punct(sc, oc, CC_XDIGIT, features);
+        else
+        {
+            if (pc == '.' && !(features & SCC_F_HEXFLOAT))
+            {
+                if (!warned)
+                    warn_feature(sc, F_HEXFLOAT);
+                warned = true;
+            }
+            oc = pc;
+            s_putch(sc, getch(sc));
+        }
+    }
+    if (pc == MORE)
+        hold_number(sc, NUM_HEX, oc, warned);
+    else if (pc == 'p' || pc == 'P')
+    {
+        if (!(features & SCC_F_HEXFLOAT) && !warned)
+            warn_feature(sc, F_HEXFLOAT);
+        parse_exponent(sc);
+    }
+}
+
+LEX_INLINE void parse_hex(Scanner *sc, unsigned features)
+{
+    /* Hex constant - integer or float */
+    /* Should be followed by one or more hex digits */
+    s_putch(sc, '0');
+    int c = getch(sc);
+    assert(c == 'x' || c == 'X');
+    s_putch(sc, c);
+    hex_digits(sc, c, false, features);
+}
+
+LEX_INLINE void binary_digits(Scanner *sc, int oc, unsigned features)
+{
+    int pc;
+    while ((pc = peek_digit(sc)) != MORE && (pc == '\'' || is_binary(pc)))
+    {
+        if (pc == '\'')
+            oc = check_punct(sc, oc, CC_BINARY, features);
+        else
+        {
+            oc = pc;
+            s_putch(sc, getch(sc));
+        }
+    }
+    if (pc == MORE)
+        hold_number(sc, NUM_BINARY, oc, false);
+    else if (is_digit(pc))
+        warningv(sc, SCC_W_NUMBER, "Non-binary digit %c in binary constant", src_line(sc), pc);
+}
+
+LEX_INLINE void parse_binary(Scanner *sc, unsigned features)
+{
+    /* Binary constant - integer */
+    /* Should be followed by one or more binary digits */
+    if (!(features & SCC_F_BINARY))
+        warn_feature(sc, F_BINARY);
+    s_putch(sc, '0');     /* 0 */
+    int c = getch(sc);
+    assert(c == 'b' || c == 'B');
+    s_putch(sc, c);     /* b or B */
+    binary_digits(sc, c, features);
+}
+
+LEX_INLINE void octal_digits(Scanner *sc, int oc, unsigned features)
+{
+    int pc;
+    while ((pc = peek_digit(sc)) != MORE && (pc == '\'' || is_octal(pc)))
+    {
+        if (pc == '\'')
+            oc = check_punct(sc, oc, CC_OCTAL, features);
+        else
+        {
+            oc = pc;
+            s_putch(sc, getch(sc));
+        }
+    }
+    if (pc == MORE)
+        hold_number(sc, NUM_OCTAL, oc, false);
+    else if (is_digit(pc))
+        warningv(sc, SCC_W_NUMBER, "Non-octal digit %c in octal constant", src_line(sc), pc);
+}
+
+LEX_INLINE void parse_octal(Scanner *sc, unsigned features)
+{
+    /* Octal constant - integer */
+    /* Calling code checked for octal digit or s-quote */
+    s_putch(sc, '0');     /* 0 */
+    int c = getch(sc);
+    assert(is_octal(c) || c == '\'');
+    s_putch(sc, c);
+    octal_digits(sc, c, features);
+}
+
+LEX_INLINE void decimal_digits(Scanner *sc, int oc, unsigned features)
+{
+    int pc;
+    while ((pc = peek_digit(sc)) != MORE && (pc == '\'' || is_digit(pc)))
+    {
+        if (pc == '\'')
+            oc = check_punct(sc, oc, CC_DIGIT, features);
+        else
+        {
+            oc = pc;
+            s_putch(sc, getch(sc));
+        }
+    }
+    if (pc == MORE)
+        hold_number(sc, NUM_DECIMAL, oc, false);
+    else if (pc == 'e' || pc == 'E')
+        parse_exponent(sc);
+}
+
+LEX_INLINE void parse_decimal(Scanner *sc, int c, unsigned features)
+{
+    /* Decimal integer, or decimal floating point */
+    s_putch(sc, c);
+    int pc = peek(sc);
+    if (is_digit(pc) || pc == '\'')
+    {
+        c = getch(sc);
+        assert(c == pc);
+        s_putch(sc, pc);
+        decimal_digits(sc, c, features);
+    }
+}
+
+/*
+** Carry on with a number held at the end of the previous data.  The
+** step started with the character c at src.pos - 1, which is read
+** again.  Returns false if c is not part of the number after all, in
+** which case it is still to be dealt with.
+*/
+LEX_INLINE bool number_resume(Scanner *sc, unsigned features)
+{
+    size_t start = --sc->src.pos;
+    NumPart part = sc->num_part;
+    sc->num_part = NUM_NONE;
+    switch (part)
+    {
+    case NUM_DECIMAL:
+        decimal_digits(sc, sc->num_oc, features);
+        break;
+    case NUM_HEX:
+        hex_digits(sc, sc->num_oc, sc->num_warned, features);
+        break;
+    case NUM_BINARY:
+        binary_digits(sc, sc->num_oc, features);
+        break;
+    case NUM_OCTAL:
+        octal_digits(sc, sc->num_oc, features);
+        break;
+    case NUM_EXPONENT:
+        exponent_digits(sc, sc->num_oc, true);
+        break;
+    case NUM_NONE:
+        break;
+    }
+    if (sc->src.pos > start)
+        return true;
+    sc->src.pos++;
+    return false;
+}
+
+/*
+** Parse numbers - inherently unsigned.
+** Need to recognize:-
+** 12345            // Decimal
+** 01234567         // Octal - validation not required?
+** 0xABCDEF12       // Hexadecimal
+** 0b01101100       // C++14 binary
+** 9e-82            // Float
+** 9.23             // Float
+** .987             // Float
+** .987E+30         // Float
+** 0xA.BCP12        // C99 Hex floating point
+** 0B0110'1100      // C++14 punctuated binary number
+** 0XDEFA'CED0      // C++14 punctuated hex number
+** 234'567.123'987  // C++14 punctuated decimal number
+** 0'234'127'310    // C++14 punctuated octal number
+** 9'234.192'214e-8 // C++14 punctuated decimal Float
+** 0xA'B'C.B'Cp-12  // C++17 Presumed punctuated Hex floating point
+**
+** Note that backslash-newline can occur part way through a number.
+*/
+
+LEX_INLINE void parse_number(Scanner *sc, int c, unsigned features)
+{
+    assert(is_digit(c) || c == '.');
+    int pc = peek(sc);
+    int radix = SCC_R_DECIMAL;
+    if (c != '0')
+        parse_decimal(sc, c, features);
+    else if (pc == 'x' || pc == 'X')
+    {
+        radix = SCC_R_HEX;
+        parse_hex(sc, features);
+    }
+    else if ((pc == 'b' || pc == 'B'))
+    {
+        radix = SCC_R_BINARY;
+        parse_binary(sc, features);
+    }
+    else if (is_octal(pc) || pc == '\'')
+    {
+        radix = SCC_R_OCTAL;
+        parse_octal(sc, features);
+    }
+    else if (pc == 'e' || pc == 'E' || pc == '.')
+    {
+        /* Simple fractional (0.1234) or zero floating point decimal constant 0E0 */
+        parse_decimal(sc, c, features);
+    }
+    else if (is_digit(pc))
+    {
+        /*
+        ** Malformed number of some sort (09, for example).
+        ** Preprocessing numbers can contain all sorts of weird stuff.
+        ** 08 is valid as a preprocessing number, and has appeared in
+        ** macros.  It ended up as part of "%08X" or similar format
+        ** strings.  Hence, do not generate error message after all.
+        ** err_remark("0%c read - bogus number!\n", pc);
+        */
+        s_putch(sc, c);
+    }
+    else
+    {
+        /* Just a zero? -- e.g. array[0] */
+        s_putch(sc, c);
+    }
+    sc->stats.numbers[radix]++;
+}
+
+static void read_remainder_of_identifier(Scanner *sc)
+{
+    size_t start = sc->src.pos;
+    size_t end = start;
+    while (end < sc->src.len && is_idchar((unsigned char)sc->src.base[end]))
+        end++;
+    sc->src.pos = end;
+    sc->in_ident = (end == sc->src.len && !sc->src.final);
+    s_putspan(sc, sc->src.base + start, end - start);
+}
+
+static inline bool could_be_string_literal(char c)
+{
+    return(c == 'U' || c == 'u' || c == 'L' || c == 'R' || c == '8');
+}
+
+static bool valid_dq_raw_prefix(const char *prefix)
+{
+    for (int i = 0; i < NUM_DQ_RAW_PREFIX; i++)
+    {
+        if (strcmp(prefix, dq_raw_prefix[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+static bool valid_dq_reg_prefix(const char *prefix)
+{
+    for (int i = 0; i < NUM_DQ_REG_PREFIX; i++)
+    {
+        if (strcmp(prefix, dq_reg_prefix[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+static bool valid_dq_prefix(const char *prefix)
+{
+    return valid_dq_reg_prefix(prefix) || valid_dq_raw_prefix(prefix);
+}
+
+static bool raw_scan_marker(Scanner *sc, char *markstr, int *marklen, const char *pfx)
+{
+    int len = 0;
+    int c;
+    char message[128];
+    while ((c = getch(sc)) != EOF)
+    {
+        if (c == LPAREN)
+        {
+            /* End of marker */
+            assert(len <= MAX_RAW_MARKER);
+            markstr[len] = '\0';
+            *marklen = len;
+            return true;
+        }
+        else if (strchr("\") \\\t\v\f\n", c) != 0 || len >= MAX_RAW_MARKER)
+        {
+            /* Invalid mark character or marker is too long */
+            if (len >= MAX_RAW_MARKER)
+            {
+                markstr[len++] = c;
+                markstr[len] = '\0';
+                snprintf(message, sizeof(message),
+                         "Too long a raw string d-char-sequence: %s\"%.*s",
+                         pfx, len, markstr);
+            }
+            else
+            {
+                char qc[10] = "";
+                if (c > ' ' && c < 0x7F)
+                    snprintf(qc, sizeof(qc), " '%s%c'",
+                             ((c == '\'' || c == '\\') ? "\\" : ""), c);
+                snprintf(message, sizeof(message),
+                         "Invalid mark character (code %d%s) in d-char-sequence: %s\"%.*s",
+                         c, qc, pfx, len, markstr);
+            }
+            warning(sc, SCC_W_RAWMARK, message, src_line(sc));
+            markstr[len++] = c;
+            markstr[len] = '\0';
+            *marklen = len;
+            return false;
+        }
+        else
+            markstr[len++] = c;
+    }
+    snprintf(message, sizeof(message),
+             "Unexpected EOF in raw string d-char-sequence: %s\"%.*s",
+             pfx, len, markstr);
+    warning(sc, SCC_W_RAWMARK, message, src_line(sc));
+    markstr[len] = '\0';
+    *marklen = len;
+    return false;
+}
+
+/*
+** Scan the part of the body of a raw string that starts with c: a run
+** of characters up to the next close parenthesis is copied as a block;
+** a close parenthesis is checked for the delimiter and double quote.
+** At EOF in the body, scan_end(sc) reports it.
+*/
+static Comment raw_body(Scanner *sc, int c)
+{
+    const char *markstr = sc->raw_mark;
+    int marklen = sc->raw_marklen;
+
+    if (c != RPAREN)
+    {
+        /* Copy everything up to the next close parenthesis as a block */
+        size_t start = sc->src.pos - 1;
+        const char *rp = memchr(sc->src.base + sc->src.pos, RPAREN, sc->src.len - sc->src.pos);
+        size_t end = (rp != 0) ? (size_t)(rp - sc->src.base) : sc->src.len;
+        sc->src.pos = end;
+        s_putspan(sc, sc->src.base + start, end - start);
+    }
+    else
+    {
+        char endstr[MAX_RAW_MARKER + 2];
+        int len = 0;
+        while ((c = getch(sc)) != EOF)
+        {
+            if (c == '"' && len == marklen)
+            {
+                /* Got the end! */
+                s_putch(sc, RPAREN);
+                s_putstr(sc, markstr);
+                s_putch(sc, c);
+                return NonComment;
+            }
+            else if (len < marklen && c == markstr[len])
+                endstr[len++] = c;
+            else if (c == RPAREN)
+            {
+                /* Restart scan for mark string */
+                endstr[len] = '\0';
+                s_putch(sc, RPAREN);
+                s_putstr(sc, endstr);
+                len = 0;
+            }
+            else
+            {
+                endstr[len] = '\0';
+                s_putch(sc, RPAREN);
+                s_putstr(sc, endstr);
+                s_putch(sc, c);
+                break;
+            }
+        }
+    }
+    return InRaw;
+}
+
+static Comment parse_raw_string(Scanner *sc, const char *prefix)
+{
+    /*
+    ** Have read up to and including the double quote at the start of a
+    ** raw string literal (u8R" for example) and prefix but not double
+    ** quote has been printed.  Now find lead mark and open parenthesis.
+    ** NB: lead mark is not allowed to be longer than 16 characters.
+    ** u8R"lead(data)lead" is valid, as is u8R"(data)".
+    **
+    ** In the standard, the lead mark characters are called 'd-char's: any
+    ** member of the basic source character set except: space, the left
+    ** parenthesis (, the right parenthesis ), the backslash \, and the
+    ** control characters representing horizontal tab, vertical tab,
+    ** form feed, and newline.
+    **
+    ** A string literal that has an R in the prefix is a raw string
+    ** literal.  The d-char-sequence serves as a delimiter.  The
+    ** terminating d-char-sequence of a raw-string is the same sequence
+    ** of characters as the initial d-charsequence.  A d-char-sequence
+    ** shall consist of at most 16 characters.
+    **
+    ** NB: The fact that backslash is not allowed in the marker means
+    **     that double quote is also prohibited since it would have to
+    **     be preceded by a backslash.
+    **
+    ** Processing:
+    ** 1. Find valid lead mark - up to first (.
+    ** 2. If invalid, report as such and process as ordinary dq-string.
+    ** 3. Else find ) and lead mark followed by close dq.
+    **    - NB: R"aa( )aa )aa" is valid; the first ")aa" is content
+    **      because it is not followed by a double quote.
+    ** 4. If EOF encountered first, report the problem.
+    ** Save line number for start of literal.
+    ** Step 3 is done by raw_body(sc) in state InRaw.
+    **
+    ** NB: If replacing string characters, the raw string delimiters are
+    **     printed unmapped, but the body of the raw string is printed
+    **     as the replacement character.
+    */
+    assert(prefix != 0 && sc != 0 && sc->fn != 0);
+    char *markstr = sc->raw_mark;
+    if (raw_scan_marker(sc, markstr, &sc->raw_marklen, prefix))
+    {
+        s_putch(sc, '"');
+        s_putstr(sc, markstr);
+        s_putch(sc, LPAREN);
+        sc->raw_line = src_line(sc);
+        sc->stats.raw_strings++;
+        return InRaw;
+    }
+    else
+    {
+        s_putch(sc, '"');
+        put_quote_str(sc, '"', markstr);
+        return begin_quote(sc, '"', "string literal");
+    }
+}
+
+LEX_INLINE Comment parse_dq_string(Scanner *sc, const char *prefix, unsigned features)
+{
+    assert(valid_dq_prefix(prefix));
+    if (valid_dq_raw_prefix(prefix))
+    {
+        if (!(features & SCC_F_RAWSTRING))
+            warn_feature(sc, F_RAWSTRING);
+        s_putstr(sc, prefix);
+        return parse_raw_string(sc, prefix);
+    }
+    else
+    {
+        if (strcmp(prefix, "L") != 0 && !(features & SCC_F_UNICODE))
+            warn_feature(sc, F_UNICODE);
+        s_putstr(sc, prefix);
+        s_putch(sc, '"');
+        return begin_quote(sc, '"', "string literal");
+    }
+}
+
+LEX_INLINE Comment process_poss_string_literal(Scanner *sc, char c, unsigned features)
+{
+    char prefix[6] = "";
+    int idx = 0;
+    prefix[idx++] = c;
+    while ((c = peek(sc)) != EOF)
+    {
+        if (c == '\'')
+        {
+            /* process sinqle quote */
+            /* Curiously, it really doesn't matter if the prefix is valid or not */
+            /* SCC will process it the same way, printing prefix and then processing single quote */
+            s_putstr(sc, prefix);
+            c = getch(sc);
+            s_putch(sc, c);
+            return begin_quote(sc, c, "character constant");
+        }
+        else if (c == '"')
+        {
+            /* process double quote - possibly raw */
+            if (valid_dq_prefix(prefix))
+            {
+                c = getch(sc);
+                return parse_dq_string(sc, prefix, features);
+            }
+            else
+            {
+                /* Invalid syntax - identifier followed by double quote */
+                s_putstr(sc, prefix);
+                c = getch(sc);
+                s_putch(sc, c);
+                return begin_quote(sc, c, "character constant");
+            }
+        }
+        else if (could_be_string_literal(c))
+        {
+            c = getch(sc);
+            prefix[idx++] = c;
+            if (idx > 3)
+            {
+                s_putstr(sc, prefix);
+                read_remainder_of_identifier(sc);
+                break;
+            }
+            /* Only loop continuation */
+        }
+        else
+        {
+            s_putstr(sc, prefix);
+            read_remainder_of_identifier(sc);
+            break;
+        }
+    }
+    return NonComment;
+}
+
+/*
+** Parse identifiers.
+** Also parse strings and characters preceded by alphanumerics (raw
+** strings, Unicode strings, and some character literals).
+** L"xxx" in all standard variants of C and C++.
+** u"xxx", U"xxx", u8"xxx from C11 and C++11 onwards.
+** R"y(xxx)y", LR"y(xxx)y", uR"y(xxx)y", UR"y(xxx)y" and u8R"y(xxx)y" in C++11 onwards.
+** L'x' in all standard variants of C and C++.
+** U'x' and u'x' from C11 and C++11 onwards.
+** No space is allowed between the prefix and the quote.
+**
+** NB: UCNs in an identifier are parsed independently of 'identifier'.
+*/
+LEX_INLINE Comment parse_identifier(Scanner *sc, int c, unsigned features)
+{
+    assert(is_alpha(c) || c == '_');
+    if (could_be_string_literal(c))
+        return process_poss_string_literal(sc, c, features);
+    s_putch(sc, c);
+    read_remainder_of_identifier(sc);
+    return NonComment;
+}
+
+/*
+** How non_comment(sc) deals with each character, indexed by unsigned
+** char value.  Only the characters that stop scc_skip_code() reach it:
+** other characters, including letters other than the string prefix
+** letters, are copied by code_run(sc).
+*/
+typedef enum
+{
+    LC_PLAIN, LC_STAR, LC_SQUOTE, LC_DQUOTE, LC_SLASH, LC_DOT, LC_DIGIT,
+    LC_PREFIX, LC_BACKSLASH
+} LexClass;
+
+static const unsigned char lex_class[UCHAR_MAX + 1] =
+{
+    ['*']  = LC_STAR,   ['\''] = LC_SQUOTE, ['"']  = LC_DQUOTE,
+    ['/']  = LC_SLASH,  ['.']  = LC_DOT,    ['\\'] = LC_BACKSLASH,
+    ['0']  = LC_DIGIT,  ['1']  = LC_DIGIT,  ['2']  = LC_DIGIT,  ['3']  = LC_DIGIT,
+    ['4']  = LC_DIGIT,  ['5']  = LC_DIGIT,  ['6']  = LC_DIGIT,  ['7']  = LC_DIGIT,
+    ['8']  = LC_DIGIT,  ['9']  = LC_DIGIT,
+    ['L']  = LC_PREFIX, ['R']  = LC_PREFIX, ['U']  = LC_PREFIX, ['u']  = LC_PREFIX,
+};
+
+LEX_INLINE Comment non_comment(Scanner *sc, int c, bool after_number, unsigned features)
+{
+    int pc;
+    Comment status = NonComment;
+    switch (lex_class[c])
+    {
+    case LC_STAR:
+        {
+            size_t bsnl;
+            if (!read_bsnl(sc, c, &bsnl))
+                break;
+            if ((pc = peek(sc)) == '/')
+            {
+                c = getch(sc);
+                s_putch(sc, '*');
+                write_bsnl(sc, bsnl, s_putch);
+                s_putch(sc, '/');
+                int line = src_line(sc);
+                if (sc->l_cend != line)
+                    warning(sc, SCC_W_COMMENT, "C-style comment end marker ('*/') not in a comment",
+                            line);
+                sc->l_cend = line;
+            }
+            else
+            {
+                s_putch(sc, c);
+                write_bsnl(sc, bsnl, s_putch);
+            }
+        }
+        break;
+    case LC_SQUOTE:
+        s_putch(sc, c);
+        /*
+        ** Single quotes can contain multiple characters, such as
+        ** '\\', '\'', '\377', '\x4FF', 'ab', '/ *' (with no space, and
+        ** the reverse character pair) , etc.  Scan for an unescaped
+        ** closing single quote.  Newlines are not acceptable either,
+        ** unless preceded by a backslash -- so both '\<nl>\n' and
+        ** '\\<nl>n' are OK, and are equivalent to a newline character
+        ** (when <nl> is a physical newline in the source code).
+        */
+        status = begin_quote(sc, c, "character constant");
+        break;
+    case LC_DQUOTE:
+        s_putch(sc, c);
+        /* Double quotes are relatively simple, except that */
+        /* they can legitimately extend over several lines */
+        /* when each line is terminated by a backslash */
+        status = begin_quote(sc, c, "string literal");
+        break;
+    case LC_SLASH:
+        {
+            /* Potential start of comment */
+            size_t bsnl;
+            if (!read_bsnl(sc, c, &bsnl))
+                break;
+            if ((pc = peek(sc)) == '*')
+            {
+                status = CComment;
+                sc->stats.c_comments++;
+                sc->stats.c_comment_bytes += 2 + 2 * bsnl;
+                c = getch(sc);
+                c_putch(sc, '/');
+                write_bsnl(sc, bsnl, c_putch);
+                c_putch(sc, '*');
+                if (sc->opt.eflag)
+                {
+                    s_putch(sc, '/');
+                    s_putch(sc, '*');
+                }
+            }
+            else if (!(features & SCC_F_DOUBLESLASH) && pc == '/')
+            {
+                warn_feature(sc, F_DOUBLESLASH);
+                c = getch(sc);
+                s_putch(sc, c);
+                write_bsnl(sc, bsnl, s_putch);
+                s_putch(sc, c);
+            }
+            else if ((features & SCC_F_DOUBLESLASH) && pc == '/')
+            {
+                status = CppComment;
+                sc->stats.cpp_comments++;
+                sc->stats.cpp_comment_bytes += 2 + 2 * bsnl;
+                c = getch(sc);
+                c_putch(sc, c);
+                write_bsnl(sc, bsnl, c_putch);
+                c_putch(sc, c);
+                if (sc->opt.eflag)
+                    s_putstr(sc, "//");
+            }
+            else
+            {
+                s_putch(sc, c);
+                write_bsnl(sc, bsnl, s_putch);
+            }
+        }
+        break;
+    case LC_DOT:
+        if (!is_digit(peek(sc)))
+        {
+            s_putch(sc, c);
+            break;
+        }
+        if (after_number)
+        {
+            /* Fraction of a number such as 1.5 - counted with its integer part */
+            parse_decimal(sc, c, features);
+            sc->after_number = true;
+            break;
+        }
+        /*FALLTHROUGH*/
+    case LC_DIGIT:
+        parse_number(sc, c, features);
+        sc->after_number = true;
+        break;
+    case LC_PREFIX:
+        status = parse_identifier(sc, c, features);
+        break;
+    case LC_BACKSLASH:
+        if ((pc = peek(sc)) == 'u' || pc == 'U')
+        {
+            scan_ucn(sc, pc, (pc == 'u' ? 4 : 8), features);
+            break;
+        }
+        /*FALLTHROUGH*/
+    default:
+        /* space, punctuation, ... */
+        s_putch(sc, c);
+        break;
+    }
+    return status;
+}
+
+/*
+** Characters that non_comment(sc) copies straight to the output.  Letters
+** other than the string prefix letters are included: any digits or
+** prefix letters later in the same identifier are dealt with by
+** code_run(sc) without reference to non_comment(sc).
+*/
+static inline bool is_plain_code(int c)
+{
+    return !scc_skip_code_stop[c];
+}
+
+/*
+** The functions code_run(sc), c_comment_run(sc) and cpp_comment_run(sc) are
+** called when the character just read starts a run of characters that
+** need no special treatment in the current state.  They output the
+** whole run as a block and return its last character.  When streaming,
+** a run can stop part way through an identifier at the end of the data
+** so far; code_run(sc) carries on with the rest of it (sc->in_ident).
+*/
+static int code_run(Scanner *sc)
+{
+    const char *start = sc->src.base + sc->src.pos - 1;
+    const char *end = sc->src.base + sc->src.len;
+    const char *ptr = sc->src.base + sc->src.pos;
+
+    while ((ptr = scc_skip_code(ptr, end)) < end &&
+           is_idchar((unsigned char)ptr[0]) && is_idchar((unsigned char)ptr[-1]))
+    {
+        /* Rest of an identifier that started in this run */
+        while (++ptr < end && is_idchar((unsigned char)*ptr))
+            ;
+    }
+    sc->src.pos = (size_t)(ptr - sc->src.base);
+    sc->in_ident = (ptr == end && !sc->src.final && is_idchar((unsigned char)ptr[-1]));
+    s_putspan(sc, start, (size_t)(ptr - start));
+    return (unsigned char)ptr[-1];
+}
+
+static int c_comment_run(Scanner *sc)
+{
+    const char *start = sc->src.base + sc->src.pos - 1;
+    const char *end = sc->src.base + sc->src.len;
+    int stop = sc->opt.wflag ? '/' : '*';
+    const char *ptr = scc_skip_any3(sc->src.base + sc->src.pos, end, '*', stop, '*');
+    sc->src.pos = (size_t)(ptr - sc->src.base);
+    c_putspan(sc, start, (size_t)(ptr - start));
+    return (unsigned char)ptr[-1];
+}
+
+static int cpp_comment_run(Scanner *sc)
+{
+    size_t start = sc->src.pos - 1;
+    const char *nl = memchr(sc->src.base + sc->src.pos, '\n', sc->src.len - sc->src.pos);
+    size_t end = (nl != 0) ? (size_t)(nl - sc->src.base) : sc->src.len;
+    sc->src.pos = end;
+    c_putspan(sc, sc->src.base + start, end - start);
+    return (unsigned char)sc->src.base[end - 1];
+}
+
+/*
+** One step of the scan, starting with the character c just read: a
+** run of characters or a token.  Returns the last character read.
+*/
+LEX_INLINE int scan_step(Scanner *sc, Comment *status, int c, int oc, unsigned features)
+{
+    size_t start = sc->src.pos - 1;
+    if (sc->bsnl_char != 0)
+    {
+        /* Backslash-newlines held at the end of the previous data (read_bsnl()) */
+        c = sc->bsnl_char;
+        sc->src.pos--;
+    }
+    switch (*status)
+    {
+    case CComment:
+        if (c == '*' || c == '/')
+            *status = c_comment(sc, c);
+        else
+            c = c_comment_run(sc);
+        sc->stats.c_comment_bytes += sc->src.pos - start;
+        break;
+    case CppComment:
+        if (c == '\n')
+            *status = cpp_comment(sc, c, oc);
+        else
+            c = cpp_comment_run(sc);
+        if (*status == CppComment)
+            sc->stats.cpp_comment_bytes += sc->src.pos - start;
+        break;
+    case NonComment:
+        {
+            if (sc->num_part != NUM_NONE && number_resume(sc, features))
+                break;
+            bool after_number = sc->after_number;
+            sc->after_number = false;
+            if (is_plain_code(c) || (sc->in_ident && is_idchar(c)))
+                c = code_run(sc);
+            else
+            {
+                sc->in_ident = false;
+                *status = non_comment(sc, c, after_number, features);
+            }
+        }
+        break;
+    case InQuote:
+        *status = quote_body(sc, c, features);
+        break;
+    case InRaw:
+        *status = raw_body(sc, c);
+        break;
+    }
+    return c;
+}
+
+/*
+** When a stream has a line too long to hold, it is scanned up to the
+** end of the data received so far.  Each step is first run with the
+** output and warnings suppressed, to check that it does not need to
+** read beyond the data.  Runs and literal bodies can stop anywhere, and
+** numbers, runs of backslashes and chains of backslash-newlines are
+** carried over to the next step, so only a short token (a prefix, a
+** universal character name, the end of a raw string and so on) has to
+** wait for more data.
+*/
+LEX_INLINE bool step_fits(Scanner *sc, Comment status, int c, int oc, unsigned features)
+{
+    Source src = sc->src;
+    int l_nest = sc->l_nest;
+    int l_cend = sc->l_cend;
+    bool l_comment = sc->l_comment;
+    bool in_ident = sc->in_ident;
+    bool after_number = sc->after_number;
+    bool bs_odd = sc->bs_odd;
+    char bsnl_char = sc->bsnl_char;
+    size_t bsnl_held = sc->bsnl_held;
+    NumPart num_part = sc->num_part;
+    int num_oc = sc->num_oc;
+    bool num_warned = sc->num_warned;
+    SCC_Stats stats = sc->stats;
+
+    sc->dry = true;
+    sc->src.starved = false;
+    scan_step(sc, &status, c, oc, features);
+    bool fits = !sc->src.starved;
+    sc->dry = false;
+    sc->src = src;
+    sc->l_nest = l_nest;
+    sc->l_cend = l_cend;
+    sc->l_comment = l_comment;
+    sc->in_ident = in_ident;
+    sc->after_number = after_number;
+    sc->bs_odd = bs_odd;
+    sc->bsnl_char = bsnl_char;
+    sc->bsnl_held = bsnl_held;
+    sc->num_part = num_part;
+    sc->num_oc = num_oc;
+    sc->num_warned = num_warned;
+    sc->stats = stats;
+    return fits;
+}
+
+/*
+** The scan is linear in the input, whatever the input.  Each step
+** consumes at least one character and never goes back: a run, a run
+** of backslashes or a chain of backslash-newlines is read once as it
+** is counted or copied; a close parenthesis in a raw string that does
+** not start the delimiter is written out with the characters that
+** matched, and the search goes on from there (the delimiter cannot
+** hold a parenthesis, so no start is missed).  The output is written
+** once, and trailing white space is cut back rather than copied again.
+** A source map looks at each character only a few times more (see
+** map_continues()).  The adversarial inputs of sccbench -l check this,
+** and sccfuzz.c looks for inputs that are slow per byte.
+**
+** Scan from sc->src.pos to sc->src.len, picking up the lexical state
+** left by the previous call.  In careful mode, stops early (stalled)
+** at a token that needs more input than has been received.
+*/
+LEX_INLINE void lex_buffer(Scanner *sc, unsigned features)
+{
+    int oc = sc->oc;
+    int c;
+    Comment status = sc->state;
+
+    while ((c = getch(sc)) != EOF)
+    {
+        if (sc->src.careful && !step_fits(sc, status, c, oc, features))
+        {
+            sc->src.pos--;
+            sc->src.stalled = true;
+            break;
+        }
+        c = scan_step(sc, &status, c, oc, features);
+        oc = c;
+    }
+    sc->oc = oc;
+    sc->state = status;
+}
+
+/*
+** The lexer compiled for each set of features, so that each instance
+** has the features as constants instead of testing them as it goes.
+*/
+#define LEX_INSTANCE(name, features) \
+    static void scan_##name(Scanner *sc) { lex_buffer(sc, features); }
+FEATURE_SETS(LEX_INSTANCE)
+#undef LEX_INSTANCE
+
+static const struct
+{
+    unsigned    features;
+    void      (*scan)(Scanner *sc);
+} feature_set[] =
+{
+#define LEX_ENTRY(name, features)   [FS_##name] = { features, scan_##name },
+    FEATURE_SETS(LEX_ENTRY)
+#undef LEX_ENTRY
+};
+
+static void scan_buffer(Scanner *sc)
+{
+    sc->scan(sc);
+}
+
+/*
+** Pre-scan for input that needs no change (plain_input()).  Each of
+** the functions below mirrors the parse_*() function of the same name,
+** returning the end of the token that the scanner would copy, or null
+** if the scanner could issue a warning about it.  Numeric punctuation
+** is never plain: the quotes make the whole input fail the pre-scan.
+*/
+static const char *plain_exponent(const char *ptr, const char *end)
+{
+    const char *digits;
+    if (++ptr < end && (*ptr == '+' || *ptr == '-'))
+        ptr++;
+    for (digits = ptr; ptr < end && is_digit((unsigned char)*ptr); ptr++)
+        ;
+    return (ptr > digits) ? ptr : 0;
+}
+
+static const char *plain_decimal(const char *ptr, const char *end)
+{
+    /* Character at ptr - a digit or dot - has been accepted */
+    if (++ptr >= end || !is_digit((unsigned char)*ptr))
+        return ptr;
+    while (++ptr < end && is_digit((unsigned char)*ptr))
+        ;
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+        return plain_exponent(ptr, end);
+    return ptr;
+}
+
+static const char *plain_number(const Scanner *sc, const char *ptr, const char *end,
+                                size_t *numbers)
+{
+    unsigned features = sc->features;
+    int pc = (ptr + 1 < end) ? (unsigned char)ptr[1] : EOF;
+    if (*ptr != '0' || pc == 'e' || pc == 'E' || pc == '.')
+    {
+        numbers[SCC_R_DECIMAL]++;
+        return plain_decimal(ptr, end);
+    }
+    ptr += 2;
+    if (pc == 'x' || pc == 'X')
+    {
+        numbers[SCC_R_HEX]++;
+        for ( ; ptr < end && (is_xdigit((unsigned char)*ptr) || *ptr == '.'); ptr++)
+        {
+            if (*ptr == '.' && !(features & SCC_F_HEXFLOAT))
+                return 0;
+        }
+        if (ptr < end && (*ptr == 'p' || *ptr == 'P'))
+            return (features & SCC_F_HEXFLOAT) ? plain_exponent(ptr, end) : 0;
+    }
+    else if (pc == 'b' || pc == 'B')
+    {
+        if (!(features & SCC_F_BINARY))
+            return 0;
+        numbers[SCC_R_BINARY]++;
+        while (ptr < end && is_binary((unsigned char)*ptr))
+            ptr++;
+    }
+    else if (is_octal(pc))
+    {
+        numbers[SCC_R_OCTAL]++;
+        while (ptr < end && is_octal((unsigned char)*ptr))
+            ptr++;
+    }
+    else
+    {
+        numbers[SCC_R_DECIMAL]++;
+        return ptr - 1;
+    }
+    if (ptr < end && (*ptr == '\'' || is_digit((unsigned char)*ptr)))
+        return 0;
+    return ptr;
+}
+
+/*
+** Decide whether scanning in[0..len-1] would copy it to the output
+** unchanged without any warnings, so that the scan can be skipped:
+** no comments, no comment end markers or double slashes, no quotes or
+** backslashes, numbers that are valid in the standard, no white space
+** at the end of a line (unless -t is in effect) and a newline at the
+** end.  The input is walked token by token with the same scc_skip_code()
+** and code run rules as scan_step(), so the cost is close to that of
+** finding the characters that scc_skip_code() stops at.  The numbers are
+** counted in plain->numbers as they go by.
+*/
+static bool plain_input(const Scanner *sc, const char *in, size_t len, SCC_Stats *plain)
+{
+    const char *end = in + len;
+    const char *ptr = in;
+    bool after_number = false;  /* As sc->after_number */
+
+    if (sc->opt.cflag || len == 0 || end[-1] != '\n')
+        return false;
+    if (!sc->opt.tflag)
+    {
+        const char *nl = in;
+        while ((nl = memchr(nl, '\n', (size_t)(end - nl))) != 0)
+        {
+            if (nl > in && is_blank((unsigned char)nl[-1]))
+                return false;
+            nl++;
+        }
+    }
+
+    while (ptr < end)
+    {
+        int c = (unsigned char)*ptr;
+        int pc = (ptr + 1 < end) ? (unsigned char)ptr[1] : EOF;
+        bool fraction = after_number;
+        after_number = false;
+        if (is_plain_code(c))
+        {
+            /* As code_run(sc) */
+            while ((ptr = scc_skip_code(ptr + 1, end)) < end &&
+                   is_idchar((unsigned char)ptr[0]) && is_idchar((unsigned char)ptr[-1]))
+            {
+                while (ptr + 1 < end && is_idchar((unsigned char)ptr[1]))
+                    ptr++;
+            }
+        }
+        else if (c == '/')
+        {
+            if (pc == '*' || pc == '/' || pc == '\\')
+                return false;
+            ptr++;
+        }
+        else if (c == '*')
+        {
+            if (pc == '/' || pc == '\\')
+                return false;
+            ptr++;
+        }
+        else if (is_digit(c) || (c == '.' && is_digit(pc)))
+        {
+            /* As non_comment(sc): the fraction of 1.5 is not counted again */
+            if (c == '.' && fraction)
+                ptr = plain_decimal(ptr, end);
+            else
+                ptr = plain_number(sc, ptr, end, plain->numbers);
+            if (ptr == 0)
+                return false;
+            after_number = true;
+        }
+        else if (is_alpha(c))
+        {
+            /* Prefix letter: with no quotes, it starts an identifier */
+            while (++ptr < end && is_idchar((unsigned char)*ptr))
+                ;
+        }
+        else if (c == '.')
+            ptr++;
+        else
+        {
+            /* Quotes and backslashes */
+            return false;
+        }
+    }
+    return true;
+}
+
+static void scan_begin(Scanner *sc, const char *name, const SCC_Sink *sink)
+{
+    sc->fn = name;
+    sc->sink = *sink;
+    sc->stats.inputs++;
+    sc->error = 0;
+    sc->src = (Source){ .lline = 1 };
+    sc->state = NonComment;
+    sc->oc = '\0';
+    sc->l_nest = 0; /* Last line with a nested comment warning */
+    sc->l_cend = 0; /* Last line with a comment end warning */
+    sc->l_comment = false;
+    sc->in_ident = false;
+    sc->after_number = false;
+    sc->bs_odd = false;
+    sc->bsnl_char = 0;
+    sc->bsnl_held = 0;
+    sc->num_part = NUM_NONE;
+    sc->whisp_held = 0;
+    sc->whisp_off = 0;
+    sc->whisp_max = 0;
+    sc->whisp_entry = false;
+    sc->in_total = 0;
+    sc->out_total = 0;
+    sc->map_any = false;
+    sc->map_next = 0;
+    sc->map_out_line = sc->map_in_line = 1;
+    sc->map_out_bol = sc->map_in_pos = sc->map_in_bol = 0;
+    sc->map_clean_from = sc->map_clean_to = 0;
+    sc->num_diag = 0;
+    sc->zc_limit = sc->zc_start = sc->zc_end = 0;
+    sc->iov_cnt = 0;
+    sc->iov_len = 0;
+    sc->obuffer_mark = 0;
+    sc->obuffer_len = 0;
+    if (sc->comments != 0)
+    {
+        SCC_Sink comment_sink = sc->comments->sink;
+        scan_begin(sc->comments, name, &comment_sink);
+    }
+}
+
+static int scan_end(Scanner *sc)
+{
+    switch (sc->state)
+    {
+    case NonComment:
+        break;
+    case InQuote:
+        warning2(sc, SCC_W_LITERAL, "EOF in", sc->quote_msg, src_line(sc));
+        break;
+    case InRaw:
+        warning(sc, SCC_W_LITERAL, "Unexpected EOF in raw string starting at this line", sc->raw_line);
+        break;
+    default:
+        warning(sc, SCC_W_COMMENT, "unterminated C-style comment", src_line(sc));
+        break;
+    }
+    whisp_clear(sc);
+    if (sc->sink.map != 0)
+        map_end(sc);
+    out_flush(sc);
+    sc->stats.bytes_in += sc->in_total;
+    sc->stats.bytes_out += sc->out_total;
+    sc->stats.lines += (size_t)src_line(sc) - 1;
+    if (sc->in_total > 0 && sc->in_last != '\n')
+        sc->stats.lines++;
+    sc->fn = 0;
+    sc->src = (Source){ 0 };
+    if (sc->comments != 0 && scan_end(sc->comments) != 0 && sc->error == 0)
+        sc->error = errno;
+    if (sc->error != 0)
+    {
+        errno = sc->error;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+** Scan the complete input, or copy it if it is known to be plain, in
+** which case plain has the counts gathered by plain_input().
+*/
+static int strip_buffer(Scanner *sc, const char *name, const char *in, size_t len,
+                        const SCC_Sink *sink, const SCC_Stats *plain)
+{
+    scan_begin(sc, name, sink);
+    sc->src.base = in;
+    sc->src.len = len;
+    sc->src.final = true;
+    sc->in_total = len;
+    sc->in_last = (len > 0) ? in[len - 1] : '\0';
+    if (sink->writev != 0)
+        sc->zc_limit = in + len;
+    Scanner *cv = sc->comments;
+    if (cv != 0)
+    {
+        cv->src.base = in;
+        cv->src.len = len;
+        if (cv->sink.writev != 0)
+            cv->zc_limit = in + len;
+    }
+    if (plain != 0)
+    {
+        sc->stats.plain++;
+        scc_add_stats(&sc->stats, plain);
+        sc->src.pos = len;
+        if (cv != 0)
+            s_putspan(cv, in, len);
+        if (sc->sink.map != 0)
+        {
+            /* The output is the input, with the same lines */
+            map_point(sc, 0);
+            map_seek(sc, len);
+            sc->map_out_line = sc->map_in_line;
+            sc->map_out_bol = sc->map_in_bol;
+        }
+        out_write(sc, in, len);
+    }
+    else
+        scan_buffer(sc);
+    return scan_end(sc);
+}
+
+int scc_strip(Scanner *sc, const char *name, const char *in, size_t len,
+              const SCC_Sink *sink)
+{
+    SCC_Stats plain = { 0 };
+    bool is_plain = plain_input(sc, in, len, &plain);
+    return strip_buffer(sc, name, in, len, sink, is_plain ? &plain : 0);
+}
+
+int scc_stream_begin(Scanner *sc, const char *name, const SCC_Sink *sink)
+{
+    scan_begin(sc, name, sink);
+    sc->sbuf_len = 0;
+    sc->sbuf_line = STREAM_LINE_MAX;
+    sc->sbuf_wait = 0;
+    sc->whisp_max = WHISP_MAX;
+    sc->src.base = sc->sbuf;
+    if (sc->comments != 0)
+        sc->comments->whisp_max = WHISP_MAX;
+    return 0;
+}
+
+/*
+** Append a slice of the input to the stream buffer and scan up to the
+** end of the last line that does not end with a backslash.  No token
+** other than a raw string can continue beyond such a line, and a raw
+** string is scanned in state InRaw, so the scan stops exactly where it
+** would stop if it had all the input.  If more than sbuf_line bytes of
+** a line are left over, they are scanned carefully (see step_fits()),
+** so the memory used is bounded whatever the length of the lines or of
+** the tokens on them: the tokens that can be arbitrarily long are
+** carried over from one step to the next (see read_bsnl(), quote_body()
+** and number_resume()), and a short token that does not fit is tried
+** again when the data has doubled.  The scanned data is then
+** discarded, preserving the line number.
+*/
+static int stream_slice(Scanner *sc, const char *data, size_t len)
+{
+    if (len > sc->sbuf_size - sc->sbuf_len)
+    {
+        size_t new_size = sc->sbuf_size * 2 + len;
+        void *new_buffer = realloc(sc->sbuf, new_size);
+        if (new_buffer == 0)
+            return ENOMEM;
+        sc->sbuf = new_buffer;
+        sc->sbuf_size = new_size;
+    }
+    size_t old_len = sc->sbuf_len;
+    memcpy(sc->sbuf + old_len, data, len);
+    sc->sbuf_len += len;
+    sc->src.base = sc->sbuf;
+
+    /* Data before old_len has been scanned apart from a stalled token */
+    size_t limit = sc->sbuf_len;
+    while (limit-- > old_len)
+    {
+        if (sc->sbuf[limit] == '\n' && (limit == 0 || sc->sbuf[limit - 1] != '\\'))
+        {
+            sc->src.len = limit + 1;
+            sc->src.stalled = false;
+            scan_buffer(sc);
+            sc->sbuf_wait = 0;
+            break;
+        }
+    }
+
+    size_t pending = sc->sbuf_len - sc->src.pos;
+    if (pending > sc->sbuf_line && pending >= sc->sbuf_wait)
+    {
+        sc->src.len = sc->sbuf_len;
+        sc->src.careful = true;
+        sc->src.stalled = false;
+        scan_buffer(sc);
+        sc->src.careful = false;
+        sc->sbuf_wait = sc->src.stalled ? 2 * (sc->sbuf_len - sc->src.pos) : 0;
+    }
+
+    size_t done = sc->src.pos;
+    if (done > 0)
+    {
+        src_line(sc);
+        if (sc->sink.map != 0)
+            map_seek(sc, done);
+        memmove(sc->sbuf, sc->sbuf + done, sc->sbuf_len - done);
+        sc->sbuf_len -= done;
+        sc->src.len -= done;
+        sc->src.pos = 0;
+        sc->src.lpos = 0;
+        sc->src.origin += done;
+    }
+    return 0;
+}
+
+/* The data is processed in slices so that the stream buffer stays small */
+int scc_stream_write(Scanner *sc, const char *data, size_t len)
+{
+    sc->in_total += len;
+    if (len > 0)
+        sc->in_last = data[len - 1];
+    while (len > 0 && sc->error == 0)
+    {
+        size_t nbytes = (len < STREAM_SLICE) ? len : STREAM_SLICE;
+        int errnum = stream_slice(sc, data, nbytes);
+        if (errnum != 0)
+        {
+            errno = errnum;
+            return -1;
+        }
+        data += nbytes;
+        len -= nbytes;
+    }
+    if (sc->error != 0)
+    {
+        errno = sc->error;
+        return -1;
+    }
+    return 0;
+}
+
+int scc_stream_end(Scanner *sc)
+{
+    sc->src.base = sc->sbuf;
+    sc->src.len = sc->sbuf_len;
+    sc->src.final = true;
+    sc->src.stalled = false;
+    scan_buffer(sc);
+    return scan_end(sc);
+}
+
+/*
+** Parallel scanning of a large buffer (scc_strip_parallel()).
+**
+** The buffer is divided into chunks, each ending with a newline that is
+** not preceded by a backslash.  As with streaming, only a raw string
+** can continue past such a newline, and a string literal, character
+** constant or C++ comment cannot; so a chunk can only start in code,
+** in a C comment or in a raw string.  Worker threads scan each chunk
+** (other than the first) twice - once as if it starts in code and once
+** as if it starts in a C comment - with the output and warnings
+** collected in a Spec.  Each speculative scan starts with line number
+** 1 and notes where the white space pending from the previous chunk
+** (which it cannot know) would have been written or discarded.
+**
+** The calling thread then goes through the chunks in order.  If the
+** previous chunk finished in code or in a C comment, the Spec for the
+** actual state is adopted: its output is written with the pending
+** white space spliced in, its warnings are reported with the line
+** numbers adjusted, and its exit state becomes the current state.
+** Otherwise (a raw string was still open), the chunk is scanned
+** sequentially.  The result is identical to scanning the whole buffer
+** sequentially.
+*/
+
+enum { SPEC_CODE, SPEC_COMMENT, NUM_SPECS };
+enum { CHUNK_SIZE = 256 * 1024 };   /* Default chunk size */
+enum { CHUNK_WINDOW = 4 };          /* Chunks in flight, per thread */
+
+typedef struct SpecDiag
+{
+    size_t  offset;             /* Output preceding the warning */
+    int     line;               /* Line number within chunk */
+    char   *msg;
+} SpecDiag;
+
+typedef struct Spec
+{
+    bool        done;
+    int         error;
+    char       *out;
+    size_t      out_len;
+    size_t      out_size;
+    SpecDiag   *diag;
+    size_t      num_diag;
+    size_t      max_diag;
+    /* Exit state */
+    size_t      whisp_at;       /* Where entry white space goes */
+    size_t      whisp_diag;     /* Warnings that precede it */
+    SCC_Stats   stats;          /* Counts for the chunk, including warnings */
+    char       *whisp;          /* White space pending at exit */
+    size_t      whisp_len;
+    Comment     state;
+    int         oc;
+    bool        after_number;
+    bool        l_comment;
+    int         l_nest;
+    int         l_cend;
+    char        quote;
+    const char *quote_msg;
+    int         raw_line;
+    int         raw_marklen;
+    char        raw_mark[MAX_RAW_MARKER + 2];
+} Spec;
+
+typedef struct Chunk
+{
+    size_t      start;
+    size_t      end;
+    Spec        spec[NUM_SPECS];
+} Chunk;
+
+typedef struct ChunkPool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;       /* Signalled when any of the below changes */
+    const Scanner  *master;
+    const char     *base;
+    Chunk          *chunks;
+    size_t          num_chunks;
+    size_t          num_tasks;  /* One for chunk 0, NUM_SPECS for others */
+    size_t          next_task;  /* Next task to be claimed by a worker */
+    size_t          next_chunk; /* Next chunk to be stitched */
+    size_t          window;     /* Maximum chunks in flight */
+} ChunkPool;
+
+static bool spec_grow(void **array, size_t *size, size_t need, size_t unit)
+{
+    if (need <= *size)
+        return true;
+    size_t new_size = *size * 2 + need;
+    void *new_array = realloc(*array, new_size * unit);
+    if (new_array == 0)
+        return false;
+    *array = new_array;
+    *size = new_size;
+    return true;
+}
+
+static int spec_write(void *data, const char *buffer, size_t len)
+{
+    Spec *sp = data;
+    if (!spec_grow((void **)&sp->out, &sp->out_size, sp->out_len + len, 1))
+        return -1;
+    memcpy(sp->out + sp->out_len, buffer, len);
+    sp->out_len += len;
+    return 0;
+}
+
+static void spec_diag(void *data, const char *name, int line, const char *msg)
+{
+    Spec *sp = data;
+    (void)name;
+    if (!spec_grow((void **)&sp->diag, &sp->max_diag, sp->num_diag + 1, sizeof(*sp->diag)) ||
+        (sp->diag[sp->num_diag].msg = strdup(msg)) == 0)
+    {
+        sp->error = ENOMEM;
+        return;
+    }
+    sp->diag[sp->num_diag].offset = sp->out_len;
+    sp->diag[sp->num_diag].line = line;
+    sp->num_diag++;
+}
+
+static void spec_free(Spec *sp)
+{
+    for (size_t i = 0; i < sp->num_diag; i++)
+        free(sp->diag[i].msg);
+    free(sp->diag);
+    free(sp->out);
+    free(sp->whisp);
+    *sp = (Spec){ 0 };
+}
+
+/* Scan chunk as if it starts in the given state */
+static void spec_scan(Scanner *sc, const ChunkPool *pool, size_t k, int entry)
+{
+    const Chunk *cp = &pool->chunks[k];
+    Spec *sp = &pool->chunks[k].spec[entry];
+    SCC_Sink sink = { .write = spec_write, .diag = spec_diag, .data = sp };
+
+    scan_begin(sc, pool->master->fn, &sink);
+    sc->stats = (SCC_Stats){ 0 };
+    sc->src.base = pool->base + cp->start;
+    sc->src.len = cp->end - cp->start;
+    sc->src.final = (k == pool->num_chunks - 1);
+    sc->whisp_at = (size_t)WHISP_PENDING;
+    if (k > 0)
+    {
+        sc->state = (entry == SPEC_COMMENT) ? CComment : NonComment;
+        sc->oc = '\n';
+        sc->whisp_entry = true;
+    }
+    scan_buffer(sc);
+    whisp_detach(sc);
+    out_flush(sc);
+
+    sp->error = (sp->error != 0) ? sp->error : sc->error;
+    if (sc->whisp_off > 0 && (sp->whisp = malloc(sc->whisp_off)) == 0)
+        sp->error = ENOMEM;
+    else if (sc->whisp_off > 0)
+    {
+        memcpy(sp->whisp, sc->whisp, sc->whisp_off);
+        sp->whisp_len = sc->whisp_off;
+    }
+    sp->whisp_at = sc->whisp_at;
+    sp->whisp_diag = sc->whisp_diag;
+    sp->stats = sc->stats;
+    sp->state = sc->state;
+    sp->oc = sc->oc;
+    sp->after_number = sc->after_number;
+    sp->l_comment = sc->l_comment;
+    sp->l_nest = sc->l_nest;
+    sp->l_cend = sc->l_cend;
+    sp->quote = sc->quote;
+    sp->quote_msg = sc->quote_msg;
+    sp->raw_line = sc->raw_line;
+    sp->raw_marklen = sc->raw_marklen;
+    memcpy(sp->raw_mark, sc->raw_mark, sizeof(sp->raw_mark));
+    sc->fn = 0;
+}
+
+static void *chunk_worker(void *arg)
+{
+    ChunkPool *pool = arg;
+    Scanner *sc = malloc(sizeof(*sc));
+
+    if (sc != 0)
+    {
+        *sc = (Scanner){ .opt = pool->master->opt };
+        sc->features = pool->master->features;
+        sc->scan = pool->master->scan;
+    }
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        size_t task = pool->next_task;
+        size_t k = (task + NUM_SPECS - 1) / NUM_SPECS;
+        while (task < pool->num_tasks && k >= pool->next_chunk + pool->window)
+        {
+            pthread_cond_wait(&pool->cond, &pool->lock);
+            task = pool->next_task;
+            k = (task + NUM_SPECS - 1) / NUM_SPECS;
+        }
+        if (task >= pool->num_tasks)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pool->next_task++;
+        pthread_mutex_unlock(&pool->lock);
+
+        int entry = (k == 0) ? SPEC_CODE : (int)((task - 1) % NUM_SPECS);
+        if (sc != 0)
+            spec_scan(sc, pool, k, entry);
+        else
+            pool->chunks[k].spec[entry].error = ENOMEM;
+
+        pthread_mutex_lock(&pool->lock);
+        pool->chunks[k].spec[entry].done = true;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    if (sc != 0)
+        free(sc->whisp);
+    free(sc);
+    return 0;
+}
+
+/* Adopt the results of a speculative scan that started at line 'line' */
+static void spec_apply(Scanner *sc, const Chunk *cp, const Spec *sp, int line)
+{
+    size_t offset = 0;
+    size_t d = 0;
+    bool whisp_due = (sp->whisp_at <= sp->out_len);
+
+    /* The pending white space is at the end of the output so far */
+    if (sp->whisp_at == (size_t)WHISP_CLEARED)
+        whisp_clear(sc);
+    for (;;)
+    {
+        size_t next = sp->out_len;
+        if (d < sp->num_diag && sp->diag[d].offset < next)
+            next = sp->diag[d].offset;
+        if (whisp_due && sp->whisp_at < next)
+            next = sp->whisp_at;
+        if (next > offset)
+            out_write(sc, sp->out + offset, next - offset);
+        offset = next;
+        while (d < sp->num_diag && sp->diag[d].offset == offset)
+        {
+            if (whisp_due && sp->whisp_at == offset && sp->whisp_diag == d)
+            {
+                whisp_write(sc);
+                whisp_due = false;
+            }
+            diag_send(sc, sp->diag[d].msg, sp->diag[d].line + line - 1);
+            d++;
+        }
+        if (whisp_due && sp->whisp_at == offset)
+        {
+            whisp_write(sc);
+            whisp_due = false;
+        }
+        if (offset >= sp->out_len && d >= sp->num_diag)
+            break;
+    }
+    if (sp->whisp_len > 0)
+        whisp_blanks(sc, sp->whisp, sp->whisp_len);
+    if (sp->error != 0 && sc->error == 0)
+        sc->error = sp->error;
+    scc_add_stats(&sc->stats, &sp->stats);
+
+    sc->state = sp->state;
+    sc->oc = sp->oc;
+    sc->after_number = sp->after_number;
+    sc->l_comment = sp->l_comment;
+    if (sp->l_nest != 0)
+        sc->l_nest = sp->l_nest + line - 1;
+    if (sp->l_cend != 0)
+        sc->l_cend = sp->l_cend + line - 1;
+    sc->quote = sp->quote;
+    sc->quote_msg = sp->quote_msg;
+    sc->raw_line = sp->raw_line + line - 1;
+    sc->raw_marklen = sp->raw_marklen;
+    memcpy(sc->raw_mark, sp->raw_mark, sizeof(sc->raw_mark));
+    sc->src.pos = cp->end;
+}
+
+int scc_strip_parallel(Scanner *sc, const char *name, const char *in, size_t len,
+                       const SCC_Sink *sink, int nthreads, size_t chunk_size)
+{
+    if (chunk_size == 0)
+        chunk_size = CHUNK_SIZE;
+    if (nthreads < 2 || len / 2 < chunk_size || sink->map != 0 || sc->comments != 0)
+        return scc_strip(sc, name, in, len, sink);
+    SCC_Stats plain = { 0 };
+    if (plain_input(sc, in, len, &plain))
+        return strip_buffer(sc, name, in, len, sink, &plain);
+
+    /* Divide the input into chunks ending with a newline not preceded by a backslash */
+    ChunkPool pool = { .master = sc, .base = in };
+    size_t max_chunks = len / chunk_size + 1;
+    if ((pool.chunks = calloc(max_chunks, sizeof(*pool.chunks))) == 0)
+        return -1;
+    size_t start = 0;
+    while (start < len)
+    {
+        size_t end = start + chunk_size;
+        const char *nl = 0;
+        while (end < len && (nl = memchr(in + end, '\n', len - end)) != 0)
+        {
+            end = (size_t)(nl - in) + 1;
+            if (in[end - 2] != '\\')
+                break;
+        }
+        if (end >= len || nl == 0 || pool.num_chunks == max_chunks - 1)
+            end = len;
+        pool.chunks[pool.num_chunks].start = start;
+        pool.chunks[pool.num_chunks].end = end;
+        pool.num_chunks++;
+        start = end;
+    }
+    pool.num_tasks = 1 + (pool.num_chunks - 1) * NUM_SPECS;
+    pool.window = CHUNK_WINDOW * (size_t)nthreads;
+
+    scan_begin(sc, name, sink);
+    sc->src.base = in;
+    sc->in_total = len;
+    sc->in_last = in[len - 1];
+    if (sink->writev != 0)
+        sc->zc_limit = in + len;
+    pthread_mutex_init(&pool.lock, 0);
+    pthread_cond_init(&pool.cond, 0);
+    pthread_t threads[nthreads];
+    int nstarted = 0;
+    while (nstarted < nthreads && pthread_create(&threads[nstarted], 0, chunk_worker, &pool) == 0)
+        nstarted++;
+
+    int line = 1;
+    for (size_t k = 0; k < pool.num_chunks; k++)
+    {
+        Chunk *cp = &pool.chunks[k];
+        int entry = -1;
+        if (nstarted > 0)
+        {
+            /* l_comment only matters with -c */
+            if (sc->state == NonComment && (!sc->l_comment || !sc->opt.cflag))
+                entry = SPEC_CODE;
+            else if (sc->state == CComment && k > 0)
+                entry = SPEC_COMMENT;
+        }
+        if (entry >= 0)
+        {
+            pthread_mutex_lock(&pool.lock);
+            while (!cp->spec[entry].done)
+                pthread_cond_wait(&pool.cond, &pool.lock);
+            pthread_mutex_unlock(&pool.lock);
+            spec_apply(sc, cp, &cp->spec[entry], line);
+        }
+        else
+        {
+            /* Scan sequentially, from where the previous chunk stopped */
+            sc->src.len = cp->end;
+            sc->src.final = (k == pool.num_chunks - 1);
+            scan_buffer(sc);
+        }
+        line += (int)scc_count_newlines(in + cp->start, in + cp->end);
+        sc->src.lpos = cp->end;
+        sc->src.lline = line;
+
+        pthread_mutex_lock(&pool.lock);
+        for (int i = 0; i < NUM_SPECS && nstarted > 0; i++)
+        {
+            while ((k > 0 || i == SPEC_CODE) && !cp->spec[i].done)
+                pthread_cond_wait(&pool.cond, &pool.lock);
+        }
+        pool.next_chunk++;
+        pthread_cond_broadcast(&pool.cond);
+        pthread_mutex_unlock(&pool.lock);
+        for (int i = 0; i < NUM_SPECS; i++)
+            spec_free(&cp->spec[i]);
+    }
+
+    for (int i = 0; i < nstarted; i++)
+        pthread_join(threads[i], 0);
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.chunks);
+    return scan_end(sc);
+}
+
+int scc_std_code(const char *name)
+{
+    size_t len = strlen(name);
+    char upper[len + 1];
+    for (size_t i = 0; i < len; i++)
+        upper[i] = toupper((unsigned char)name[i]);
+    upper[len] = '\0';
+    for (size_t i = 0; i < NUM_STDNAMES; i++)
+    {
+        if (strcmp(upper, std_name[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const char *scc_std_name(int std_code)
+{
+    if (std_code < 0 || std_code >= NUM_STDNAMES)
+        return 0;
+    return std_name[std_code];
+}
+
+unsigned scc_std_features(int std_code)
+{
+    if (scc_std_name(std_code) == 0)
+        return 0;
+    return feature_set[std_feature_set[std_code]].features;
+}
+
+void scc_options_init(SCC_Options *opts)
+{
+    *opts = (SCC_Options){ .std_code = C18 };
+}
+
+Scanner *scc_create(const SCC_Options *opts)
+{
+    SCC_Options defaults;
+    if (opts == 0)
+    {
+        scc_options_init(&defaults);
+        opts = &defaults;
+    }
+    if (scc_std_name(opts->std_code) == 0)
+    {
+        errno = EINVAL;
+        return 0;
+    }
+    Scanner *sc = calloc(1, sizeof(*sc));
+    if (sc == 0)
+        return 0;
+    sc->opt = *opts;
+    sc->features = feature_set[std_feature_set[opts->std_code]].features;
+    sc->scan = feature_set[std_feature_set[opts->std_code]].scan;
+    scc_skip_init();
+    return sc;
+}
+
+void scc_get_options(const Scanner *sc, SCC_Options *opts)
+{
+    *opts = sc->opt;
+}
+
+int scc_set_std(Scanner *sc, int std_code)
+{
+    if (scc_std_name(std_code) == 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    sc->opt.std_code = std_code;
+    sc->features = feature_set[std_feature_set[std_code]].features;
+    sc->scan = feature_set[std_feature_set[std_code]].scan;
+    return 0;
+}
+
+void scc_get_stats(const Scanner *sc, SCC_Stats *stats)
+{
+    *stats = sc->stats;
+}
+
+void scc_reset_stats(Scanner *sc)
+{
+    sc->stats = (SCC_Stats){ 0 };
+}
+
+void scc_add_stats(SCC_Stats *total, const SCC_Stats *stats)
+{
+    total->inputs += stats->inputs;
+    total->plain += stats->plain;
+    total->bytes_in += stats->bytes_in;
+    total->bytes_out += stats->bytes_out;
+    total->lines += stats->lines;
+    total->c_comments += stats->c_comments;
+    total->c_comment_bytes += stats->c_comment_bytes;
+    total->cpp_comments += stats->cpp_comments;
+    total->cpp_comment_bytes += stats->cpp_comment_bytes;
+    total->strings += stats->strings;
+    total->chars += stats->chars;
+    total->raw_strings += stats->raw_strings;
+    for (int i = 0; i < SCC_NUM_RADICES; i++)
+        total->numbers[i] += stats->numbers[i];
+    for (int i = 0; i < SCC_NUM_WARNINGS; i++)
+        total->warnings[i] += stats->warnings[i];
+}
+
+const char *scc_warning_name(int type)
+{
+    static const char *const names[SCC_NUM_WARNINGS] =
+    {
+        [SCC_W_FEATURE] = "feature",    [SCC_W_COMMENT] = "comment",
+        [SCC_W_LITERAL] = "literal",    [SCC_W_RAWMARK] = "rawmark",
+        [SCC_W_NUMBER]  = "number",     [SCC_W_UCN]     = "ucn",
+    };
+    return (type >= 0 && type < SCC_NUM_WARNINGS) ? names[type] : 0;
+}
+
+const char *scc_radix_name(int radix)
+{
+    static const char *const names[SCC_NUM_RADICES] =
+    {
+        [SCC_R_DECIMAL] = "decimal",    [SCC_R_OCTAL]   = "octal",
+        [SCC_R_HEX]     = "hex",        [SCC_R_BINARY]  = "binary",
+    };
+    return (radix >= 0 && radix < SCC_NUM_RADICES) ? names[radix] : 0;
+}
+
+void scc_destroy(Scanner *sc)
+{
+    if (sc != 0)
+    {
+        if (sc->whisp_fp != 0)
+            fclose(sc->whisp_fp);
+        free(sc->whisp);
+        free(sc->sbuf);
+        scc_destroy(sc->comments);
+        free(sc);
+    }
+}
+
+int scc_set_comment_sink(Scanner *sc, const SCC_Sink *sink)
+{
+    if (sink == 0)
+    {
+        scc_destroy(sc->comments);
+        sc->comments = 0;
+        return 0;
+    }
+    if (sc->opt.cflag)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (sc->comments == 0)
+    {
+        SCC_Options opts = sc->opt;
+        opts.cflag = true;
+        if ((sc->comments = scc_create(&opts)) == 0)
+            return -1;
+    }
+    sc->comments->sink = *sink;
+    sc->comments->sink.diag = 0;
+    sc->comments->sink.map = 0;
+    return 0;
+}
+
+#ifdef TEST
+
+/*
+** Test program
+** -- strips each named file with every standard and a variety of
+**    options, and checks that stripping it in parallel chunks, and
+**    streaming it in pieces (with normal and with tiny limits on the
+**    memory used), of various sizes produces exactly the same output
+**    and warnings as stripping it in one piece.  Streaming never
+**    takes the short cut for inputs that need no change, so it also
+**    checks the pre-scan.  The statistics of each run must match too.
+**    The code and the comments output from one scan (with a sink for
+**    the comments) must match separate runs without and with -c.
+*/
+
+typedef struct Capture
+{
+    char   *buffer;
+    size_t  len;
+    size_t  size;
+} Capture;
+
+static void cap_add(Capture *cp, const char *str, size_t len)
+{
+    if (cp->len + len > cp->size)
+    {
+        cp->size = (cp->len + len) * 2;
+        if ((cp->buffer = realloc(cp->buffer, cp->size)) == 0)
+        {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(cp->buffer + cp->len, str, len);
+    cp->len += len;
+}
+
+static int cap_write(void *data, const char *buffer, size_t len)
+{
+    cap_add(data, buffer, len);
+    return 0;
+}
+
+static int cap_writev(void *data, const struct iovec *iov, int iovcnt)
+{
+    for (int i = 0; i < iovcnt; i++)
+        cap_add(data, iov[i].iov_base, iov[i].iov_len);
+    return 0;
+}
+
+static void cap_diag(void *data, const char *name, int line, const char *msg)
+{
+    char buffer[BUFSIZ];
+    int len = snprintf(buffer, sizeof(buffer), "<<%s:%d: %s>>\n", name, line, msg);
+    cap_add(data, buffer, (size_t)len);
+}
+
+static const char *read_file(const char *file, size_t *len)
+{
+    Capture data = { 0, 0, 0 };
+    FILE *fp = fopen(file, "rb");
+    char buffer[BUFSIZ];
+    size_t nbytes;
+    if (fp == 0)
+    {
+        perror(file);
+        exit(EXIT_FAILURE);
+    }
+    while ((nbytes = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        cap_add(&data, buffer, nbytes);
+    fclose(fp);
+    *len = data.len;
+    return data.buffer;
+}
+
+/* Counts from the last input, other than those of inputs handled */
+static SCC_Stats last_stats(SCC_Scanner *sc)
+{
+    SCC_Stats stats;
+    scc_get_stats(sc, &stats);
+    scc_reset_stats(sc);
+    stats.inputs = 0;
+    stats.plain = 0;
+    return stats;
+}
+
+static const char *const flag_sets[] = { "", "c", "n", "cn", "t", "ct", "ew", "cew", "sq" };
+enum { NUM_FLAG_SETS = sizeof(flag_sets) / sizeof(flag_sets[0]) };
+static const size_t pieces[] = { 1, 2, 3, 7, 64, 4093 };
+enum { NUM_PIECES = sizeof(pieces) / sizeof(pieces[0]) };
+
+static int check_file(const char *file)
+{
+    size_t len;
+    const char *data = read_file(file, &len);
+    int fail = 0;
+    int count = 0;
+    size_t plain = 0;
+
+    for (int std = 0; std < NUM_STDNAMES; std++)
+    {
+        for (int f = 0; f < NUM_FLAG_SETS; f++)
+        {
+            SCC_Options opts;
+            scc_options_init(&opts);
+            opts.std_code = std;
+            opts.cflag = strchr(flag_sets[f], 'c') != 0;
+            opts.eflag = strchr(flag_sets[f], 'e') != 0;
+            opts.nflag = strchr(flag_sets[f], 'n') != 0;
+            opts.tflag = strchr(flag_sets[f], 't') != 0;
+            opts.wflag = strchr(flag_sets[f], 'w') != 0;
+            opts.qchar = strchr(flag_sets[f], 'q') != 0 ? 'Q' : 0;
+            opts.schar = strchr(flag_sets[f], 's') != 0 ? 'S' : 0;
+            SCC_Scanner *sc = scc_create(&opts);
+            Capture whole = { 0, 0, 0 };
+            SCC_Sink sink = { .write = cap_write, .diag = cap_diag, .data = &whole };
+            scc_strip(sc, file, data, len, &sink);
+            plain += sc->stats.plain;
+            SCC_Stats whole_stats = last_stats(sc);
+            for (int p = -1; p < NUM_PIECES; p++)
+            {
+                /* Alternately with and without zero-copy output */
+                Capture part = { 0, 0, 0 };
+                SCC_Sink psink = { .write = cap_write, .diag = cap_diag, .data = &part,
+                                   .writev = (p % 2 == 0) ? 0 : cap_writev };
+                if (p < 0)
+                    scc_strip(sc, file, data, len, &psink);
+                else
+                    scc_strip_parallel(sc, file, data, len, &psink, 3, pieces[p] * 4);
+                count++;
+                SCC_Stats part_stats = last_stats(sc);
+                if (part.len != whole.len || (whole.len > 0 && memcmp(part.buffer, whole.buffer, whole.len) != 0) ||
+                    memcmp(&part_stats, &whole_stats, sizeof(whole_stats)) != 0)
+                {
+                    printf("!! FAIL !! %s -S %s -%s: chunks of %zu\n",
+                           file, std_name[std], flag_sets[f], (p < 0) ? len : pieces[p] * 4);
+                    fail++;
+                }
+                free(part.buffer);
+            }
+            for (int p = 0; p < 2 * NUM_PIECES; p++)
+            {
+                /* Second time round, with tiny limits on lines and white space */
+                size_t piece = pieces[p % NUM_PIECES];
+                bool tight = (p >= NUM_PIECES);
+                Capture part = { 0, 0, 0 };
+                sink.data = &part;
+                scc_stream_begin(sc, file, &sink);
+                if (tight)
+                {
+                    sc->sbuf_line = 8;
+                    sc->whisp_max = 4;
+                }
+                for (size_t off = 0; off < len; off += piece)
+                {
+                    size_t nbytes = (len - off < piece) ? len - off : piece;
+                    scc_stream_write(sc, data + off, nbytes);
+                }
+                scc_stream_end(sc);
+                count++;
+                SCC_Stats part_stats = last_stats(sc);
+                if (part.len != whole.len || (whole.len > 0 && memcmp(part.buffer, whole.buffer, whole.len) != 0) ||
+                    memcmp(&part_stats, &whole_stats, sizeof(whole_stats)) != 0)
+                {
+                    printf("!! FAIL !! %s -S %s -%s: pieces of %zu%s\n",
+                           file, std_name[std], flag_sets[f], piece, tight ? " (tight)" : "");
+                    fail++;
+                }
+                free(part.buffer);
+            }
+            if (!opts.cflag)
+            {
+                /* The code and the comments from one scan, whole and streamed */
+                SCC_Options copts = opts;
+                copts.cflag = true;
+                SCC_Scanner *csc = scc_create(&copts);
+                Capture comments = { 0, 0, 0 };
+                SCC_Sink csink = { .write = cap_write, .data = &comments };
+                scc_strip(csc, file, data, len, &csink);
+                scc_destroy(csc);
+                for (int p = -1; p < NUM_PIECES; p++)
+                {
+                    Capture code = { 0, 0, 0 };
+                    Capture part = { 0, 0, 0 };
+                    SCC_Sink psink = { .write = cap_write, .diag = cap_diag, .data = &code,
+                                       .writev = (p % 2 == 0) ? 0 : cap_writev };
+                    SCC_Sink pcsink = { .write = cap_write, .diag = cap_diag, .data = &part,
+                                        .writev = (p % 2 == 0) ? cap_writev : 0 };
+                    scc_set_comment_sink(sc, &pcsink);
+                    if (p < 0)
+                        scc_strip(sc, file, data, len, &psink);
+                    else
+                    {
+                        scc_stream_begin(sc, file, &psink);
+                        for (size_t off = 0; off < len; off += pieces[p])
+                        {
+                            size_t nbytes = (len - off < pieces[p]) ? len - off : pieces[p];
+                            scc_stream_write(sc, data + off, nbytes);
+                        }
+                        scc_stream_end(sc);
+                    }
+                    scc_set_comment_sink(sc, 0);
+                    count++;
+                    if (code.len != whole.len || (whole.len > 0 && memcmp(code.buffer, whole.buffer, whole.len) != 0) ||
+                        part.len != comments.len ||
+                        (comments.len > 0 && memcmp(part.buffer, comments.buffer, comments.len) != 0))
+                    {
+                        printf("!! FAIL !! %s -S %s -%s: code and comments, pieces of %zu\n",
+                               file, std_name[std], flag_sets[f], (p < 0) ? len : pieces[p]);
+                        fail++;
+                    }
+                    free(code.buffer);
+                    free(part.buffer);
+                }
+                free(comments.buffer);
+            }
+            free(whole.buffer);
+            scc_destroy(sc);
+        }
+    }
+    if (fail == 0)
+        printf("== PASS == %s (%d cases, %zu unchanged)\n", file, count, plain);
+    free((void *)data);
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    int fail = 0;
+    for (int c = 0; c <= UCHAR_MAX; c++)
+    {
+        if ((lex_class[c] != LC_PLAIN) != scc_skip_code_stop[c])
+        {
+            printf("!! FAIL !! lex_class[%d] does not match scc_skip_code_stop[%d]\n", c, c);
+            fail++;
+        }
+    }
+    for (int c = EOF; c <= UCHAR_MAX; c++)
+    {
+        /* The test runs in the C locale */
+        if (is_idchar(c) != (isalnum(c) || c == '_') || is_alpha(c) != (isalpha(c) != 0) ||
+            is_digit(c) != (isdigit(c) != 0) || is_xdigit(c) != (isxdigit(c) != 0) ||
+            is_octal(c) != (c >= '0' && c <= '7') || is_binary(c) != (c == '0' || c == '1') ||
+            is_blank(c) != (isblank(c) != 0))
+        {
+            printf("!! FAIL !! char_class[%d + 1] does not match <ctype.h>\n", c);
+            fail++;
+        }
+    }
+    for (int i = 1; i < argc; i++)
+        fail += check_file(argv[i]);
+    return (fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* TEST */
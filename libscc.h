@@ -0,0 +1,237 @@
+/*
+@(#)File:           $RCSfile: libscc.h,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/16 23:20:00 $
+@(#)Purpose:        Library interface to SCC (Strip C/C++ Comments)
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+@(#)Product:        SCC Version 8.0.3 (2022-05-30)
+*/
+
+/*TABSTOP=4*/
+
+#ifndef LIBSCC_H_INCLUDED
+#define LIBSCC_H_INCLUDED
+
+#ifdef MAIN_PROGRAM
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_libscc_h[];
+const char jlss_id_libscc_h[] = "@(#)$Id: libscc.h,v 1.1 2026/10/16 23:20:00 jleffler Exp $";
+#endif /* lint */
+#endif /* MAIN_PROGRAM */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/*
+** Revision of the results: raised whenever the output or the warnings
+** for some input can change, so that results kept from an earlier
+** revision (such as by scc --cache) are not taken for current ones.
+*/
+enum { SCC_REVISION = 1 };
+
+/*
+** Options - each member corresponds to an option of the scc command.
+** Use scc_options_init() to set the defaults before changing members.
+*/
+typedef struct SCC_Options
+{
+    int  std_code;  /* -S std: language standard (from scc_std_code()) */
+    bool cflag;     /* -c: print comments and not code */
+    bool eflag;     /* -e: print empty comment instead of blank */
+    bool nflag;     /* -n: keep newlines in comments */
+    bool tflag;     /* -t: keep white space before/after comments */
+    bool wflag;     /* -w: warn about nested C-style comments */
+    int  qchar;     /* -q rep: replacement for body of quotes, or 0 */
+    int  schar;     /* -s rep: replacement for body of strings, or 0 */
+} SCC_Options;
+
+/*
+** Where the results go.  The write function is given the output in
+** blocks (of no particular size); it returns 0 on success and -1 on
+** failure, after which no more output is written.  The diag function
+** is given each warning about the input, with the name of the input
+** and the line number; it may be null, in which case warnings are
+** discarded.  All the output preceding the point of a warning has
+** been written when diag is called.
+**
+** The writev function is optional (null if not wanted).  If present,
+** scc_strip() and scc_strip_parallel() use it as well as write, and
+** output that is identical to long stretches of the input is passed
+** as iovecs pointing into the input rather than being copied; other
+** iovecs point to internal buffers, valid only during the call.  It
+** returns 0 on success and -1 on failure, like write.
+**
+** Members are only added at the end of the structure, and each
+** addition is a new major version of the shared library (its soname,
+** libscc.so.N), since a program built with fewer members would pass a
+** shorter structure.  Unused members must be null.
+**
+** The map function is optional too.  If present, it is given a source
+** map of the output: each call says that the output from out_line,
+** out_col onwards comes character for character from the input at
+** in_line, in_col onwards, up to the point of the next call.  Lines are
+** numbered from 1 and columns (in bytes) from 0.  A point is reported
+** at the start of the output and wherever the correspondence changes,
+** so an input that is copied unchanged has one.  The white space that
+** replaces a comment, and the replacements for the bodies of literals
+** (-q, -s) and for comments (-e), follow the nearest point.  After all
+** the output, a last call gives the ends of the output and the input.
+** The calls precede the output they describe, and scc_strip_parallel()
+** scans on one thread when there is a map function.
+**
+** The flags are SCC_SINK_* values, or 0.  With SCC_SINK_UNORDERED, the
+** output preceding a warning need not have been written when diag is
+** called: for a sink that collects the warnings and reports them after
+** the output, this saves writing the output piecemeal, once for each
+** warning.
+*/
+typedef struct SCC_Sink
+{
+    int  (*write)(void *data, const char *buffer, size_t len);
+    void (*diag)(void *data, const char *name, int line, const char *msg);
+    void  *data;
+    int  (*writev)(void *data, const struct iovec *iov, int iovcnt);
+    void (*map)(void *data, int out_line, size_t out_col, int in_line, size_t in_col);
+    unsigned flags;
+} SCC_Sink;
+
+/* Flags of a sink (SCC_Sink.flags) */
+enum
+{
+    SCC_SINK_UNORDERED = 0x01,  /* Warnings need not follow the output before them */
+};
+
+/* Features recognized by a standard - see scc_std_features() */
+enum
+{
+    SCC_F_DOUBLESLASH = 0x01,   /* // comments */
+    SCC_F_RAWSTRING   = 0x02,   /* Raw strings R"ZZ(string)ZZ" */
+    SCC_F_UNICODE     = 0x04,   /* Unicode strings (u"A", U"A", u8"A") */
+    SCC_F_BINARY      = 0x08,   /* Binary constants 0b0101 */
+    SCC_F_HEXFLOAT    = 0x10,   /* Hexadecimal floats 0x2.34P-12 */
+    SCC_F_NUMPUNCT    = 0x20,   /* Numeric punctuation 0x1234'5678 */
+    SCC_F_UNIVERSAL   = 0x40,   /* Universal character names \uXXXX and \UXXXXXXXX */
+};
+
+typedef struct Scanner SCC_Scanner;
+
+/* Standard code for name (case-insensitive: C18, c++17, ...), or -1 */
+extern int scc_std_code(const char *name);
+/* Canonical name of standard code, or null if the code is invalid */
+extern const char *scc_std_name(int std_code);
+/* Features (SCC_F_* bits) of standard code; 0 if the code is invalid */
+extern unsigned scc_std_features(int std_code);
+
+extern void scc_options_init(SCC_Options *opts);
+
+/*
+** Create a scanner with the given options (null for the defaults).
+** Returns null with errno set on failure (EINVAL for an invalid
+** standard).  A scanner can be reused for any number of inputs, one
+** at a time; separate scanners can be used concurrently.
+*/
+extern SCC_Scanner *scc_create(const SCC_Options *opts);
+extern void scc_destroy(SCC_Scanner *sc);
+/* Options in use, including any change of standard */
+extern void scc_get_options(const SCC_Scanner *sc, SCC_Options *opts);
+/* Change the standard used for the next input; -1 with errno EINVAL if invalid */
+extern int scc_set_std(SCC_Scanner *sc, int std_code);
+
+/* Kinds of warning, as counted in SCC_Stats - see scc_warning_name() */
+enum
+{
+    SCC_W_FEATURE,      /* Feature not supported by the standard */
+    SCC_W_COMMENT,      /* Nested or unterminated comment, stray end marker */
+    SCC_W_LITERAL,      /* Newline or EOF in a literal */
+    SCC_W_RAWMARK,      /* Invalid raw string delimiter */
+    SCC_W_NUMBER,       /* Malformed number */
+    SCC_W_UCN,          /* Invalid universal character name */
+    SCC_NUM_WARNINGS
+};
+
+/* Radix of numeric literals, as counted in SCC_Stats - see scc_radix_name() */
+enum { SCC_R_DECIMAL, SCC_R_OCTAL, SCC_R_HEX, SCC_R_BINARY, SCC_NUM_RADICES };
+
+/*
+** Counts accumulated by a scanner over all the inputs it has handled.
+** Comment text includes the delimiters (but not the newline ending a
+** C++ comment); a lone 0 counts as a decimal number.
+*/
+typedef struct SCC_Stats
+{
+    size_t inputs;      /* Inputs stripped */
+    size_t plain;       /* Inputs that needed no change and were copied without scanning */
+    size_t bytes_in;
+    size_t bytes_out;
+    size_t lines;       /* Newlines, plus any final line without one */
+    size_t c_comments;
+    size_t c_comment_bytes;
+    size_t cpp_comments;
+    size_t cpp_comment_bytes;
+    size_t strings;     /* String literals, other than raw strings */
+    size_t chars;       /* Character constants */
+    size_t raw_strings;
+    size_t numbers[SCC_NUM_RADICES];
+    size_t warnings[SCC_NUM_WARNINGS];
+} SCC_Stats;
+
+extern void scc_get_stats(const SCC_Scanner *sc, SCC_Stats *stats);
+extern void scc_reset_stats(SCC_Scanner *sc);
+/* Add the counts in stats to those in total */
+extern void scc_add_stats(SCC_Stats *total, const SCC_Stats *stats);
+/* Short names (feature, number, ...; decimal, hex, ...), or null if invalid */
+extern const char *scc_warning_name(int type);
+extern const char *scc_radix_name(int radix);
+
+/*
+** Send the comments of each input to sink as well as the code to the
+** sink given for the input, from the same scan: the output that a
+** scanner with the same options and -c would produce.  Warnings and
+** the map go with the code only; the diag and map functions of sink
+** are not used.  Call between inputs; a null sink stops it.  Returns 0
+** on success, or -1 with errno set (EINVAL if the scanner prints the
+** comments (-c) itself).  scc_strip_parallel() scans on one thread
+** while there is a sink for the comments.
+*/
+extern int scc_set_comment_sink(SCC_Scanner *sc, const SCC_Sink *sink);
+
+/*
+** Strip the complete input in[0..len-1], sending the results to sink.
+** The name is only used in diagnostics.  Returns 0 on success; -1 with
+** errno set if the sink failed or memory ran out.  An input that a
+** quick pre-scan shows to need no change under the options (no
+** comments, quotes, backslashes, doubtful numbers or trailing white
+** space, and a final newline) is passed to the sink as it is.
+*/
+extern int scc_strip(SCC_Scanner *sc, const char *name, const char *in,
+                     size_t len, const SCC_Sink *sink);
+
+/*
+** As scc_strip(), but a large input is divided into chunks of about
+** chunk_size bytes (0 for the default) that are scanned by up to
+** nthreads threads at once.  Each chunk is scanned speculatively for
+** each state it could start in, and the results are stitched together
+** so that the output and warnings are identical to scc_strip().
+*/
+extern int scc_strip_parallel(SCC_Scanner *sc, const char *name, const char *in,
+                              size_t len, const SCC_Sink *sink, int nthreads,
+                              size_t chunk_size);
+
+/*
+** Streaming: scc_stream_begin(), then scc_stream_write() for each
+** piece of the input in turn (pieces may split lines or tokens at any
+** point), then scc_stream_end().  The output is identical to calling
+** scc_strip() on the concatenated input; it is produced a line or so
+** behind the input.  The memory used is bounded however long the input
+** or its lines are; a very long run of white space whose fate is not
+** yet known is held in a temporary file.  Each function returns 0 on
+** success and -1 with errno set on failure.
+*/
+extern int scc_stream_begin(SCC_Scanner *sc, const char *name, const SCC_Sink *sink);
+extern int scc_stream_write(SCC_Scanner *sc, const char *data, size_t len);
+extern int scc_stream_end(SCC_Scanner *sc);
+
+#endif /* LIBSCC_H_INCLUDED */
@@ -2,7 +2,7 @@
 @(#)File:           $RCSfile: scc.c,v $
 @(#)Version:        $Revision: 8.3 $
 @(#)Last changed:   $Date: 2022/05/30 01:02:22 $
-@(#)Purpose:        Strip C comments
+@(#)Purpose:        Strip C comments - command line interface
 @(#)Author:         J Leffler
 @(#)Copyright:      (C) JLSS 1991-2022
 */
@@ -14,164 +14,453 @@
 **  single space.  It will be used as part of a formatting pipeline
 **  for checking the equivalence of C code.
 **
-**  If the code won't compile, it is unwise to use this tool to modify
-**  it.  It assumes that the code is syntactically correct.
-**
-**  Note that backslashes at the end of a line can extend even a C++
-**  style comment over several lines.  It matters not whether there is
-**  one backslash or several -- the line splicing (logically) takes
-**  place before any other tokenisation.
-**
-**  The -s option was added to simplify the analysis of C++ keywords.
-**  After stripping comments, keywords appearing in (double quoted)
-**  strings should be ignored too, so a replacement character such as X
-**  works.  Without that, the command has to recognize C comments to
-**  know whether the unmatched quotes in them matter (they shouldn't).
-**  The -q option was added for symmetry with -s.
-**
-**  Digraphs do not present a problem; the characters they represent do
-**  not need special handling.  Trigraphs do present a problem in theory
-**  because ??/ is an encoding for backslash.  However, this program
-**  ignores trigraphs altogether - calling upon GCC for precedent, and
-**  noting that C++14 has deprecated trigraphs.  The JLSS programs
-**  digraphs and trigraphs can manipulate (encode, decode) digraphs and
-**  trigraphs.  This more of a theoretical problem than a practical one.
-**
-**  C++14 adds quotes inside numeric literals: 10'000'000 for 10000000,
-**  10'000 for 10000, etc.  Unfortunately, that means SCC has to
-**  recognize literal values fully, because these can appear in hex too:
-**  0xFFFF'ABCD.  C++14 also adds binary constants: 0b0001'1010 (b or
-**  B).  (See N3797 for draft C++14 standard.)
-**
-**  C++11 raw strings are another problem: R"x(...)x" is not bound to
-**  have a close quote by end of line.  (The parentheses are mandatory;
-**  the x's are optional and are not limited to a single character (but
-**  must not be more than 16 characters long), but must match.  The
-**  replacable portion (for -s) is the '...' in between parentheses.)
-**  C++11 also has encoding prefixes u8, u, U, L which can preceded the
-**  R of a R string.  Note that within a raw string, there are no
-**  trigraphs.
-**
-**  Hence we add -S <std> for standards C++98, C++03, C++11, C++14,
-**  C++17, C89, C90, C99, C11, C18.  For the purposes of this code,
-**  C++98 and C++03 are identical, C89 and C90 are identical, and C99,
-**  C11 and C18 are identical.  The default is C18.
-**
-**  C11 and C++11 add support for u"literal", U"literal", u8"literal",
-**  and for u'char' and U'char' (but not u8'char').  Previously, the
-**  code needed no special handling for wide character strings L"x" or
-**  constants L'x', but now they have to be handled appropriately.
-**
-**  Note that comment stripping does not require 100% accurate
-**  tokenization.  For example, C++11 and later supports user-defined
-**  literals such as 1.234_km; it does not matter that SCC treats that
-**  as a number and an identifier, but a program that formally tokenizes
-**  C++ must recognize them.
+**  The scanning is done by the SCC library (libscc.h, libscc.c); this
+**  file deals with the command line, reads each file into memory and
+**  sends the results to standard output and the warnings to standard
+**  error.
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* vmsplice(), copy_file_range() */
+#endif /* __linux__ */
+
 #include "posixver.h"
-#include <assert.h>
-#include <ctype.h>
-#include <limits.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif /* __linux__ */
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 #include "filter.h"
+#include "libscc.h"
 #include "scc-version.h"
+#include "scccache.h"
+#include "sccserve.h"
 #include "stderr.h"
 
-typedef enum { NonComment, CComment, CppComment } Comment;
+enum { RD_BLOCKSIZE = 64 * 1024 };
 
-typedef enum
+/* Contents of the current file - mapped or read into rd_buffer */
+typedef struct Source
 {
-    C, C89, C90, C94, C99, C11, C18,
-    CXX, CXX98, CXX03, CXX11, CXX14, CXX17
-} Standard;
+    const char *base;       /* Start of input data */
+    size_t      len;        /* Number of bytes of input data */
+    void       *map;        /* Start of memory mapping, or null */
+    size_t      maplen;     /* Length of memory mapping */
+    char       *rd_buffer;  /* Input buffer for unmappable files */
+    size_t      rd_size;
+} Source;
 
-enum { MAX_RAW_MARKER = 16 };
-enum { LPAREN = '(', RPAREN = ')' };
+/*
+** Standard output, written with write(2) and writev(2) when a mapped
+** file is stripped, so that unchanged stretches of the file are not
+** copied into a buffer.  Long stretches are left to the kernel instead
+** where it can do better: when standard output is a regular file,
+** copy_file_range(2) copies from the input file without passing through
+** user space.  With --zero-copy, when it is a pipe, vmsplice(2) puts
+** references to the pages of the file into the pipe, and when it is a
+** socket, sendfile(2) does much the same; the reader then gets the
+** pages as they are when it reads them, not as they were when scc wrote
+** them, so this is only safe if the input files are not modified while
+** the output is in transit.  A file that needs no change at all is
+** written this way in one piece.  If the kernel refuses, the next
+** method is tried, down to plain writev(2).
+*/
+typedef enum { KC_NONE, KC_SENDFILE, KC_COPY_RANGE, KC_VMSPLICE } KernelCopy;
 
-static const char std_name[][6] =
+typedef struct Output
 {
-    [C]     = "C",      // Current C standard (C18)
-    [CXX]   = "C++",    // Current C++ standard (C++17)
-    [C89]   = "C89",
-    [C90]   = "C90",
-    [C94]   = "C94",
-    [C99]   = "C99",
-    [C11]   = "C11",
-    [C18]   = "C18",
-    [CXX98] = "C++98",
-    [CXX03] = "C++03",
-    [CXX11] = "C++11",
-    [CXX14] = "C++14",
-    [CXX17] = "C++17",
-};
-enum { NUM_STDNAMES = sizeof(std_name) / sizeof(std_name[0]) };
-
-enum Feature { F_HEXFLOAT, F_RAWSTRING, F_DOUBLESLASH, F_UNICODE, F_BINARY, F_NUMPUNCT, F_UNIVERSAL };
-static const char *feature_name[] =
-{
-    [F_HEXFLOAT]    = "Hexadecimal floating point constant",
-    [F_RAWSTRING]   = "Raw string",
-    [F_DOUBLESLASH] = "Double slash comment",
-    [F_UNICODE]     = "Unicode character or string",
-    [F_BINARY]      = "Binary literal",
-    [F_NUMPUNCT]    = "Numeric punctuation",
-    [F_UNIVERSAL]   = "Universal character name",
-};
+    int         fd;
+    KernelCopy  kcopy;      /* Method for long stretches of mapped input */
+    int         in_fd;      /* Mapped input */
+    const char *map_lo;
+    const char *map_hi;
+} Output;
+
+/*
+** In-place mode (-i[suffix]).  The output is compared with the input as
+** it is produced, and nothing is written while it matches; unchanged
+** stretches passed as iovecs pointing at the same place in the input
+** are not even compared.  At the first difference, a temporary file is
+** created in the same directory and the matching part and the rest of
+** the output are written to it, with long stretches of the input copied
+** by the kernel as for standard output.  At the end the temporary file
+** is synced (--fsync), given the owner and mode of the original and
+** renamed over it, after the original is linked to its backup name if
+** there is a suffix.  A file whose output is identical to it is not
+** touched at all, so its modification time does not change.  A symbolic
+** link is resolved, and the file it refers to is replaced (and backed
+** up) in its own directory, so the link still refers to it.
+*/
+typedef struct InPlace
+{
+    const char *name;
+    char       *path;       /* Name of the file replaced, if name is a symbolic link */
+    const char *in;         /* Original contents */
+    size_t      in_len;
+    size_t      same;       /* Output so far, all identical to the input */
+    struct stat st;         /* Original file */
+    Output      out;        /* Temporary file, once created (fd >= 0) */
+    char       *tmp;        /* Name of the temporary file */
+    int         error;      /* Error number of first failure, or 0 */
+    const char *failed;     /* What failed */
+    SCC_Sink    next;       /* Where the warnings go */
+} InPlace;
+
+/*
+** The warnings about a file are collected and reported together when
+** it is done, after its output, so the warnings about files stripped in
+** parallel come in order and are never interleaved.
+** Each distinct message is kept once for the file, and a warning is a
+** line number and the index of its message.  With --max-warnings, a
+** warning repeated on the same line is dropped, only so many are kept
+** for each file and written in all, and the rest are counted in a
+** summary.
+*/
+typedef struct DiagEntry
+{
+    int         line;
+    size_t      text;       /* Index of the message in texts */
+} DiagEntry;
+
+typedef struct DiagSet
+{
+    const char *name;       /* Input named in the warnings */
+    char      **texts;      /* Distinct messages */
+    size_t      num_texts;
+    size_t      max_texts;
+    size_t     *slots;      /* Hash table of texts: index + 1, or 0 if free */
+    size_t      num_slots;
+    DiagEntry  *entries;
+    size_t      num_entries;
+    size_t      max_entries;
+    size_t      dropped;    /* Warnings beyond the limit for a file */
+    int         drop_line;  /* Line and hash of the last one dropped */
+    size_t      drop_hash;
+    size_t      nomem;      /* Size of an allocation that failed, or 0 */
+} DiagSet;
+
+/*
+** A file to be stripped: named on the command line, or found in a tree
+** (-r), in which case its standard depends on its extension and it is
+** skipped if it looks like a binary file.
+*/
+typedef struct InFile
+{
+    char       *name;
+    int         std_code;
+    bool        text_only;  /* Skip the file if it contains a NUL byte */
+} InFile;
+
+/* Standard for files with an extension (-r); the last match wins */
+typedef struct ExtStd
+{
+    const char *ext;        /* Extension, including the dot */
+    int         std_code;
+} ExtStd;
+
+/* A directory entry that might be walked or stripped (-r) */
+typedef struct DirEntry
+{
+    char       *name;
+    bool        is_dir;
+} DirEntry;
+
+/*
+** Source maps (--map) and #line directives (--line-directives).  The
+** library reports the points of the map of each file as it is stripped
+** (see SCC_Sink in libscc.h) to a LineMap.  For a source map, the
+** points of each file are added to those of the whole output when the
+** output of the file is written, and the map is written to its file at
+** the end.  For #line directives, the LineMap holds back the blanks at
+** the start of each line of output until the next character shows
+** which line of the input the line comes from; if that is not the line
+** a compiler would count, a #line directive is written first.
+*/
+typedef enum { MF_BINARY, MF_JSON } MapFormat;
+
+typedef struct MapPoint
+{
+    int         out_line;   /* Output from out_line, out_col onwards */
+    size_t      out_col;
+    int         in_line;    /* comes from the input at in_line, in_col onwards */
+    size_t      in_col;
+} MapPoint;
+
+typedef struct LineMap
+{
+    SCC_Sink    next;       /* Where the output goes */
+    const char *name;
+    bool        named;      /* The name is known: first file, or directive written */
+    MapPoint   *points;     /* The last is the end of the output and input, when done */
+    size_t      num_points;
+    size_t      max_points;
+    /* For #line directives (--line-directives) */
+    size_t      cur;        /* Point in effect */
+    int         out_line;   /* Line of output being written */
+    size_t      col;        /* Column of output being written */
+    int         expect;     /* Line number a compiler would give out_line */
+    bool        at_bol;     /* Nothing but blanks written on out_line */
+    bool        spliced;    /* Line before ended with backslash-newline */
+    bool        in_directive;   /* Line is (part of) a preprocessor directive */
+    char        last;       /* Last character written */
+    char       *blanks;     /* Blanks held back */
+    size_t      num_blanks;
+    size_t      max_blanks;
+    size_t      nomem;      /* Size of an allocation that failed, or 0 */
+} LineMap;
+
+/* A point of the source map of the whole output */
+typedef struct MapEntry
+{
+    int         out_line;
+    size_t      out_col;
+    size_t      source;     /* Index in map_sources */
+    int         in_line;
+    size_t      in_col;
+} MapEntry;
+
+/* A file processed by a worker thread (-j), waiting to be written */
+typedef struct Job
+{
+    const char *name;       /* File name as reported */
+    int         std_code;   /* Standard for the file */
+    bool        text_only;  /* Skip the file if it is binary */
+    bool        serial;     /* Stripped by the main thread when its turn comes */
+    size_t      size;       /* Size of the file, bounding the output held */
+    bool        binary;     /* File was skipped as binary */
+    int         open_err;   /* Error from fopen(), or 0 */
+    int         read_err;   /* Error reading file, or 0 */
+    bool        done;       /* Worker has finished with the job */
+    char       *out;        /* Output */
+    size_t      out_len;
+    size_t      out_size;
+    char       *cmt;        /* Output of the comments (--comments-out) */
+    size_t      cmt_len;
+    size_t      cmt_size;
+    DiagSet     diags;      /* Warnings */
+    SCC_Stats   stats;      /* Counts for the file (--stats) */
+    double      seconds;    /* Time taken to strip it */
+    int         ip_err;     /* Error stripping the file in place (-i), or 0 */
+    const char *ip_failed;  /* What failed (-i) */
+    bool        first;      /* First file of the output (--line-directives) */
+    LineMap     lmap;       /* Map of the output (--map, --line-directives) */
+    size_t      nomem;      /* Size of an allocation that failed, or 0 */
+} Job;
+
+typedef struct Pool
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;       /* Signalled when any of the below changes */
+    Job            *jobs;
+    size_t          num_jobs;
+    size_t          next_job;   /* Next job to be claimed by a worker */
+    size_t          next_out;   /* Next job to be written */
+    size_t          window;     /* Maximum jobs claimed but not written */
+    size_t          held;       /* Size of the jobs claimed but not written */
+    size_t          window_bytes;   /* Maximum size of those jobs */
+} Pool;
+
+typedef struct Worker
+{
+    Pool           *pool;
+    SCC_Scanner    *scanner;
+    Source          source;
+    pthread_t       thread;
+} Worker;
+
+/*
+** Statistics (--stats): the counts from the library for each file, and
+** the time spent stripping it, excluding the time spent reading and
+** writing (which TimedSink measures).  The report is written to
+** standard error when all the files have been processed.
+*/
+typedef enum { ST_NONE, ST_TEXT, ST_JSON } StatsFormat;
+
+typedef struct FileStats
+{
+    char       *name;
+    SCC_Stats   stats;
+    double      seconds;
+} FileStats;
 
-static const char * const dq_reg_prefix[] = { "L", "u", "U", "u8", };
-static const char * const dq_raw_prefix[] = { "R", "LR", "uR", "UR", "u8R" };
-enum { NUM_DQ_REG_PREFIX = sizeof(dq_reg_prefix) / sizeof(dq_reg_prefix[0]) };
-enum { NUM_DQ_RAW_PREFIX = sizeof(dq_raw_prefix) / sizeof(dq_raw_prefix[0]) };
-
-static int std_code = C18;  /* Selected standard */
-
-static bool cflag = false;   /* Print comments and not code */
-static bool eflag = false;   /* Print empty comment instead of blank */
-static bool nflag = false;   /* Keep newlines in comments */
-static bool tflag = false;   /* Keep white space before/after comments */
-static bool wflag = false;   /* Warn about nested C-style comments */
-
-static int qchar = 0;   /* Replacement character for quotes */
-static int schar = 0;   /* Replacement character for strings */
-
-/* Features recognized */
-static bool f_DoubleSlash = false;  /* // comments */
-static bool f_RawString = false;    /* Raw strings */
-static bool f_Unicode = false;      /* Unicode strings (u\"A\", U\"A\", u8\"A\") */
-static bool f_Binary = false;       /* Binary constants 0b0101 */
-static bool f_HexFloat = false;     /* Hexadecimal floats 0x2.34P-12 */
-static bool f_NumPunct = false;     /* Numeric punctuation 0x1234'5678 */
-static bool f_Universal = false;    /* Universal character names \uXXXX and \Uxxxxxxxx */
-
-static int nline = 0;   /* Line counter */
-static int l_nest = 0;  /* Last line with a nested comment warning */
-static int l_cend = 0;  /* Last line with a comment end warning */
-static bool l_comment = false;  /* Line contained a comment - print newline in -c mode */
-
-static const char optstr[] = "cefhnq:s:twS:V";
-static const char usestr[] = "[-cefhntwV][-S std][-s rep][-q rep] [file ...]";
+typedef struct TimedSink
+{
+    SCC_Sink    sink;       /* Sink timed */
+    double      seconds;    /* Time spent in it */
+} TimedSink;
+
+enum { JOB_WINDOW = 4 };    /* Reorder window, in jobs per thread */
+enum { JOB_WINDOW_BYTES = 8 * 1024 * 1024 };    /* Reorder window, in bytes per thread */
+enum { MAX_IOV = 64 };      /* Iovecs written at once */
+enum { KCOPY_MIN = 16 * 1024 };     /* Shortest stretch of input copied by the kernel */
+
+enum { BINARY_CHECK = 4 * 1024 };  /* Bytes checked for NUL in a file from a tree */
+enum { MAX_EXT_STD = 64 };
+enum { DIAG_SAME_LINE = 8 };    /* Warnings on a line checked for a repeat */
+enum { CACHE_LIMIT = 256 * 1024 * 1024 };   /* Default size of the cache */
+
+enum { OPT_STATS = 256, OPT_SLOWEST, OPT_EXT, OPT_FSYNC, OPT_CACHE, OPT_CACHE_SIZE,
+       OPT_MAP, OPT_MAP_FORMAT, OPT_LINE_DIRECTIVES, OPT_CODE_OUT, OPT_COMMENTS_OUT,
+       OPT_SERVER, OPT_FILES_FROM, OPT_NULL_OUTPUT, OPT_MAX_WARNINGS, OPT_ZERO_COPY };
+
+static const char optstr[] = "cefhi::j:nq:r:s:twS:V";
+static const struct option longopts[] =
+{
+    { "stats",      optional_argument, 0, OPT_STATS   },
+    { "slowest",    required_argument, 0, OPT_SLOWEST },
+    { "ext",        required_argument, 0, OPT_EXT     },
+    { "fsync",      no_argument,       0, OPT_FSYNC   },
+    { "zero-copy",  no_argument,       0, OPT_ZERO_COPY },
+    { "cache",      required_argument, 0, OPT_CACHE   },
+    { "cache-size", required_argument, 0, OPT_CACHE_SIZE },
+    { "map",        required_argument, 0, OPT_MAP     },
+    { "map-format", required_argument, 0, OPT_MAP_FORMAT },
+    { "line-directives", no_argument,  0, OPT_LINE_DIRECTIVES },
+    { "code-out",   required_argument, 0, OPT_CODE_OUT },
+    { "comments-out", required_argument, 0, OPT_COMMENTS_OUT },
+    { "server",     optional_argument, 0, OPT_SERVER  },
+    { "files-from", required_argument, 0, OPT_FILES_FROM },
+    { "null-output", no_argument,      0, OPT_NULL_OUTPUT },
+    { "max-warnings", required_argument, 0, OPT_MAX_WARNINGS },
+    { 0,            0,                 0, 0           },
+};
+static const char usestr[] =
+    "[-cefhntwV][-i[suffix]][-j n][-r dir][-S std][-s rep][-q rep][--ext=.ext=std,...]"
+    "[--fsync][--zero-copy][--cache dir][--cache-size=n][--map file][--map-format=fmt][--line-directives]"
+    "[--code-out file][--comments-out file][--files-from list][--null-output]"
+    "[--max-warnings=n[,total]][--stats[=json]][--slowest=n] [file ...]\n"
+    "       [-entwV][-S std][-s rep][-q rep] --server[=socket]";
 static const char hlpstr[] =
     "  -c      Print comments and not the code\n"
     "  -e      Print empty comment /* */ or //\n"
     "  -f      Print features recognized for the standard (debugging mainly)\n"
     "  -h      Print this help and exit\n"
+    "  -i[suffix]\n"
+    "          Strip the files in place, keeping the original with the suffix\n"
+    "          if given; files that would not change are not rewritten\n"
+    "  -j n    Use n threads for several files or one large file (0 for one per CPU)\n"
     "  -n      Keep newlines in comments\n"
     "  -q rep  Replace the body of character literals with rep (a single character)\n"
+    "  -r dir  Strip the C and C++ source files in the tree under dir (repeatable)\n"
     "  -s rep  Replace the body of string literals with rep (a single character)\n"
     "  -t      Retain trailing white space\n"
     "  -w      Warn about nested C-style comments\n"
     "  -S std  Specify language standard (C, C89, C90, C99, C11, C18;\n"
     "          C++, C++98, C++03, C++11, C++14, C++17; default C18)\n"
     "  -V      Print version information and exit\n"
+    "  --fsync Sync files stripped in place (-i) before replacing the originals\n"
+    "  --zero-copy\n"
+    "          Pass the pages of input files to a pipe or socket on standard\n"
+    "          output by reference; the input files must not change until\n"
+    "          the output has been read\n"
+    "  --cache dir\n"
+    "          Keep the results in dir, and reuse them for files with the same\n"
+    "          contents and options, in this run and later ones\n"
+    "  --cache-size=n\n"
+    "          Limit the cache to about n bytes (K, M or G suffix; default 256M)\n"
+    "  --map file\n"
+    "          Write a map from the positions in the output to those in the input\n"
+    "          to file (not with -i)\n"
+    "  --map-format=fmt\n"
+    "          Format of the map: binary (delta-encoded; the default) or json\n"
+    "  --line-directives\n"
+    "          Write #line directives where lines of the input were removed, so\n"
+    "          that line numbers refer to the input (not with --map)\n"
+    "  --code-out file\n"
+    "          Write the code to file instead of standard output\n"
+    "  --comments-out file\n"
+    "          Write the comments (as with -c) to file as well, from the same\n"
+    "          pass over the input (not with -c or -i)\n"
+    "  --files-from list\n"
+    "          Strip the files named in list (- for standard input), separated\n"
+    "          by NUL bytes if there are any and otherwise by newlines, after\n"
+    "          those in trees (-r) and before those on the command line\n"
+    "  --null-output\n"
+    "          End the output for each file with a NUL byte, even for a file\n"
+    "          that could not be read (not with -i or --map)\n"
+    "  --max-warnings=n[,total]\n"
+    "          Write no more than n warnings about each file, and no more than\n"
+    "          total in all, with a count of the rest; a warning repeated on the\n"
+    "          same line is written once\n"
+    "  --server[=socket]\n"
+    "          Strip the files or contents named in requests read from standard\n"
+    "          input, or from connections to the UNIX socket, until the end of\n"
+    "          the input; the options are the defaults for the requests\n"
+    "  --ext=.ext=std,...\n"
+    "          Standard for files with the extension in a tree (-r); by default\n"
+    "          .c and .h are C18 and .cc, .cpp, .cxx, .hh, .hpp and .hxx are C++17;\n"
+    "          -S overrides the standards but not the choice of files\n"
+    "  --stats[=json]\n"
+    "          Report counts and times for each file and in total on standard\n"
+    "          error, as a table or as JSON\n"
+    "  --slowest=n\n"
+    "          List the n slowest files in the statistics (default 10)\n"
     ;
 
-static char   *whisp = 0;
-static size_t  whisp_size = 0;
-static size_t  whisp_off = 0;
+static SCC_Scanner *scanner = 0;
+static Source source;
+static Output output = { STDOUT_FILENO, KC_NONE, -1, 0, 0 };
+static int nthreads = 1;        /* -j */
+static StatsFormat stats_format = ST_NONE;  /* --stats */
+static size_t stats_slowest = 10;           /* --slowest */
+static FileStats *file_stats = 0;
+static size_t num_file_stats = 0;
+static size_t max_file_stats = 0;
+static InFile *in_files = 0;    /* Files from trees and command line (-r) */
+static size_t num_in_files = 0;
+static size_t max_in_files = 0;
+static ExtStd ext_std[MAX_EXT_STD];
+static size_t num_ext_std = 0;
+static int std_override = -1;   /* -S: standard for files from trees, or -1 */
+static const char *in_place = 0;    /* -i: suffix for the original (maybe empty), or null */
+static bool fsync_flag = false;     /* --fsync */
+static bool zero_copy = false;      /* --zero-copy */
+static const char *cache_dir = 0;   /* --cache */
+static size_t cache_limit = CACHE_LIMIT;    /* --cache-size */
+static Cache *cache = 0;
+static CacheStats cache_stats;      /* Final counts (--stats) */
+static const char *map_file = 0;    /* --map */
+static MapFormat map_format = MF_BINARY;    /* --map-format */
+static bool line_directives = false;        /* --line-directives */
+static size_t lm_files = 0;         /* Files stripped with a LineMap */
+static char **map_sources = 0;      /* Names of the files in the map (--map) */
+static size_t num_map_sources = 0;
+static size_t max_map_sources = 0;
+static MapEntry *map_entries = 0;
+static size_t num_map_entries = 0;
+static size_t max_map_entries = 0;
+static int map_end_line = 1;        /* End of the output mapped so far */
+static size_t map_end_col = 0;
+static const char *code_out = 0;    /* --code-out */
+static const char *comments_out = 0;    /* --comments-out */
+static FILE *comments_fp = 0;
+static const char *server = 0;      /* --server: socket, or empty for standard input */
+static const char *files_from = 0;  /* --files-from */
+static char *file_list = 0;         /* Contents of the list, holding the names */
+static bool null_output = false;    /* --null-output */
+static size_t max_warnings = SIZE_MAX;  /* --max-warnings: for each file */
+static size_t max_total_warnings = SIZE_MAX;    /* --max-warnings: in all */
+static size_t warnings_written = 0;
+static size_t warnings_unwritten = 0;   /* Beyond max_total_warnings */
+static DiagSet file_diags;          /* Warnings about the current file (serial) */
+static char *diag_text = 0;         /* Warnings about a file, as reported */
+static size_t diag_len = 0;
+static size_t diag_size = 0;
 
 #ifndef lint
 /* Prevent over-aggressive optimizers from eliminating ID string */
@@ -179,1108 +468,2165 @@ extern const char jlss_id_scc_c[];
 const char jlss_id_scc_c[] = "@(#)$Id: scc.c,v 8.3 2022/05/30 01:02:22 jonathanleffler Exp $";
 #endif /* lint */
 
-/* Always maintain enough space in whisp for a null to be added */
-static void whisp_push(char c)
+/* Map a regular file into memory, starting at the current file offset */
+static bool src_map(Source *src, int fd)
+{
+    struct stat sb;
+    off_t offset;
+
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode) || sb.st_size <= 0 ||
+        (uintmax_t)sb.st_size > SIZE_MAX)
+        return false;
+    if ((offset = lseek(fd, 0, SEEK_CUR)) < 0 || offset >= sb.st_size)
+        return false;
+    void *map = mmap(0, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+        return false;
+    src->map = map;
+    src->maplen = (size_t)sb.st_size;
+    src->base = (char *)map + offset;
+    src->len = (size_t)(sb.st_size - offset);
+    /* Leave the file positioned as if it had been read */
+    (void)lseek(fd, sb.st_size, SEEK_SET);
+    return true;
+}
+
+/*
+** Read the whole of a pipe, terminal, etc into src->rd_buffer.
+** Returns 0, or the error number if the read failed part way.
+*/
+static int src_read(Source *src, int fd)
 {
-    if (whisp == 0 || whisp_off >= whisp_size - 1)
+    size_t len = 0;
+    int errnum = 0;
+
+    for (;;)
     {
-        size_t new_size = whisp_size * 2 + 2;
-        void *new_whisp = realloc(whisp, new_size);
-        if (new_whisp == 0)
-            err_syserr("failed to allocate %zu bytes of memory: ", new_size);
-        whisp = new_whisp;
-        whisp_size = new_size;
+        if (src->rd_size - len < RD_BLOCKSIZE)
+        {
+            size_t new_size = src->rd_size * 2 + RD_BLOCKSIZE;
+            void *new_buffer = realloc(src->rd_buffer, new_size);
+            if (new_buffer == 0)
+            {
+                errnum = ENOMEM;
+                break;
+            }
+            src->rd_buffer = new_buffer;
+            src->rd_size = new_size;
+        }
+        ssize_t nbytes = read(fd, src->rd_buffer + len, src->rd_size - len);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+        {
+            errnum = errno;
+            break;
+        }
+        if (nbytes == 0)
+            break;
+        len += (size_t)nbytes;
+    }
+    src->base = src->rd_buffer;
+    src->len = len;
+    return errnum;
+}
+
+static int src_open(Source *src, FILE *fp)
+{
+    int fd = fileno(fp);
+
+    src->map = 0;
+    src->maplen = 0;
+    if (src_map(src, fd))
+        return 0;
+    return src_read(src, fd);
+}
+
+static void src_close(Source *src)
+{
+    if (src->map != 0)
+        munmap(src->map, src->maplen);
+    src->map = 0;
+    src->base = 0;
+    src->len = 0;
+}
+
+static int out_write(void *data, const char *buffer, size_t len)
+{
+    fwrite(buffer, sizeof(char), len, (FILE *)data);
+    return 0;
+}
+
+/* Pass iov[0..n-1] (all mapped input) to the kernel; -1 if it refuses */
+static ssize_t fd_kcopy(Output *op, const struct iovec *iov, int n)
+{
+#ifdef __linux__
+    off_t offset = (off_t)((const char *)iov->iov_base - op->map_lo);
+    switch (op->kcopy)
+    {
+    case KC_VMSPLICE:
+#ifdef SPLICE_F_MOVE
+        return vmsplice(op->fd, iov, (unsigned long)n, 0);
+#else
+        break;
+#endif /* SPLICE_F_MOVE */
+    case KC_COPY_RANGE:
+        return copy_file_range(op->in_fd, &offset, op->fd, 0, iov->iov_len, 0);
+    case KC_SENDFILE:
+        return sendfile(op->fd, op->in_fd, &offset, iov->iov_len);
+    case KC_NONE:
+        break;
     }
-    whisp[whisp_off++] = c;
+#else
+    (void)op;
+    (void)iov;
+#endif /* __linux__ */
+    (void)n;
+    errno = ENOSYS;
+    return -1;
 }
 
-static void whisp_write(FILE *fp)
+/* Write all of iov[0..n-1], adjusting iov after a partial write */
+static int fd_write_all(Output *op, struct iovec *iov, int n, bool kcopy)
 {
-    if (whisp_off > 0)
+    while (n > 0)
     {
-        whisp[whisp_off] = '\0';
-        fputs(whisp, fp);
-        whisp_off = 0;
+        ssize_t nbytes;
+        if (kcopy && op->kcopy != KC_NONE)
+        {
+            nbytes = fd_kcopy(op, iov, n);
+            if (nbytes == 0 || (nbytes < 0 && errno != EINTR && errno != EAGAIN))
+            {
+                /* Not supported here - try the next method */
+                if (op->kcopy == KC_COPY_RANGE)
+                    op->kcopy = KC_SENDFILE;
+                else
+                    op->kcopy = KC_NONE;
+                continue;
+            }
+        }
+        else
+            nbytes = writev(op->fd, iov, n);
+        if (nbytes < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (nbytes < 0)
+            return -1;
+        while (n > 0 && (size_t)nbytes >= iov->iov_len)
+        {
+            nbytes -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + nbytes;
+            iov->iov_len -= (size_t)nbytes;
+        }
     }
+    return 0;
 }
 
-static void whisp_clear(void)
+static int fd_write(void *data, const char *buffer, size_t len)
 {
-    whisp_off = 0;
+    struct iovec iov = { .iov_base = (void *)buffer, .iov_len = len };
+    return fd_write_all(data, &iov, 1, false);
 }
 
-static void whisp_putchar(char c)
+static bool fd_kcopyable(const Output *op, const struct iovec *iov)
 {
-    if (isblank(c))
-        whisp_push(c);
-    else
+    const char *base = iov->iov_base;
+    return op->kcopy != KC_NONE && iov->iov_len >= KCOPY_MIN &&
+           base >= op->map_lo && base + iov->iov_len <= op->map_hi;
+}
+
+/*
+** Write groups of iovecs, leaving the long stretches of mapped input to
+** the kernel.  Only vmsplice() takes more than one iovec at a time.
+*/
+static int fd_writev(void *data, const struct iovec *iov, int iovcnt)
+{
+    Output *op = data;
+
+    while (iovcnt > 0)
     {
-        if (tflag || c != '\n')
-            whisp_write(stdout);
-        else if (c == '\n')
-            whisp_clear();
-        putchar(c);
+        struct iovec group[MAX_IOV];
+        bool kcopy = fd_kcopyable(op, &iov[0]);
+        int max = (kcopy && op->kcopy != KC_VMSPLICE) ? 1 : MAX_IOV;
+        int n = 0;
+        while (n < iovcnt && n < max && fd_kcopyable(op, &iov[n]) == kcopy)
+        {
+            group[n] = iov[n];
+            n++;
+        }
+        if (fd_write_all(op, group, n, kcopy) != 0)
+            return -1;
+        iov += n;
+        iovcnt -= n;
     }
+    return 0;
 }
 
-static int getch(FILE *fp)
+static double now_seconds(void)
 {
-    int c = getc(fp);
-    if (c == '\n')
-        nline++;
-    return(c);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
 }
 
-static int ungetch(char c, FILE *fp)
+static int timed_write(void *data, const char *buffer, size_t len)
 {
-    if (c == '\n')
-        nline--;
-    return(ungetc(c, fp));
+    TimedSink *ts = data;
+    double start = now_seconds();
+    int rc = (*ts->sink.write)(ts->sink.data, buffer, len);
+    ts->seconds += now_seconds() - start;
+    return rc;
 }
 
-static int peek(FILE *fp)
+static int timed_writev(void *data, const struct iovec *iov, int iovcnt)
 {
-    int c;
-
-    if ((c = getch(fp)) != EOF)
-        ungetch(c, fp);
-    return(c);
+    TimedSink *ts = data;
+    double start = now_seconds();
+    int rc = (*ts->sink.writev)(ts->sink.data, iov, iovcnt);
+    ts->seconds += now_seconds() - start;
+    return rc;
 }
 
-/* Put source code character */
-static void s_putch(char c)
+static void timed_diag(void *data, const char *name, int line, const char *msg)
 {
-    if (!cflag || ((nflag || l_comment) && c == '\n'))
-        whisp_putchar(c);
-    if (c == '\n')
-        l_comment = false;
+    TimedSink *ts = data;
+    double start = now_seconds();
+    (*ts->sink.diag)(ts->sink.data, name, line, msg);
+    ts->seconds += now_seconds() - start;
 }
 
-/* Put comment (non-code) character */
-static void c_putch(char c)
+/* A sink that passes everything to ts->sink, timing it */
+static SCC_Sink timed_sink(TimedSink *ts, const SCC_Sink *sink)
 {
-    if (cflag || (nflag && c == '\n'))
-        whisp_putchar(c);
+    SCC_Sink timed = { .write = timed_write, .diag = timed_diag, .data = ts, .flags = sink->flags };
+    ts->sink = *sink;
+    ts->seconds = 0.0;
+    if (sink->writev != 0)
+        timed.writev = timed_writev;
+    return timed;
 }
 
-/* Output string of statement characters */
-static void s_putstr(const char *str)
+/* Record the statistics for a file */
+static void stats_add_file(const char *name, const SCC_Stats *stats, double seconds)
 {
-    char c;
-    while ((c = *str++) != '\0')
-        s_putch(c);
+    if (num_file_stats >= max_file_stats)
+    {
+        size_t new_max = max_file_stats * 2 + 16;
+        void *new_stats = realloc(file_stats, new_max * sizeof(*file_stats));
+        if (new_stats == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", new_max * sizeof(*file_stats));
+        file_stats = new_stats;
+        max_file_stats = new_max;
+    }
+    FileStats *fs = &file_stats[num_file_stats++];
+    if ((fs->name = strdup(name)) == 0)
+        err_syserr("failed to allocate %zu bytes of memory: ", strlen(name) + 1);
+    fs->stats = *stats;
+    fs->seconds = (seconds > 0.0) ? seconds : 0.0;
 }
 
-static void warning(const char *str, const char *file, int line)
+static size_t comment_count(const SCC_Stats *sp)
 {
-    err_report(ERR_REM, ERR_STAT, "%s:%d: %s\n", file, line, str);
+    return sp->c_comments + sp->cpp_comments;
 }
 
-static void warning2(const char *s1, const char *s2, const char *file, int line)
+static size_t literal_count(const SCC_Stats *sp)
 {
-    err_report(ERR_REM, ERR_STAT, "%s:%d: %s %s\n", file, line, s1, s2);
+    return sp->strings + sp->chars + sp->raw_strings;
 }
 
-static void warningv(const char *fmt, const char *file, int line, ...)
+static size_t number_count(const SCC_Stats *sp)
 {
-    char buffer[BUFSIZ];
-    va_list args;
-    va_start(args, line);
-    vsnprintf(buffer, sizeof(buffer), fmt, args);
-    va_end(args);
-    warning(buffer, file, line);
+    size_t n = 0;
+    for (int i = 0; i < SCC_NUM_RADICES; i++)
+        n += sp->numbers[i];
+    return n;
 }
 
-static void warn_feature(enum Feature feature, const char *fn)
+static size_t warning_count(const SCC_Stats *sp)
 {
-    assert(fn != 0);
-    assert(feature >= F_HEXFLOAT && feature <= F_UNIVERSAL);
-    warningv("%s feature used but not supported in %s", fn, nline,
-             feature_name[feature], std_name[std_code]);
+    size_t n = 0;
+    for (int i = 0; i < SCC_NUM_WARNINGS; i++)
+        n += sp->warnings[i];
+    return n;
 }
 
-static void put_quote_char(char q, char c)
+static double mb_per_sec(size_t bytes, double seconds)
 {
-    if (q == '\'' && qchar != 0)
-        s_putch(qchar);
-    else if (q == '"' && schar != 0)
-        s_putch(schar);
-    else
-        s_putch(c);
+    return (seconds > 0.0) ? (double)bytes / 1e6 / seconds : 0.0;
 }
 
-static void put_quote_str(char q, char *str)
+static void text_file_line(FILE *fp, const char *name, const SCC_Stats *sp, double seconds)
 {
-    char c;
-    while ((c = *str++) != '\0')
-        put_quote_char(q, c);
+    fprintf(fp, "%-24s %10zu %10zu %8zu %8zu %8zu %8zu %8zu %10.3f %8.1f\n",
+            name, sp->bytes_in, sp->bytes_out, sp->lines, comment_count(sp),
+            literal_count(sp), number_count(sp), warning_count(sp),
+            seconds * 1000.0, mb_per_sec(sp->bytes_in, seconds));
 }
 
-static void endquote(char q, FILE *fp, const char *fn, const char *msg)
+/* Order files by decreasing time, then by name */
+static int cmp_slowest(const void *v1, const void *v2)
 {
-    int c1;
+    const FileStats *fs1 = *(const FileStats * const *)v1;
+    const FileStats *fs2 = *(const FileStats * const *)v2;
+    if (fs1->seconds > fs2->seconds)
+        return -1;
+    if (fs1->seconds < fs2->seconds)
+        return +1;
+    return strcmp(fs1->name, fs2->name);
+}
 
-    while ((c1 = getch(fp)) != EOF && c1 != q)
+static void stats_text(FILE *fp, const SCC_Stats *total, double seconds,
+                       FileStats **slowest, size_t num_slowest)
+{
+    fprintf(fp, "%-24s %10s %10s %8s %8s %8s %8s %8s %10s %8s\n", "File", "Bytes in",
+            "Bytes out", "Lines", "Comments", "Literals", "Numbers", "Warnings",
+            "Lexer ms", "MB/s");
+    for (size_t i = 0; i < num_file_stats; i++)
+        text_file_line(fp, file_stats[i].name, &file_stats[i].stats, file_stats[i].seconds);
+    char label[64];
+    snprintf(label, sizeof(label), "Total (%zu file%s)", num_file_stats,
+             (num_file_stats == 1) ? "" : "s");
+    text_file_line(fp, label, total, seconds);
+
+    fprintf(fp, "Comments:  C %zu (%zu bytes), C++ %zu (%zu bytes)\n",
+            total->c_comments, total->c_comment_bytes,
+            total->cpp_comments, total->cpp_comment_bytes);
+    fprintf(fp, "Literals:  strings %zu, characters %zu, raw strings %zu\n",
+            total->strings, total->chars, total->raw_strings);
+    fprintf(fp, "Numbers: ");
+    for (int i = 0; i < SCC_NUM_RADICES; i++)
+        fprintf(fp, "%s %s %zu", (i == 0) ? " " : ",", scc_radix_name(i), total->numbers[i]);
+    fprintf(fp, "\nWarnings:");
+    for (int i = 0; i < SCC_NUM_WARNINGS; i++)
+        fprintf(fp, "%s %s %zu", (i == 0) ? " " : ",", scc_warning_name(i), total->warnings[i]);
+    fprintf(fp, "\nUnchanged: %zu of %zu files copied without scanning\n",
+            total->plain, total->inputs);
+    if (cache_dir != 0)
+        fprintf(fp, "Cache:     hits %zu, misses %zu, stored %zu, evicted %zu\n",
+                cache_stats.hits, cache_stats.misses, cache_stats.stored, cache_stats.evicted);
+    if (num_slowest > 0)
     {
-        if (c1 == '\\')
-        {
-            int bs_count = 1;
-            int c2;
-            while ((c2 = getch(fp)) != EOF && c2 == '\\')
-                bs_count++;
-            if (c2 == EOF)
-            {
-                /* Stream of backslashes and newline - bug in source code */
-                for (int i = 0; i < bs_count; i++)
-                    put_quote_char(q, c1);
-                break;
-            }
-            if (c2 == '\n')
-            {
-                /* The backslash-newline would be processed first */
-                /* Echo the other backslashes and then emit backslash-newline */
-                for (int i = 1; i < bs_count; i++)
-                    put_quote_char(q, c1);
-                s_putch(c1);
-                s_putch(c2);
-            }
-            else
-            {
-                /* Series of backslashes not ending BSNL */
-                /* Emit pairs of backslashes - then work out what to do */
-                for (int i = 0; i < bs_count - 1; i += 2)
-                    put_quote_str(q, "\\\\");
-
-                if (bs_count % 2 == 0)
-                {
-                    s_putch(c2);
-                    if (c2 == q)
-                        return;
-                }
-                else
-                {
-                    put_quote_char(q, c1);
-                    put_quote_char(q, c2);
-                    if ((c2 == 'u' || c2 == 'U') && !f_Universal)
-                        warn_feature(F_UNIVERSAL, fn);
-                }
-            }
-        }
-        else if (c1 == '\n')
-        {
-            put_quote_char(q, c1);
-            warning2("newline in", msg, fn, nline - 1);
-            /* Heuristic recovery - assume close quote at end of line */
-            return;
-        }
-        else
-            put_quote_char(q, c1);
+        fprintf(fp, "Slowest files:\n");
+        for (size_t i = 0; i < num_slowest; i++)
+            fprintf(fp, "%4zu. %10.3f ms %8.1f MB/s  %s\n", i + 1, slowest[i]->seconds * 1000.0,
+                    mb_per_sec(slowest[i]->stats.bytes_in, slowest[i]->seconds),
+                    slowest[i]->name);
     }
-    if (c1 == EOF)
+}
+
+static void json_string(FILE *fp, const char *str)
+{
+    unsigned char c;
+    putc('"', fp);
+    while ((c = (unsigned char)*str++) != '\0')
     {
-        warning2("EOF in", msg, fn, nline);
-        return;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c < 0x20 || c == 0x7F)
+            fprintf(fp, "\\u%04x", c);
+        else
+            putc(c, fp);
     }
-    s_putch(q);
+    putc('"', fp);
 }
 
-/*
-** read_bsnl() - Count the number of backslash newline pairs that
-** immediately follow in the input stream.  On entry, peek() might
-** return the backslash of a backslash newline pair, or some other
-** character.  On exit, getch() will return the first character
-** after the sequence of n (n >= 0) backslash newline pairs.  It
-** relies on two characters of pushback (but only of data already
-** read) - not mandated by POSIX or C standards.  Double pushback
-** may cause problems on HP-UX, Solaris or AIX (but does not cause
-** trouble on Linux or BSD).
-*/
-static int read_bsnl(FILE *fp)
+/* The counts of a file, or of the total (which has unchanged_files instead of unchanged) */
+static void json_stats(FILE *fp, const char *indent, const SCC_Stats *sp, double seconds, bool file)
 {
-    int n = 0;
-    int c;
+    fprintf(fp, "%s\"bytes_in\": %zu, \"bytes_out\": %zu, \"lines\": %zu,\n",
+            indent, sp->bytes_in, sp->bytes_out, sp->lines);
+    fprintf(fp, "%s\"comments\": { \"c\": %zu, \"c_bytes\": %zu, \"cpp\": %zu, \"cpp_bytes\": %zu },\n",
+            indent, sp->c_comments, sp->c_comment_bytes, sp->cpp_comments, sp->cpp_comment_bytes);
+    fprintf(fp, "%s\"literals\": { \"strings\": %zu, \"chars\": %zu, \"raw_strings\": %zu },\n",
+            indent, sp->strings, sp->chars, sp->raw_strings);
+    fprintf(fp, "%s\"numbers\": {", indent);
+    for (int i = 0; i < SCC_NUM_RADICES; i++)
+        fprintf(fp, "%s \"%s\": %zu", (i == 0) ? "" : ",", scc_radix_name(i), sp->numbers[i]);
+    fprintf(fp, " },\n%s\"warnings\": {", indent);
+    for (int i = 0; i < SCC_NUM_WARNINGS; i++)
+        fprintf(fp, "%s \"%s\": %zu", (i == 0) ? "" : ",", scc_warning_name(i), sp->warnings[i]);
+    fprintf(fp, " },\n%s", indent);
+    if (file)
+        fprintf(fp, "\"unchanged\": %s, ", (sp->plain == sp->inputs && sp->inputs > 0) ? "true" : "false");
+    fprintf(fp, "\"lexer_seconds\": %.6f, \"mb_per_sec\": %.1f", seconds, mb_per_sec(sp->bytes_in, seconds));
+}
 
-    while ((c = peek(fp)) != EOF)
+static void stats_json(FILE *fp, const SCC_Stats *total, double seconds,
+                       FileStats **slowest, size_t num_slowest)
+{
+    fprintf(fp, "{\n  \"files\": [");
+    for (size_t i = 0; i < num_file_stats; i++)
     {
-        if (c != '\\')
-            return(n);
-        c = getch(fp);              /* Read backslash */
-        if ((c = peek(fp)) != '\n') /* Single pushback */
-        {
-            ungetch('\\', fp);      /* Double pushback */
-            return(n);
-        }
-        n++;
-        c = getch(fp);              /* Read newline */
+        fprintf(fp, "%s\n    {\n      \"name\": ", (i == 0) ? "" : ",");
+        json_string(fp, file_stats[i].name);
+        fprintf(fp, ",\n");
+        json_stats(fp, "      ", &file_stats[i].stats, file_stats[i].seconds, true);
+        fprintf(fp, "\n    }");
+    }
+    fprintf(fp, "\n  ],\n  \"total\": {\n    \"files\": %zu, \"unchanged_files\": %zu,\n",
+            total->inputs, total->plain);
+    json_stats(fp, "    ", total, seconds, false);
+    fprintf(fp, "\n  },\n");
+    if (cache_dir != 0)
+        fprintf(fp, "  \"cache\": { \"hits\": %zu, \"misses\": %zu, \"stored\": %zu,"
+                " \"evicted\": %zu },\n", cache_stats.hits, cache_stats.misses, cache_stats.stored, cache_stats.evicted);
+    fprintf(fp, "  \"slowest\": [");
+    for (size_t i = 0; i < num_slowest; i++)
+    {
+        fprintf(fp, "%s\n    { \"name\": ", (i == 0) ? "" : ",");
+        json_string(fp, slowest[i]->name);
+        fprintf(fp, ", \"lexer_seconds\": %.6f, \"mb_per_sec\": %.1f }", slowest[i]->seconds,
+                mb_per_sec(slowest[i]->stats.bytes_in, slowest[i]->seconds));
     }
-    return(n);
+    fprintf(fp, "\n  ]\n}\n");
 }
 
-static void write_bsnl(int bsnl, void (*put)(char))
+/* Write the statistics report (--stats) to standard error */
+static void stats_report(void)
 {
-    while (bsnl-- > 0)
+    SCC_Stats total = { 0 };
+    double seconds = 0.0;
+    for (size_t i = 0; i < num_file_stats; i++)
     {
-        (*put)('\\');
-        (*put)('\n');
+        scc_add_stats(&total, &file_stats[i].stats);
+        seconds += file_stats[i].seconds;
     }
+
+    size_t num_slowest = (stats_slowest < num_file_stats) ? stats_slowest : num_file_stats;
+    FileStats **slowest = malloc((num_file_stats + 1) * sizeof(*slowest));
+    if (slowest == 0)
+        err_syserr("failed to allocate memory for statistics: ");
+    for (size_t i = 0; i < num_file_stats; i++)
+        slowest[i] = &file_stats[i];
+    qsort(slowest, num_file_stats, sizeof(*slowest), cmp_slowest);
+
+    fflush(stdout);
+    if (stats_format == ST_JSON)
+        stats_json(stderr, &total, seconds, slowest, num_slowest);
+    else
+        stats_text(stderr, &total, seconds, slowest, num_slowest);
+    fflush(stderr);
+
+    free(slowest);
+    for (size_t i = 0; i < num_file_stats; i++)
+        free(file_stats[i].name);
+    free(file_stats);
+    file_stats = 0;
+    num_file_stats = max_file_stats = 0;
+}
+
+static size_t diag_hash(const char *str)
+{
+    size_t hash = 2166136261u;
+    while (*str != '\0')
+        hash = (hash ^ (unsigned char)*str++) * 16777619u;
+    return hash;
 }
 
-static Comment c_comment(int c, FILE *fp, const char *fn)
+/*
+** The index of msg in ds->texts, adding it if it is new, or SIZE_MAX if
+** memory ran out (noted in ds->nomem, as workers cannot report it).
+*/
+static size_t diag_intern(DiagSet *ds, const char *msg)
 {
-    Comment status = CComment;
-    if (c == '*')
+    if (ds->num_texts * 2 >= ds->num_slots)
     {
-        int bsnl = read_bsnl(fp);
-        if (peek(fp) == '/')
+        size_t new_num = (ds->num_slots == 0) ? 64 : ds->num_slots * 2;
+        size_t *new_slots = calloc(new_num, sizeof(*new_slots));
+        if (new_slots == 0)
         {
-            l_comment = true;
-            status = NonComment;
-            c = getch(fp);
-            c_putch('*');
-            write_bsnl(bsnl, c_putch);
-            c_putch('/');
-            s_putch(' ');
-            if (eflag)
-            {
-                s_putch('*');
-                s_putch('/');
-            }
+            ds->nomem = new_num * sizeof(*new_slots);
+            return SIZE_MAX;
         }
-        else
+        for (size_t i = 0; i < ds->num_texts; i++)
         {
-            c_putch(c);
-            write_bsnl(bsnl, c_putch);
+            size_t j = diag_hash(ds->texts[i]) & (new_num - 1);
+            while (new_slots[j] != 0)
+                j = (j + 1) & (new_num - 1);
+            new_slots[j] = i + 1;
         }
+        free(ds->slots);
+        ds->slots = new_slots;
+        ds->num_slots = new_num;
     }
-    else if (wflag && c == '/' && peek(fp) == '*')
+    size_t mask = ds->num_slots - 1;
+    size_t j = diag_hash(msg) & mask;
+    for ( ; ds->slots[j] != 0; j = (j + 1) & mask)
     {
-        if (l_nest != nline)
-            warning("nested C-style comment", fn, nline);
-        l_nest = nline;
-        c_putch(c);
+        if (strcmp(ds->texts[ds->slots[j] - 1], msg) == 0)
+            return ds->slots[j] - 1;
     }
-    else
-        c_putch(c);
-    return status;
-}
-
-static Comment cpp_comment(int c, int oc)
-{
-    Comment status = CppComment;
-    if (c == '\n' && oc != '\\')
+    if (ds->num_texts >= ds->max_texts)
+    {
+        size_t new_max = ds->max_texts * 2 + 16;
+        void *new_texts = realloc(ds->texts, new_max * sizeof(*ds->texts));
+        if (new_texts == 0)
+        {
+            ds->nomem = new_max * sizeof(*ds->texts);
+            return SIZE_MAX;
+        }
+        ds->texts = new_texts;
+        ds->max_texts = new_max;
+    }
+    if ((ds->texts[ds->num_texts] = strdup(msg)) == 0)
     {
-        status = NonComment;
-        s_putch(c);
-        if (!nflag)
-            c_putch(c);
+        ds->nomem = strlen(msg) + 1;
+        return SIZE_MAX;
     }
-    else
-        c_putch(c);
-    return status;
+    ds->slots[j] = ++ds->num_texts;
+    return ds->num_texts - 1;
 }
 
-/* Backslash was read but not printed! u or U was peeked but not read */
-/*
-** There's no compelling reason to handle UCNs - the code is supposed to
-** be valid before using SCC on it, and invalid UCNs therefore should
-** not appear.  OTOH, to report their use when not supported, you have
-** to detect their existence.
-*/
-static void scan_ucn(int letter, int nbytes, FILE *fp, const char *fn)
-{
-    assert(letter == 'u' || letter == 'U');
-    assert(nbytes == 4 || nbytes == 8);
-    bool ok = true;
-    int i;
-    char str[8];
-    if (!f_Universal)
-        warn_feature(F_UNIVERSAL, fn);
-    s_putch('\\');
-    int c = getch(fp);
-    assert(c == letter);
-    s_putch(c);
-    for (i = 0; i < nbytes; i++)
-    {
-        c = getch(fp);
-        if (c == EOF)
+/* Collect a warning about the file */
+static void diag_add(DiagSet *ds, const char *name, int line, const char *msg)
+{
+    ds->name = name;
+    if (ds->nomem != 0)
+        return;
+    if (ds->num_entries >= max_warnings)
+    {
+        /* Only its hash, so that the messages not written are not kept */
+        size_t hash = diag_hash(msg);
+        bool repeat;
+        if (ds->dropped > 0)
+            repeat = (line == ds->drop_line && hash == ds->drop_hash);
+        else if (ds->num_entries > 0)
         {
-            ok = false;
-            break;
+            DiagEntry *last = &ds->entries[ds->num_entries - 1];
+            repeat = (line == last->line && strcmp(ds->texts[last->text], msg) == 0);
         }
-        if (!isxdigit(c))
+        else
+            repeat = false;
+        if (!repeat)
+            ds->dropped++;
+        ds->drop_line = line;
+        ds->drop_hash = hash;
+        return;
+    }
+    size_t text = diag_intern(ds, msg);
+    if (text == SIZE_MAX)
+        return;
+    bool limited = (max_warnings != SIZE_MAX || max_total_warnings != SIZE_MAX);
+    for (size_t i = ds->num_entries; limited && i > 0 && ds->entries[i - 1].line == line &&
+         ds->num_entries - i < DIAG_SAME_LINE; i--)
+    {
+        if (ds->entries[i - 1].text == text)
+            return;
+    }
+    if (ds->num_entries >= ds->max_entries)
+    {
+        size_t new_max = ds->max_entries * 2 + 16;
+        void *new_entries = realloc(ds->entries, new_max * sizeof(*ds->entries));
+        if (new_entries == 0)
         {
-            ok = false;
-            s_putch(c);
-            break;
+            ds->nomem = new_max * sizeof(*ds->entries);
+            return;
         }
-        str[i] = c;
-        s_putch(c);
+        ds->entries = new_entries;
+        ds->max_entries = new_max;
     }
-    if (!ok)
+    ds->entries[ds->num_entries++] = (DiagEntry){ line, text };
+}
+
+/* Add a line to the warnings about a file (diag_text) */
+static void diag_format(const char *format, ...)
+{
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf((diag_text == 0) ? 0 : diag_text + diag_len, diag_size - diag_len, format, args);
+    va_end(args);
+    if (len < 0)
+        err_syserr("failed to format a warning: ");
+    if ((size_t)len >= diag_size - diag_len)
     {
-        char msg[64];
-        snprintf(msg, sizeof(msg), "Invalid UCN \\%c%.*s%c detected", letter, i, str, c);
-        warning(msg, fn, nline);
+        size_t new_size = diag_size * 2 + (size_t)len + 1;
+        char *new_text = realloc(diag_text, new_size);
+        if (new_text == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", new_size);
+        diag_text = new_text;
+        diag_size = new_size;
+        va_start(args, format);
+        vsnprintf(diag_text + diag_len, diag_size - diag_len, format, args);
+        va_end(args);
     }
+    diag_len += (size_t)len;
 }
 
-static inline int is_idchar(int c)
+/*
+** Report the warnings collected about a file together, after its
+** output, and forget them.  Those beyond the limit for the file are
+** summarized at the end of them, those beyond the limit for the run
+** at the end of the run (diag_summary()).  They are formatted into
+** one batch, so that open files are flushed and standard error is
+** written once for the file, however many warnings there are.
+*/
+static void diag_flush(DiagSet *ds)
 {
-    assert(c == EOF || (c >= 0 && c <= UCHAR_MAX));
-    return(isalnum(c) || c == '_');
+    size_t i;
+
+    diag_len = 0;
+    for (i = 0; i < ds->num_entries && warnings_written < max_total_warnings; i++)
+    {
+        DiagEntry *dp = &ds->entries[i];
+        diag_format("%s:%d: %s\n", ds->name, dp->line, ds->texts[dp->text]);
+        warnings_written++;
+    }
+    if (i < ds->num_entries)
+        warnings_unwritten += ds->num_entries - i + ds->dropped;
+    else if (ds->dropped > 0)
+        diag_format("%s: %zu more warnings not shown\n", ds->name, ds->dropped);
+    if (diag_len > 0)
+        err_reportlines(ERR_REM, diag_text, diag_len);
+    for (i = 0; i < ds->num_texts; i++)
+        free(ds->texts[i]);
+    if (ds->num_slots > 0)
+        memset(ds->slots, 0, ds->num_slots * sizeof(*ds->slots));
+    ds->num_texts = ds->num_entries = ds->dropped = 0;
 }
 
-static inline int is_binary(int c)
+static void diag_free(DiagSet *ds)
 {
-    assert(c == EOF || (c >= 0 && c <= UCHAR_MAX));
-    return(c == '0' || c == '1');
+    for (size_t i = 0; i < ds->num_texts; i++)
+        free(ds->texts[i]);
+    free(ds->texts);
+    free(ds->slots);
+    free(ds->entries);
+    *ds = (DiagSet){ 0 };
 }
 
-static inline int is_octal(int c)
+/* At the end of the run, the warnings beyond the limit for it */
+static void diag_summary(void)
 {
-    assert(c == EOF || (c >= 0 && c <= UCHAR_MAX));
-    return(c >= '0' && c <= '7');
+    free(diag_text);
+    diag_text = 0;
+    diag_len = diag_size = 0;
+    if (warnings_unwritten > 0)
+        err_remark("%zu more warnings not shown (limit of %zu reached)\n",
+                   warnings_unwritten, max_total_warnings);
 }
 
-static int check_punct(int oc, FILE *fp, const char *fn, int (*digit_check)(int c))
+/* Report an allocation that failed in a worker (or in code shared with one) */
+static void nomem_check(size_t nomem)
 {
-    int sq = getch(fp);
-    assert(sq == '\'');
-    s_putch(sq);
-    if (!f_NumPunct)
-        warn_feature(F_NUMPUNCT, fn);
-    if (!(*digit_check)(oc))
-    {
-        warning("Single quote in numeric context not preceded by a valid digit", fn, nline);
-        return sq;
-    }
-    int pc = peek(fp);
-    if (pc == EOF)
+    if (nomem != 0)
     {
-        warning("Single quote in numeric context followed by EOF", fn, nline);
-        return sq;
+        errno = ENOMEM;
+        err_syserr("failed to allocate %zu bytes of memory: ", nomem);
     }
-    if (!(*digit_check)(pc))
-        warning("Single quote in numeric context not followed by a valid digit", fn, nline);
-    return pc;
 }
 
-static inline void parse_exponent(FILE *fp, const char *fn)
+static void out_diag(void *data, const char *name, int line, const char *msg)
 {
-    assert(fp != 0 && fn != 0);
-    /* First character is known to be valid exponent (p, P, e, E) */
-    int c = getch(fp);
-    assert(c == 'e' || c == 'E' || c == 'p' || c == 'P');
-    s_putch(c);
-    int pc = peek(fp);
-    int count = 0;
-    if (pc == '+' || pc == '-')
-        s_putch(getch(fp));
-    while ((pc = peek(fp)) != EOF && isdigit(pc))
-    {
-        count++;
-        s_putch(getch(fp));
-    }
-    if (count == 0)
-    {
-        char msg[80];
-        snprintf(msg, sizeof(msg), "Exponent %c not followed by (optional sign and) one or more digits", c);
-        warning(msg, fn, nline);
-    }
+    (void)data;
+    diag_add(&file_diags, name, line, msg);
+    nomem_check(file_diags.nomem);
 }
 
-static void parse_hex(FILE *fp, const char *fn)
+static void lm_map(void *data, int out_line, size_t out_col, int in_line, size_t in_col)
 {
-    /* Hex constant - integer or float */
-    /* Should be followed by one or more hex digits */
-    s_putch('0');
-    int c = getch(fp);
-    assert(c == 'x' || c == 'X');
-    s_putch(c);
-    int oc = c;
-    int pc;
-    bool warned = false;
-    while ((pc = peek(fp)) == '\'' || isxdigit(pc) || pc == '.')
+    LineMap *lm = data;
+    if (lm->nomem != 0)
+        return;
+    if (lm->num_points >= lm->max_points)
     {
-        if (pc == '\'')
-            oc = check_punct(oc, fp, fn, isxdigit);
-        else
+        size_t new_max = lm->max_points * 2 + 16;
+        void *new_points = realloc(lm->points, new_max * sizeof(*lm->points));
+        if (new_points == 0)
         {
-            if (pc == '.' && !f_HexFloat)
-            {
-                if (!warned)
-                    warn_feature(F_HEXFLOAT, fn);
-                warned = true;
-            }
-            oc = pc;
-            s_putch(getch(fp));
+            /* The next write fails, stopping the output */
+            lm->nomem = new_max * sizeof(*lm->points);
+            return;
         }
+        lm->points = new_points;
+        lm->max_points = new_max;
     }
-    if (pc == 'p' || pc == 'P')
-    {
-        if (!f_HexFloat && !warned)
-            warn_feature(F_HEXFLOAT, fn);
-        parse_exponent(fp, fn);
-    }
+    lm->points[lm->num_points++] = (MapPoint){ out_line, out_col, in_line, in_col };
+}
+
+static int lm_write(void *data, const char *buffer, size_t len)
+{
+    LineMap *lm = data;
+    if (lm->nomem != 0)
+        return -1;
+    return (*lm->next.write)(lm->next.data, buffer, len);
+}
+
+static int lm_writev(void *data, const struct iovec *iov, int iovcnt)
+{
+    LineMap *lm = data;
+    if (lm->nomem != 0)
+        return -1;
+    return (*lm->next.writev)(lm->next.data, iov, iovcnt);
+}
+
+static void lm_diag(void *data, const char *name, int line, const char *msg)
+{
+    LineMap *lm = data;
+    if (lm->next.diag != 0)
+        (*lm->next.diag)(lm->next.data, name, line, msg);
+}
+
+/* Write the blanks held back */
+static int lm_flush(LineMap *lm)
+{
+    size_t nbytes = lm->num_blanks;
+    lm->num_blanks = 0;
+    if (nbytes > 0 && (*lm->next.write)(lm->next.data, lm->blanks, nbytes) != 0)
+        return -1;
+    return 0;
 }
 
-static void parse_binary(FILE *fp, const char *fn)
+static int lm_hold(LineMap *lm, char c)
 {
-    /* Binary constant - integer */
-    /* Should be followed by one or more binary digits */
-    if (!f_Binary)
-        warn_feature(F_BINARY, fn);
-    s_putch('0');     /* 0 */
-    int c = getch(fp);
-    assert(c == 'b' || c == 'B');
-    s_putch(c);     /* b or B */
-    int oc = c;
-    int pc;
-    while ((pc = peek(fp)) == '\'' || is_binary(pc))
+    if (lm->num_blanks >= lm->max_blanks)
     {
-        if (pc == '\'')
-            oc = check_punct(oc, fp, fn, is_binary);
-        else
+        size_t new_max = lm->max_blanks * 2 + 64;
+        void *new_blanks = realloc(lm->blanks, new_max);
+        if (new_blanks == 0)
         {
-            oc = pc;
-            s_putch(getch(fp));
+            lm->nomem = new_max;
+            return -1;
         }
+        lm->blanks = new_blanks;
+        lm->max_blanks = new_max;
     }
-    if (isdigit(pc))
-        warningv("Non-binary digit %c in binary constant", fn, nline, pc);
+    lm->blanks[lm->num_blanks++] = c;
+    return 0;
+}
+
+/* Line of the input that column col of the current line of output comes from */
+static int lm_in_line(LineMap *lm, size_t col)
+{
+    /* The points for the output are reported before it is written */
+    while (lm->cur + 1 < lm->num_points &&
+           (lm->points[lm->cur + 1].out_line < lm->out_line ||
+            (lm->points[lm->cur + 1].out_line == lm->out_line &&
+             lm->points[lm->cur + 1].out_col <= col)))
+        lm->cur++;
+    if (lm->num_points == 0)
+        return lm->expect;
+    const MapPoint *mp = &lm->points[lm->cur];
+    return mp->in_line + (lm->out_line - mp->out_line);
 }
 
-static void parse_octal(FILE *fp, const char *fn)
+static int lm_directive(LineMap *lm, int in_line)
 {
-    /* Octal constant - integer */
-    /* Calling code checked for octal digit or s-quote */
-    s_putch('0');     /* 0 */
-    int c = getch(fp);
-    assert(is_octal(c) || c == '\'');
-    s_putch(c);
-    int oc = c;
-    int pc;
-    while ((pc = peek(fp)) == '\'' || is_octal(pc))
+    char buffer[64];
+    int n = snprintf(buffer, sizeof(buffer), "#line %d \"", in_line);
+    if ((*lm->next.write)(lm->next.data, buffer, (size_t)n) != 0)
+        return -1;
+    for (const char *name = lm->name; *name != '\0'; name++)
     {
-        if (pc == '\'')
-            oc = check_punct(oc, fp, fn, is_octal);
-        else
-        {
-            oc = pc;
-            s_putch(getch(fp));
-        }
+        if ((*name == '"' || *name == '\\') && (*lm->next.write)(lm->next.data, "\\", 1) != 0)
+            return -1;
+        if ((*lm->next.write)(lm->next.data, name, 1) != 0)
+            return -1;
     }
-    if (isdigit(pc))
-        warningv("Non-octal digit %c in octal constant", fn, nline, pc);
+    if ((*lm->next.write)(lm->next.data, "\"\n", 2) != 0)
+        return -1;
+    lm->expect = in_line;
+    lm->named = true;
+    return 0;
 }
 
-static void parse_decimal(int c, FILE *fp, const char *fn)
+/*
+** Write the output, with #line directives where the line numbers are
+** not the input's.  The blanks before each token are held back until
+** the token shows where it comes from.  If it starts a line, any
+** directive goes before the line; otherwise (after blanks replacing a
+** comment that spanned lines, or after a backslash-newline) the line is
+** broken there, which does not change the meaning of code outside a
+** preprocessor directive.  Nothing is inserted within a directive.
+*/
+static int lm_write_lines(void *data, const char *buffer, size_t len)
 {
-    /* Decimal integer, or decimal floating point */
-    s_putch(c);
-    int pc = peek(fp);
-    if (isdigit(pc) || pc == '\'')
+    LineMap *lm = data;
+    const char *end = buffer + len;
+
+    if (lm->nomem != 0)
+        return -1;
+    while (buffer < end)
     {
-        c = getch(fp);
-        assert(c == pc);
-        s_putch(pc);
-        int oc = c;
-        while ((pc = peek(fp)) == '\'' || isdigit(pc))
+        char c = *buffer;
+        if (c == ' ' || c == '\t')
         {
-            /* Assuming isdigit alone generates a function pointer */
-            if (pc == '\'')
-                oc = check_punct(oc, fp, fn, isdigit);
-            else
+            if (lm_hold(lm, c) != 0)
+                return -1;
+            lm->col++;
+            buffer++;
+            continue;
+        }
+        if (c == '\n')
+        {
+            if (lm_flush(lm) != 0 || (*lm->next.write)(lm->next.data, "\n", 1) != 0)
+                return -1;
+            lm->spliced = (lm->last == '\\');
+            lm->last = c;
+            lm->out_line++;
+            lm->expect++;
+            lm->col = 0;
+            lm->at_bol = true;
+            buffer++;
+            continue;
+        }
+        if (lm->at_bol && !lm->spliced)
+            lm->in_directive = (c == '#');
+        bool new_line = (lm->at_bol && !lm->spliced);
+        if (new_line || (!lm->in_directive && (lm->at_bol || lm->num_blanks > 0)))
+        {
+            int in_line = lm_in_line(lm, lm->col);
+            if (in_line != lm->expect || (lm->at_bol && !lm->named))
             {
-                oc = pc;
-                s_putch(getch(fp));
+                if (!new_line && (*lm->next.write)(lm->next.data, "\n", 1) != 0)
+                    return -1;
+                if (lm_directive(lm, in_line) != 0)
+                    return -1;
             }
         }
-        if (pc == 'e' || pc == 'E')
-            parse_exponent(fp, fn);
+        lm->at_bol = false;
+        if (lm_flush(lm) != 0)
+            return -1;
+        const char *ptr = buffer;
+        while (ptr < end && *ptr != ' ' && *ptr != '\t' && *ptr != '\n')
+            ptr++;
+        if ((*lm->next.write)(lm->next.data, buffer, (size_t)(ptr - buffer)) != 0)
+            return -1;
+        lm->col += (size_t)(ptr - buffer);
+        lm->last = ptr[-1];
+        buffer = ptr;
     }
+    return 0;
 }
 
 /*
-** Parse numbers - inherently unsigned.
-** Need to recognize:-
-** 12345            // Decimal
-** 01234567         // Octal - validation not required?
-** 0xABCDEF12       // Hexadecimal
-** 0b01101100       // C++14 binary
-** 9e-82            // Float
-** 9.23             // Float
-** .987             // Float
-** .987E+30         // Float
-** 0xA.BCP12        // C99 Hex floating point
-** 0B0110'1100      // C++14 punctuated binary number
-** 0XDEFA'CED0      // C++14 punctuated hex number
-** 234'567.123'987  // C++14 punctuated decimal number
-** 0'234'127'310    // C++14 punctuated octal number
-** 9'234.192'214e-8 // C++14 punctuated decimal Float
-** 0xA'B'C.B'Cp-12  // C++17 Presumed punctuated Hex floating point
-**
-** Note that backslash-newline can occur part way through a number.
+** A sink that notes the points of the map of the output of file name,
+** and writes the output to next, with #line directives if wanted.
 */
+static SCC_Sink lm_sink(LineMap *lm, const char *name, bool first, const SCC_Sink *next)
+{
+    SCC_Sink sink = { .write = lm_write, .diag = lm_diag, .data = lm, .map = lm_map, .flags = next->flags };
+    *lm = (LineMap){ .next = *next, .name = name, .named = first, .out_line = 1, .expect = 1,
+                     .at_bol = true };
+    if (line_directives)
+        sink.write = lm_write_lines;
+    else if (next->writev != 0)
+        sink.writev = lm_writev;
+    return sink;
+}
+
+static void lm_free(LineMap *lm)
+{
+    free(lm->points);
+    free(lm->blanks);
+    lm->points = 0;
+    lm->blanks = 0;
+}
 
-static void parse_number(int c, FILE *fp, const char *fn)
-{
-    assert(isdigit(c) || c == '.');
-    int pc = peek(fp);
-    if (c != '0')
-        parse_decimal(c, fp, fn);
-    else if (pc == 'x' || pc == 'X')
-        parse_hex(fp, fn);
-    else if ((pc == 'b' || pc == 'B'))
-        parse_binary(fp, fn);
-    else if (is_octal(pc) || pc == '\'')
-        parse_octal(fp, fn);
-    else if (pc == 'e' || pc == 'E' || pc == '.')
-    {
-        /* Simple fractional (0.1234) or zero floating point decimal constant 0E0 */
-        parse_decimal(c, fp, fn);
-    }
-    else if (isdigit(pc))
-    {
-        /*
-        ** Malformed number of some sort (09, for example).
-        ** Preprocessing numbers can contain all sorts of weird stuff.
-        ** 08 is valid as a preprocessing number, and has appeared in
-        ** macros.  It ended up as part of "%08X" or similar format
-        ** strings.  Hence, do not generate error message after all.
-        ** err_remark("0%c read - bogus number!\n", pc);
-        */
-        s_putch(c);
+/* Add the map of the output of a file, which follows the output mapped so far (--map) */
+static void map_add(const LineMap *lm)
+{
+    if (lm->num_points == 0)
+        return;
+    if (num_map_sources >= max_map_sources)
+    {
+        size_t new_max = max_map_sources * 2 + 16;
+        void *new_sources = realloc(map_sources, new_max * sizeof(*map_sources));
+        if (new_sources == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", new_max * sizeof(*map_sources));
+        map_sources = new_sources;
+        max_map_sources = new_max;
     }
-    else
+    if ((map_sources[num_map_sources] = strdup(lm->name)) == 0)
+        err_syserr("failed to allocate %zu bytes of memory: ", strlen(lm->name) + 1);
+    size_t need = num_map_entries + lm->num_points;
+    if (need > max_map_entries)
+    {
+        size_t new_max = max_map_entries * 2 + need;
+        void *new_entries = realloc(map_entries, new_max * sizeof(*map_entries));
+        if (new_entries == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", new_max * sizeof(*map_entries));
+        map_entries = new_entries;
+        max_map_entries = new_max;
+    }
+    /* The last point is the end */
+    for (size_t i = 0; i < lm->num_points; i++)
     {
-        /* Just a zero? -- e.g. array[0] */
-        s_putch(c);
+        const MapPoint *mp = &lm->points[i];
+        int out_line = map_end_line + mp->out_line - 1;
+        size_t out_col = (mp->out_line == 1) ? map_end_col + mp->out_col : mp->out_col;
+        if (i == lm->num_points - 1)
+        {
+            map_end_line = out_line;
+            map_end_col = out_col;
+        }
+        else
+        {
+            map_entries[num_map_entries++] =
+                (MapEntry){ out_line, out_col, num_map_sources, mp->in_line, mp->in_col };
+        }
     }
+    num_map_sources++;
 }
 
-static void read_remainder_of_identifier(FILE *fp, const char *fn)
+static void map_varint(FILE *fp, uint64_t value)
 {
-    int c;
-    while ((c = peek(fp)) != EOF && is_idchar(c))
+    while (value >= 0x80)
     {
-        c = getch(fp);
-        s_putch(c);
+        putc((int)(value & 0x7F) | 0x80, fp);
+        value >>= 7;
     }
+    putc((int)value, fp);
 }
 
-static inline bool could_be_string_literal(char c)
+/* Signed differences, zigzag encoded: 0, -1, 1, -2, ... as 0, 1, 2, 3, ... */
+static void map_delta(FILE *fp, int64_t delta)
 {
-    return(c == 'U' || c == 'u' || c == 'L' || c == 'R' || c == '8');
+    map_varint(fp, (delta < 0) ? ((uint64_t)(-(delta + 1)) << 1) | 1 : (uint64_t)delta << 1);
 }
 
-static bool valid_dq_raw_prefix(const char *prefix)
+/*
+** The binary map: "SCCMAP1\n"; the number of sources, and the length
+** and bytes of each name; the number of points, and for each point the
+** change in the output line since the previous point, the output column
+** (the change in it, if the line is the same), then the changes in the
+** source index, input line and input column, signed.  The previous
+** point before the first is output line 1, column 0, source 0, input
+** line 1, column 0.  Every number is a variable-length integer, 7 bits
+** to a byte, least significant first, with the top bit set on all but
+** the last byte.
+*/
+static void map_binary(FILE *fp)
 {
-    for (int i = 0; i < NUM_DQ_RAW_PREFIX; i++)
+    MapEntry prev = { 1, 0, 0, 1, 0 };
+    fputs("SCCMAP1\n", fp);
+    map_varint(fp, num_map_sources);
+    for (size_t i = 0; i < num_map_sources; i++)
+    {
+        size_t len = strlen(map_sources[i]);
+        map_varint(fp, len);
+        fwrite(map_sources[i], sizeof(char), len, fp);
+    }
+    map_varint(fp, num_map_entries);
+    for (size_t i = 0; i < num_map_entries; i++)
     {
-        if (strcmp(prefix, dq_raw_prefix[i]) == 0)
-            return true;
+        const MapEntry *mp = &map_entries[i];
+        map_varint(fp, (uint64_t)(mp->out_line - prev.out_line));
+        map_varint(fp, (mp->out_line == prev.out_line) ? mp->out_col - prev.out_col : mp->out_col);
+        map_delta(fp, (int64_t)mp->source - (int64_t)prev.source);
+        map_delta(fp, (int64_t)mp->in_line - prev.in_line);
+        map_delta(fp, (int64_t)mp->in_col - (int64_t)prev.in_col);
+        prev = *mp;
     }
-    return false;
 }
 
-static bool valid_dq_reg_prefix(const char *prefix)
+/* The JSON map: each point is [out_line, out_col, source, in_line, in_col] */
+static void map_json(FILE *fp)
 {
-    for (int i = 0; i < NUM_DQ_REG_PREFIX; i++)
+    fprintf(fp, "{\n  \"version\": 1,\n  \"sources\": [");
+    for (size_t i = 0; i < num_map_sources; i++)
     {
-        if (strcmp(prefix, dq_reg_prefix[i]) == 0)
-            return true;
+        fprintf(fp, "%s\n    ", (i == 0) ? "" : ",");
+        json_string(fp, map_sources[i]);
     }
-    return false;
+    fprintf(fp, "\n  ],\n  \"points\": [");
+    for (size_t i = 0; i < num_map_entries; i++)
+    {
+        const MapEntry *mp = &map_entries[i];
+        fprintf(fp, "%s\n    [%d, %zu, %zu, %d, %zu]", (i == 0) ? "" : ",",
+                mp->out_line, mp->out_col, mp->source, mp->in_line, mp->in_col);
+    }
+    fprintf(fp, "\n  ]\n}\n");
 }
 
-static bool valid_dq_prefix(const char *prefix)
+/* Write the source map (--map) to its file */
+static void map_write(void)
 {
-    return valid_dq_reg_prefix(prefix) || valid_dq_raw_prefix(prefix);
+    FILE *fp = fopen(map_file, "wb");
+    if (fp == 0)
+        err_syserr("failed to open map file %s: ", map_file);
+    if (map_format == MF_JSON)
+        map_json(fp);
+    else
+        map_binary(fp);
+    if (fclose(fp) != 0)
+        err_syserr("failed to write map file %s: ", map_file);
+
+    for (size_t i = 0; i < num_map_sources; i++)
+        free(map_sources[i]);
+    free(map_sources);
+    free(map_entries);
+    map_sources = 0;
+    map_entries = 0;
+    num_map_sources = max_map_sources = 0;
+    num_map_entries = max_map_entries = 0;
 }
 
-static bool raw_scan_marker(char *markstr, int *marklen, const char *pfx, FILE *fp, const char *fn)
+/*
+** Strip the input in src to sink, with nthreads threads, or send the
+** results kept in the cache (--cache) for the same contents and options
+** instead, keeping them on a miss.  When op is not null, it is pointed
+** at a cache entry while the entry is written, so that the kernel can
+** copy from the entry as it does from the input.  The cache is not
+** used when the sink wants a source map, which the cache does not keep.
+** The counts for the input are set in *stats.  Returns 0, or -1 if the
+** sink failed.
+*/
+static int strip_cached(SCC_Scanner *sc, const char *fn, const Source *src,
+                        const SCC_Sink *sink, int nthreads, Output *op, SCC_Stats *stats)
 {
-    int len = 0;
-    int c;
-    char message[128];
-    while ((c = getch(fp)) != EOF)
+    CacheKey key;
+    CacheRecord rec = { .cache = 0 };
+    SCC_Sink tee = *sink;
+    int rc;
+
+    if (cache != 0 && sink->map == 0 && comments_fp == 0 && cache_eligible(cache, src->len))
     {
-        if (c == LPAREN)
-        {
-            /* End of marker */
-            assert(len <= MAX_RAW_MARKER);
-            markstr[len] = '\0';
-            *marklen = len;
-            return true;
-        }
-        else if (strchr("\") \\\t\v\f\n", c) != 0 || len >= MAX_RAW_MARKER)
+        SCC_Options opts;
+        CacheEntry entry;
+        scc_get_options(sc, &opts);
+        key = cache_key(cache, &opts, src->base, src->len);
+        if (cache_lookup(cache, &key, &entry))
         {
-            /* Invalid mark character or marker is too long */
-            if (len >= MAX_RAW_MARKER)
+            Output saved;
+            if (op != 0)
             {
-                markstr[len++] = c;
-                markstr[len] = '\0';
-                snprintf(message, sizeof(message),
-                         "Too long a raw string d-char-sequence: %s\"%.*s",
-                         pfx, len, markstr);
+                saved = *op;
+                op->in_fd = entry.fd;
+                op->map_lo = entry.map;
+                op->map_hi = entry.map + entry.map_len;
             }
-            else
-            {
-                char qc[10] = "";
-                if (isgraph(c))
-                    snprintf(qc, sizeof(qc), " '%s%c'",
-                             ((c == '\'' || c == '\\') ? "\\" : ""), c);
-                snprintf(message, sizeof(message),
-                         "Invalid mark character (code %d%s) in d-char-sequence: %s\"%.*s",
-                         c, qc, pfx, len, markstr);
-            }
-            warning(message, fn, nline);
-            markstr[len++] = c;
-            markstr[len] = '\0';
-            *marklen = len;
-            return false;
+            rc = cache_replay(&entry, fn, sink);
+            if (op != 0)
+                *op = saved;
+            *stats = entry.stats;
+            cache_release(&entry);
+            return rc;
         }
-        else
-            markstr[len++] = c;
+        tee = cache_record(&rec, cache, &key, sink);
     }
-    snprintf(message, sizeof(message),
-             "Unexpected EOF in raw string d-char-sequence: %s\"%.*s",
-             pfx, len, markstr);
-    warning(message, fn, nline);
-    markstr[len] = '\0';
-    *marklen = len;
-    return false;
+    scc_reset_stats(sc);
+    rc = scc_strip_parallel(sc, fn, src->base, src->len, &tee, nthreads, 0);
+    scc_get_stats(sc, stats);
+    if (rec.cache != 0)
+        cache_store(&rec, stats, rc == 0);
+    return rc;
 }
 
-/* Look for ) followed by markstr and double quote */
-static void raw_scan_string(const char *markstr, int marklen, FILE *fp, const char *fn, int line1)
+static int ip_fail(InPlace *ip, const char *failed)
 {
-    int c;
-
-    while ((c = getch(fp)) != EOF)
+    if (ip->error == 0)
     {
-        if (c != RPAREN)
-            s_putch(c);
-        else
-        {
-            char endstr[MAX_RAW_MARKER + 2];
-            int len = 0;
-            while ((c = getch(fp)) != EOF)
-            {
-                if (c == '"' && len == marklen)
-                {
-                    /* Got the end! */
-                    s_putch(RPAREN);
-                    s_putstr(markstr);
-                    s_putch(c);
-                    return;
-                }
-                else if (c == markstr[len])
-                    endstr[len++] = c;
-                else if (c == RPAREN)
-                {
-                    /* Restart scan for mark string */
-                    endstr[len] = '\0';
-                    s_putch(RPAREN);
-                    s_putstr(endstr);
-                    len = 0;
-                }
-                else
-                {
-                    endstr[len] = '\0';
-                    s_putch(RPAREN);
-                    s_putstr(endstr);
-                    s_putch(c);
-                    break;
-                }
-            }
-        }
+        ip->error = (errno != 0) ? errno : EIO;
+        ip->failed = failed;
     }
-    warning("Unexpected EOF in raw string starting at this line", fn, line1);
-}
-
-static void parse_raw_string(const char *prefix, FILE *fp, const char *fn)
-{
-    /*
-    ** Have read up to and including the double quote at the start of a
-    ** raw string literal (u8R" for example) and prefix but not double
-    ** quote has been printed.  Now find lead mark and open parenthesis.
-    ** NB: lead mark is not allowed to be longer than 16 characters.
-    ** u8R"lead(data)lead" is valid, as is u8R"(data)".
-    **
-    ** In the standard, the lead mark characters are called 'd-char's: any
-    ** member of the basic source character set except: space, the left
-    ** parenthesis (, the right parenthesis ), the backslash \, and the
-    ** control characters representing horizontal tab, vertical tab,
-    ** form feed, and newline.
-    **
-    ** A string literal that has an R in the prefix is a raw string
-    ** literal.  The d-char-sequence serves as a delimiter.  The
-    ** terminating d-char-sequence of a raw-string is the same sequence
-    ** of characters as the initial d-charsequence.  A d-char-sequence
-    ** shall consist of at most 16 characters.
-    **
-    ** NB: The fact that backslash is not allowed in the marker means
-    **     that double quote is also prohibited since it would have to
-    **     be preceded by a backslash.
-    **
-    ** Processing:
-    ** 1. Find valid lead mark - up to first (.
-    ** 2. If invalid, report as such and process as ordinary dq-string.
-    ** 3. Else find ) and lead mark followed by close dq.
-    **    - NB: R"aa( )aa )aa" is valid; the first ")aa" is content
-    **      because it is not followed by a double quote.
-    ** 4. If EOF encountered first, report the problem.
-    ** Save nline for start of literal.
-    **
-    ** NB: If replacing string characters, the raw string delimiters are
-    **     printed unmapped, but the body of the raw string is printed
-    **     as the replacement character.
-    */
-    assert(prefix != 0 && fp != 0 && fn != 0);
-    char markstr[MAX_RAW_MARKER + 2];
-    int  marklen;
-    if (raw_scan_marker(markstr, &marklen, prefix, fp, fn))
-    {
-        s_putch('"');
-        s_putstr(markstr);
-        s_putch(LPAREN);
-        raw_scan_string(markstr, marklen, fp, fn, nline);
+    return -1;
+}
+
+/* The name of the file replaced */
+static const char *ip_path(const InPlace *ip)
+{
+    return (ip->path != 0) ? ip->path : ip->name;
+}
+
+/* Create the temporary file, and write the output that matched the input to it */
+static int ip_create(InPlace *ip)
+{
+    const char *path = ip_path(ip);
+    const char *slash = strrchr(path, '/');
+    size_t dlen = (slash == 0) ? 0 : (size_t)(slash + 1 - path);
+    const char *base = path + dlen;
+    size_t size = dlen + strlen(base) + sizeof(".scc.XXXXXX") + 1;
+
+    if ((ip->tmp = malloc(size)) == 0)
+        return ip_fail(ip, "failed to allocate memory to strip file in place");
+    snprintf(ip->tmp, size, "%.*s.%s.scc.XXXXXX", (int)dlen, path, base);
+    if ((ip->out.fd = mkstemp(ip->tmp)) < 0)
+    {
+        free(ip->tmp);
+        ip->tmp = 0;
+        return ip_fail(ip, "failed to create temporary file for");
     }
-    else
+    if (ip->same > 0)
     {
-        s_putch('"');
-        put_quote_str('"', markstr);
-        endquote('"', fp, fn, "string literal");
+        struct iovec iov = { .iov_base = (void *)ip->in, .iov_len = ip->same };
+        if (fd_writev(&ip->out, &iov, 1) != 0)
+            return ip_fail(ip, "failed to write temporary file for");
     }
+    return 0;
 }
 
-static void parse_dq_string(const char *prefix, FILE *fp, const char *fn)
+static int ip_write(void *data, const char *buffer, size_t len)
 {
-    assert(valid_dq_prefix(prefix));
-    if (valid_dq_raw_prefix(prefix))
+    InPlace *ip = data;
+    if (ip->out.fd < 0)
     {
-        if (!f_RawString)
-            warn_feature(F_RAWSTRING, fn);
-        s_putstr(prefix);
-        parse_raw_string(prefix, fp, fn);
+        if (len <= ip->in_len - ip->same &&
+            (buffer == ip->in + ip->same || memcmp(buffer, ip->in + ip->same, len) == 0))
+        {
+            ip->same += len;
+            return 0;
+        }
+        if (ip_create(ip) != 0)
+            return -1;
     }
-    else
+    if (fd_write(&ip->out, buffer, len) != 0)
+        return ip_fail(ip, "failed to write temporary file for");
+    return 0;
+}
+
+static int ip_writev(void *data, const struct iovec *iov, int iovcnt)
+{
+    InPlace *ip = data;
+    while (iovcnt > 0 && ip->out.fd < 0)
     {
-        if (strcmp(prefix, "L") != 0 && !f_Unicode)
-            warn_feature(F_UNICODE, fn);
-        s_putstr(prefix);
-        s_putch('"');
-        endquote('"', fp, fn, "string literal");
+        if (ip_write(ip, iov->iov_base, iov->iov_len) != 0)
+            return -1;
+        iov++;
+        iovcnt--;
     }
+    if (iovcnt > 0 && fd_writev(&ip->out, iov, iovcnt) != 0)
+        return ip_fail(ip, "failed to write temporary file for");
+    return 0;
 }
 
-static void process_poss_string_literal(char c, FILE *fp, const char *fn)
+static void ip_diag(void *data, const char *name, int line, const char *msg)
 {
-    char prefix[6] = "";
-    int idx = 0;
-    prefix[idx++] = c;
-    while ((c = peek(fp)) != EOF)
+    InPlace *ip = data;
+    if (ip->next.diag != 0)
+        (*ip->next.diag)(ip->next.data, name, line, msg);
+}
+
+/* Replace the original with the temporary file, unless nothing changed */
+static int ip_finish(InPlace *ip)
+{
+    if (ip->error == 0 && ip->out.fd < 0 && ip->same == ip->in_len)
+        return 0;
+    if (ip->error == 0 && ip->out.fd < 0)
+        ip_create(ip);
+    if (ip->error == 0 && fsync_flag && fsync(ip->out.fd) != 0)
+        ip_fail(ip, "failed to sync temporary file for");
+    if (ip->error == 0)
+    {
+        /* The owner may not be settable; the mode is set anyway */
+        if (fchown(ip->out.fd, ip->st.st_uid, ip->st.st_gid) != 0 && errno != EPERM)
+            ip_fail(ip, "failed to set owner of temporary file for");
+        else if (fchmod(ip->out.fd, ip->st.st_mode & 07777) != 0)
+            ip_fail(ip, "failed to set mode of temporary file for");
+    }
+    if (ip->out.fd >= 0 && close(ip->out.fd) != 0)
+        ip_fail(ip, "failed to close temporary file for");
+    ip->out.fd = -1;
+    if (ip->error == 0 && *in_place != '\0')
     {
-        if (c == '\'')
+        size_t size = strlen(ip_path(ip)) + strlen(in_place) + 1;
+        char *backup = malloc(size);
+        if (backup == 0)
+            ip_fail(ip, "failed to allocate memory to strip file in place");
+        else
         {
-            /* process sinqle quote */
-            /* Curiously, it really doesn't matter if the prefix is valid or not */
-            /* SCC will process it the same way, printing prefix and then processing single quote */
-            s_putstr(prefix);
-            c = getch(fp);
-            s_putch(c);
-            endquote(c, fp, fn, "character constant");
-            break;
+            snprintf(backup, size, "%s%s", ip_path(ip), in_place);
+            if ((unlink(backup) != 0 && errno != ENOENT) || link(ip_path(ip), backup) != 0)
+                ip_fail(ip, "failed to keep backup of");
+            free(backup);
         }
-        else if (c == '"')
+    }
+    if (ip->error == 0 && rename(ip->tmp, ip_path(ip)) != 0)
+        ip_fail(ip, "failed to replace");
+    if (ip->error != 0 && ip->tmp != 0)
+        unlink(ip->tmp);
+    free(ip->tmp);
+    free(ip->path);
+    ip->tmp = 0;
+    ip->path = 0;
+    return (ip->error == 0) ? 0 : -1;
+}
+
+/*
+** Strip the file open on fd, whose contents are in src, in place.  The
+** warnings go to next, and the counts to *stats.  Returns the time
+** spent stripping, which excludes the time spent writing; ip->error is
+** set on failure.
+*/
+static double ip_strip(InPlace *ip, SCC_Scanner *sc, int fd, const char *fn,
+                       const Source *src, const SCC_Sink *next, SCC_Stats *stats)
+{
+    *ip = (InPlace){ .name = fn, .in = src->base, .in_len = src->len, .next = *next };
+    ip->out = (Output){ -1, KC_NONE, fd, src->map, (const char *)src->map + src->maplen };
+    if (src->map != 0)
+        ip->out.kcopy = KC_COPY_RANGE;
+    if (fstat(fd, &ip->st) != 0)
+    {
+        ip_fail(ip, "failed to stat");
+        return 0.0;
+    }
+    if (!S_ISREG(ip->st.st_mode))
+    {
+        errno = EINVAL;
+        ip_fail(ip, "failed to strip in place non-regular file");
+        return 0.0;
+    }
+    /* A symbolic link is left alone, and the file open on fd replaced */
+    struct stat lsb;
+    if (lstat(fn, &lsb) != 0)
+    {
+        ip_fail(ip, "failed to stat");
+        return 0.0;
+    }
+    if (S_ISLNK(lsb.st_mode))
+    {
+        struct stat tsb;
+        if ((ip->path = realpath(fn, 0)) == 0)
         {
-            /* process double quote - possibly raw */
-            if (valid_dq_prefix(prefix))
-            {
-                c = getch(fp);
-                parse_dq_string(prefix, fp, fn);
-            }
-            else
-            {
-                /* Invalid syntax - identifier followed by double quote */
-                s_putstr(prefix);
-                c = getch(fp);
-                s_putch(c);
-                endquote(c, fp, fn, "character constant");
-            }
-            break;
+            ip_fail(ip, "failed to resolve symbolic link");
+            return 0.0;
         }
-        else if (could_be_string_literal(c))
+        if (stat(ip->path, &tsb) != 0)
+            ip_fail(ip, "failed to stat");
+        else if (tsb.st_dev != ip->st.st_dev || tsb.st_ino != ip->st.st_ino)
         {
-            c = getch(fp);
-            prefix[idx++] = c;
-            if (idx > 3)
-            {
-                s_putstr(prefix);
-                read_remainder_of_identifier(fp, fn);
-                break;
-            }
-            /* Only loop continuation */
+            errno = ESTALE;
+            ip_fail(ip, "symbolic link changed while stripping");
         }
-        else
+        if (ip->error != 0)
         {
-            s_putstr(prefix);
-            read_remainder_of_identifier(fp, fn);
-            break;
+            free(ip->path);
+            ip->path = 0;
+            return 0.0;
         }
     }
+
+    SCC_Sink sink = { .write = ip_write, .diag = ip_diag, .data = ip, .writev = ip_writev,
+                      .flags = next->flags };
+    TimedSink ts = { .seconds = 0.0 };
+    LineMap lm;
+    if (stats_format != ST_NONE)
+        sink = timed_sink(&ts, &sink);
+    if (line_directives)
+        sink = lm_sink(&lm, fn, true, &sink);
+    double start = now_seconds();
+    /* A failure of the library leaves the original alone (a sink failure is already set) */
+    if (strip_cached(sc, fn, src, &sink, 1, 0, stats) != 0)
+    {
+        if (line_directives && lm.nomem != 0)
+            errno = ENOMEM;
+        ip_fail(ip, "failed to strip");
+    }
+    double seconds = now_seconds() - start - ts.seconds;
+    if (line_directives)
+    {
+        lm_flush(&lm);
+        lm_free(&lm);
+    }
+    ip_finish(ip);
+    return seconds;
 }
 
 /*
-** Parse identifiers.
-** Also parse strings and characters preceded by alphanumerics (raw
-** strings, Unicode strings, and some character literals).
-** L"xxx" in all standard variants of C and C++.
-** u"xxx", U"xxx", u8"xxx from C11 and C++11 onwards.
-** R"y(xxx)y", LR"y(xxx)y", uR"y(xxx)y", UR"y(xxx)y" and u8R"y(xxx)y" in C++11 onwards.
-** L'x' in all standard variants of C and C++.
-** U'x' and u'x' from C11 and C++11 onwards.
-** No space is allowed between the prefix and the quote.
-**
-** NB: UCNs in an identifier are parsed independently of 'identifier'.
+** Strip a pipe, terminal, etc as it arrives, a block at a time, so that
+** the memory used does not depend on the size of the input.  Returns
+** the time spent in the library, which excludes the time reading.
 */
-static void parse_identifier(int c, FILE *fp, const char *fn)
+static double scc_stream(int fd, const char *fn, const SCC_Sink *sink)
 {
-    assert(isalpha(c) || c == '_');
-    if (could_be_string_literal(c))
-        process_poss_string_literal(c, fp, fn);
-    else
+    double seconds = 0.0;
+    double start;
+
+    if (source.rd_buffer == 0)
     {
-        s_putch(c);
-        read_remainder_of_identifier(fp, fn);
+        if ((source.rd_buffer = malloc(RD_BLOCKSIZE)) == 0)
+            err_syserr("failed to allocate %d bytes of memory: ", RD_BLOCKSIZE);
+        source.rd_size = RD_BLOCKSIZE;
+    }
+
+    start = now_seconds();
+    scc_stream_begin(scanner, fn, sink);
+    seconds += now_seconds() - start;
+    for (;;)
+    {
+        ssize_t nbytes = read(fd, source.rd_buffer, source.rd_size);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+            err_sysrem("read error on file %s\n", fn);
+        if (nbytes <= 0)
+            break;
+        start = now_seconds();
+        int rc = scc_stream_write(scanner, source.rd_buffer, (size_t)nbytes);
+        seconds += now_seconds() - start;
+        if (rc != 0)
+            break;
     }
+    start = now_seconds();
+    scc_stream_end(scanner);
+    return seconds + now_seconds() - start;
 }
 
-static Comment non_comment(int c, FILE *fp, const char *fn)
+/* A file with a NUL byte near the start is taken to be binary */
+static bool is_binary(const Source *src)
 {
-    int pc;
-    Comment status = NonComment;
-    if (c == '*')
+    size_t len = (src->len < BINARY_CHECK) ? src->len : BINARY_CHECK;
+    return memchr(src->base, '\0', len) != 0;
+}
+
+/* Strip a file in place (-i) */
+static void scc_in_place(FILE *fp, const char *fn, bool text_only)
+{
+    SCC_Sink next = { .diag = out_diag, .flags = SCC_SINK_UNORDERED };
+    SCC_Stats stats = { 0 };
+    InPlace ip;
+
+    int err = src_open(&source, fp);
+    if (err != 0)
+    {
+        errno = err;
+        err_sysrem("read error on file %s\n", fn);
+    }
+    else if (!text_only || !is_binary(&source))
     {
-        int bsnl = read_bsnl(fp);
-        if ((pc = peek(fp)) == '/')
+        double seconds = ip_strip(&ip, scanner, fileno(fp), fn, &source, &next, &stats);
+        if (ip.error != 0)
         {
-            c = getch(fp);
-            s_putch('*');
-            write_bsnl(bsnl, s_putch);
-            s_putch('/');
-            if (l_cend != nline)
-                warning("C-style comment end marker ('*/') not in a comment",
-                        fn, nline);
-            l_cend = nline;
+            errno = ip.error;
+            err_sysrem("%s %s\n", ip.failed, fn);
         }
+        if (stats_format != ST_NONE)
+            stats_add_file(fn, &stats, seconds);
+    }
+    src_close(&source);
+}
+
+static void scc_file(FILE *fp, const char *fn, bool text_only)
+{
+    SCC_Sink sink = { .write = out_write, .diag = out_diag, .data = stdout, .flags = SCC_SINK_UNORDERED };
+    int fd = fileno(fp);
+    TimedSink ts = { .seconds = 0.0 };
+    bool mapping = (map_file != 0 || line_directives);
+    LineMap lm;
+    SCC_Stats stats;
+    double seconds;
+
+    if (in_place != 0)
+    {
+        scc_in_place(fp, fn, text_only);
+        diag_flush(&file_diags);
+        return;
+    }
+    source.map = 0;
+    bool mapped = src_map(&source, fd);
+    if (mapped && text_only && is_binary(&source))
+    {
+        src_close(&source);
+        return;
+    }
+    /* With --stats, the time spent in the sink is excluded */
+    if (!mapped)
+    {
+        if (stats_format != ST_NONE)
+            sink = timed_sink(&ts, &sink);
+        if (mapping)
+            sink = lm_sink(&lm, fn, lm_files++ == 0, &sink);
+        scc_reset_stats(scanner);
+        seconds = scc_stream(fd, fn, &sink);
+        scc_get_stats(scanner, &stats);
+    }
+    else
+    {
+        /* Zero-copy output, bypassing stdio */
+        SCC_Sink fd_sink = { .write = fd_write, .diag = out_diag, .data = &output, .writev = fd_writev,
+                             .flags = SCC_SINK_UNORDERED };
+        if (stats_format != ST_NONE)
+            fd_sink = timed_sink(&ts, &fd_sink);
+        if (mapping)
+            fd_sink = lm_sink(&lm, fn, lm_files++ == 0, &fd_sink);
+        fflush(stdout);
+        output.in_fd = fd;
+        output.map_lo = source.map;
+        output.map_hi = (char *)source.map + source.maplen;
+        double start = now_seconds();
+        strip_cached(scanner, fn, &source, &fd_sink, nthreads, &output, &stats);
+        seconds = now_seconds() - start;
+        src_close(&source);
+    }
+    if (mapping)
+    {
+        lm_flush(&lm);
+        nomem_check(lm.nomem);
+        if (map_file != 0)
+            map_add(&lm);
+        lm_free(&lm);
+    }
+    diag_flush(&file_diags);
+    if (stats_format != ST_NONE)
+        stats_add_file(fn, &stats, seconds - ts.seconds);
+}
+
+static void scc(FILE *fp, char *fn)
+{
+    scc_file(fp, fn, false);
+}
+
+/*
+** Names of files from trees were allocated; those from the command
+** line were not, and those from a list (--files-from) point into it.
+*/
+static void in_files_free(void)
+{
+    for (size_t i = 0; i < num_in_files; i++)
+    {
+        if (in_files[i].text_only)
+            free(in_files[i].name);
+    }
+    free(in_files);
+    free(file_list);
+    in_files = 0;
+    file_list = 0;
+    num_in_files = max_in_files = 0;
+}
+
+/* End the output for a file with a NUL byte (--null-output) */
+static void null_record(void)
+{
+    putchar('\0');
+    if (comments_fp != 0)
+        putc('\0', comments_fp);
+}
+
+/* Strip a file found in a tree or listed, or named with -j, as filter() does */
+static void in_file_strip(const char *name, int std_code, bool text_only)
+{
+    if (strcmp(name, "-") == 0)
+    {
+        scc_set_std(scanner, std_code);
+        scc_file(stdin, "(standard input)", text_only);
+    }
+    else
+    {
+        FILE *fp = fopen(name, "r");
+        if (fp == 0)
+            err_sysrem("failed to open file %s\n", name);
         else
         {
-            s_putch(c);
-            write_bsnl(bsnl, s_putch);
+            scc_set_std(scanner, std_code);
+            scc_file(fp, name, text_only);
+            fclose(fp);
         }
     }
-    else if (c == '\'')
-    {
-        s_putch(c);
-        /*
-        ** Single quotes can contain multiple characters, such as
-        ** '\\', '\'', '\377', '\x4FF', 'ab', '/ *' (with no space, and
-        ** the reverse character pair) , etc.  Scan for an unescaped
-        ** closing single quote.  Newlines are not acceptable either,
-        ** unless preceded by a backslash -- so both '\<nl>\n' and
-        ** '\\<nl>n' are OK, and are equivalent to a newline character
-        ** (when <nl> is a physical newline in the source code).
-        */
-        endquote(c, fp, fn, "character constant");
-    }
-    else if (c == '"')
-    {
-        s_putch(c);
-        /* Double quotes are relatively simple, except that */
-        /* they can legitimately extend over several lines */
-        /* when each line is terminated by a backslash */
-        endquote(c, fp, fn, "string literal");
-    }
-    else if (c == '/')
-    {
-        /* Potential start of comment */
-        int bsnl = read_bsnl(fp);
-        if ((pc = peek(fp)) == '*')
+}
+
+/* Strip the files found in trees (-r) or listed (--files-from) */
+static void scc_in_files(void)
+{
+    for (size_t i = 0; i < num_in_files; i++)
+    {
+        InFile *ip = &in_files[i];
+        in_file_strip(ip->name, ip->std_code, ip->text_only);
+        if (null_output)
+            null_record();
+    }
+}
+
+/*
+** Recursive directory mode (-r dir).  Each directory is read through a
+** descriptor, and its subdirectories are opened and its entries of
+** unknown type are examined with openat() and fstatat() relative to
+** it, so that no path is looked up from the root again.  The entries
+** are taken in name order, so that the order of the output does not
+** depend on the file system.  Symbolic links are not followed.  Files
+** are chosen, and their standard set, by extension (ext_std); those
+** that look binary are skipped when they are stripped.
+*/
+static void ext_std_add(const char *ext, int std_code)
+{
+    if (num_ext_std >= MAX_EXT_STD)
+        err_error("Too many extensions (%d allowed)\n", MAX_EXT_STD);
+    ext_std[num_ext_std++] = (ExtStd){ ext, std_code };
+}
+
+static int ext_std_code(const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    if (dot == 0 || dot == name)
+        return -1;
+    for (size_t i = num_ext_std; i-- > 0; )
+    {
+        if (strcmp(dot, ext_std[i].ext) == 0)
+            return ext_std[i].std_code;
+    }
+    return -1;
+}
+
+static void in_file_add(char *name, int std_code, bool text_only)
+{
+    if (num_in_files >= max_in_files)
+    {
+        size_t new_max = max_in_files * 2 + 16;
+        void *new_files = realloc(in_files, new_max * sizeof(*in_files));
+        if (new_files == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", new_max * sizeof(*in_files));
+        in_files = new_files;
+        max_in_files = new_max;
+    }
+    in_files[num_in_files++] = (InFile){ name, std_code, text_only };
+}
+
+static char *path_join(const char *dir, const char *name)
+{
+    size_t dlen = strlen(dir);
+    size_t nlen = strlen(name);
+    bool slash = (dlen > 0 && dir[dlen - 1] != '/');
+    char *path = malloc(dlen + slash + nlen + 1);
+    if (path == 0)
+        err_syserr("failed to allocate %zu bytes of memory: ", dlen + slash + nlen + 1);
+    memcpy(path, dir, dlen);
+    if (slash)
+        path[dlen] = '/';
+    memcpy(path + dlen + slash, name, nlen + 1);
+    return path;
+}
+
+static int cmp_entry(const void *v1, const void *v2)
+{
+    const DirEntry *e1 = v1;
+    const DirEntry *e2 = v2;
+    return strcmp(e1->name, e2->name);
+}
+
+/* Add the files in the directory open on dfd (named path) to in_files; closes dfd */
+static void walk_tree(int dfd, const char *path)
+{
+    DIR *dp = fdopendir(dfd);
+    if (dp == 0)
+    {
+        err_sysrem("failed to read directory %s\n", path);
+        close(dfd);
+        return;
+    }
+
+    DirEntry *entries = 0;
+    size_t num_entries = 0;
+    size_t max_entries = 0;
+    struct dirent *de;
+    while ((de = readdir(dp)) != 0)
+    {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        bool is_dir;
+#ifdef _DIRENT_HAVE_D_TYPE
+        if (de->d_type == DT_DIR || de->d_type == DT_REG)
+            is_dir = (de->d_type == DT_DIR);
+        else if (de->d_type != DT_UNKNOWN)
+            continue;
+        else
+#endif /* _DIRENT_HAVE_D_TYPE */
         {
-            status = CComment;
-            c = getch(fp);
-            c_putch('/');
-            write_bsnl(bsnl, c_putch);
-            c_putch('*');
-            if (eflag)
-            {
-                s_putch('/');
-                s_putch('*');
-            }
+            struct stat sb;
+            if (fstatat(dirfd(dp), de->d_name, &sb, AT_SYMLINK_NOFOLLOW) != 0 ||
+                !(S_ISDIR(sb.st_mode) || S_ISREG(sb.st_mode)))
+                continue;
+            is_dir = S_ISDIR(sb.st_mode);
         }
-        else if (!f_DoubleSlash && pc == '/')
+        if (!is_dir && ext_std_code(de->d_name) < 0)
+            continue;
+        if (num_entries >= max_entries)
         {
-            warn_feature(F_DOUBLESLASH, fn);
-            c = getch(fp);
-            s_putch(c);
-            write_bsnl(bsnl, s_putch);
-            s_putch(c);
+            size_t new_max = max_entries * 2 + 16;
+            void *new_entries = realloc(entries, new_max * sizeof(*entries));
+            if (new_entries == 0)
+                err_syserr("failed to allocate %zu bytes of memory: ", new_max * sizeof(*entries));
+            entries = new_entries;
+            max_entries = new_max;
         }
-        else if (f_DoubleSlash && pc == '/')
+        if ((entries[num_entries].name = strdup(de->d_name)) == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", strlen(de->d_name) + 1);
+        entries[num_entries++].is_dir = is_dir;
+    }
+    qsort(entries, num_entries, sizeof(*entries), cmp_entry);
+
+    for (size_t i = 0; i < num_entries; i++)
+    {
+        char *name = path_join(path, entries[i].name);
+        if (!entries[i].is_dir)
         {
-            status = CppComment;
-            c = getch(fp);
-            c_putch(c);
-            write_bsnl(bsnl, c_putch);
-            c_putch(c);
-            if (eflag)
-                s_putstr("//");
+            int std_code = (std_override >= 0) ? std_override : ext_std_code(entries[i].name);
+            in_file_add(name, std_code, true);
         }
         else
         {
-            s_putch(c);
-            write_bsnl(bsnl, s_putch);
+            int fd = openat(dirfd(dp), entries[i].name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (fd < 0)
+                err_sysrem("failed to open directory %s\n", name);
+            else
+                walk_tree(fd, name);
+            free(name);
         }
+        free(entries[i].name);
     }
-    else if (isdigit(c) || (c == '.' && isdigit(peek(fp))))
-        parse_number(c, fp, fn);
-    else if (isalnum(c) || c == '_')
-        parse_identifier(c, fp, fn);
-    else if (c == '\\' && ((pc = peek(fp)) == 'u' || pc == 'U'))
-        scan_ucn(pc, (pc == 'u' ? 4 : 8), fp, fn);
+    free(entries);
+    closedir(dp);
+}
+
+static void walk_root(const char *dir)
+{
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        err_sysrem("failed to open directory %s\n", dir);
     else
+        walk_tree(fd, dir);
+}
+
+/*
+** Read the names of the files to strip from a list (--files-from), or
+** from standard input for "-".  The names are separated by NUL bytes
+** if there are any, as from find -print0, and otherwise by newlines;
+** empty names are ignored.  The names are left in the list, and are
+** stripped through in_files like the files in trees, so that the list
+** is not limited by ARG_MAX.
+*/
+static void read_file_list(const char *list, int std_code)
+{
+    bool is_stdin = (strcmp(list, "-") == 0);
+    int fd = is_stdin ? STDIN_FILENO : open(list, O_RDONLY | O_CLOEXEC);
+    size_t len = 0;
+    size_t size = 0;
+
+    if (fd < 0)
+        err_syserr("failed to open file list %s: ", list);
+    for (;;)
+    {
+        if (size - len < RD_BLOCKSIZE)
+        {
+            size_t new_size = size * 2 + RD_BLOCKSIZE;
+            char *new_list = realloc(file_list, new_size);
+            if (new_list == 0)
+                err_syserr("failed to allocate %zu bytes of memory: ", new_size);
+            file_list = new_list;
+            size = new_size;
+        }
+        /* Leave room for a final separator */
+        ssize_t nbytes = read(fd, file_list + len, size - len - 1);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+            err_syserr("read error on file list %s: ", list);
+        if (nbytes == 0)
+            break;
+        len += (size_t)nbytes;
+    }
+    if (!is_stdin)
+        close(fd);
+
+    char sep = (memchr(file_list, '\0', len) != 0) ? '\0' : '\n';
+    file_list[len] = sep;
+    for (char *name = file_list; name < file_list + len; )
     {
-        /* space, punctuation, ... */
-        s_putch(c);
+        char *end = memchr(name, sep, (size_t)(file_list + len + 1 - name));
+        *end = '\0';
+        if (end > name)
+        {
+            if (in_place != 0 && strcmp(name, "-") == 0)
+                err_error("cannot strip standard input in place\n");
+            in_file_add(name, std_code, false);
+        }
+        name = end + 1;
     }
-    return status;
 }
 
-static void scc(FILE *fp, char *fn)
+/*
+** Parallel processing (-j n).  Worker threads claim the files in
+** command line order and strip each one into its Job: the output, and
+** the warnings, each noted with the amount of output that preceded it.
+** The main thread writes the jobs in command line order, interleaving
+** the warnings, so the results are exactly those of a serial run.  A
+** worker does not start a file more than the window size ahead of the
+** file being written, nor one that would take the size of the files
+** started but not written past the window size in bytes, which bounds
+** the memory used.  Standard input, pipes and other files that are not
+** regular files, and files larger than the window, are not given to
+** the workers: the main thread strips them as serial mode does, writing
+** the output as it goes, when their turn comes.  Only the main thread
+** uses the err_*() functions: a worker that runs out of memory notes the
+** size it failed to allocate in the Job (or its DiagSet or LineMap) and
+** stops, and the main thread reports it when the job's turn comes.
+*/
+static int job_append(Job *job, char **out, size_t *out_len, size_t *out_size,
+                      const char *buffer, size_t len)
+{
+    if (job->nomem != 0)
+        return -1;
+    if (len > *out_size - *out_len)
+    {
+        size_t new_size = *out_size * 2 + len;
+        void *new_out = realloc(*out, new_size);
+        if (new_out == 0)
+        {
+            job->nomem = new_size;
+            return -1;
+        }
+        *out = new_out;
+        *out_size = new_size;
+    }
+    memcpy(*out + *out_len, buffer, len);
+    *out_len += len;
+    return 0;
+}
+
+static int job_write(void *data, const char *buffer, size_t len)
+{
+    Job *job = data;
+    return job_append(job, &job->out, &job->out_len, &job->out_size, buffer, len);
+}
+
+static int job_write_comments(void *data, const char *buffer, size_t len)
 {
-    int oc;
-    int c;
-    Comment status = NonComment;
+    Job *job = data;
+    return job_append(job, &job->cmt, &job->cmt_len, &job->cmt_size, buffer, len);
+}
 
-    l_nest = 0; /* Last line with a nested comment warning */
-    l_cend = 0; /* Last line with a comment end warning */
-    nline = 1;
+static void job_diag(void *data, const char *name, int line, const char *msg)
+{
+    Job *job = data;
+    diag_add(&job->diags, name, line, msg);
+}
+
+static void job_run(Job *job, SCC_Scanner *sc, Source *src)
+{
+    SCC_Sink sink = { .write = job_write, .diag = job_diag, .data = job, .flags = SCC_SINK_UNORDERED };
+    FILE *fp;
 
-    for (oc = '\0'; (c = getch(fp)) != EOF; oc = c)
+    if (strcmp(job->name, "-") == 0)
+    {
+        job->name = "(standard input)";
+        fp = stdin;
+    }
+    else if ((fp = fopen(job->name, "r")) == 0)
+    {
+        job->open_err = errno;
+        return;
+    }
+    job->read_err = src_open(src, fp);
+    if (job->text_only && is_binary(src))
+    {
+        job->binary = true;
+        src_close(src);
+        fclose(fp);
+        return;
+    }
+    scc_set_std(sc, job->std_code);
+    if (in_place != 0 && job->read_err == 0)
+    {
+        InPlace ip;
+        job->seconds = ip_strip(&ip, sc, fileno(fp), job->name, src, &sink, &job->stats);
+        job->ip_err = ip.error;
+        job->ip_failed = ip.failed;
+    }
+    else if (in_place == 0)
     {
-        switch (status)
+        if (map_file != 0 || line_directives)
+            sink = lm_sink(&job->lmap, job->name, job->first, &sink);
+        if (comments_fp != 0)
         {
-        case CComment:
-            status = c_comment(c, fp, fn);
-            break;
-        case CppComment:
-            status = cpp_comment(c, oc);
-            break;
-        case NonComment:
-            status = non_comment(c, fp, fn);
-            break;
+            SCC_Sink comment_sink = { .write = job_write_comments, .data = job };
+            scc_set_comment_sink(sc, &comment_sink);
         }
+        double start = now_seconds();
+        strip_cached(sc, job->name, src, &sink, 1, 0, &job->stats);
+        job->seconds = now_seconds() - start;
+        lm_flush(&job->lmap);
     }
-    if (status != NonComment)
-        warning("unterminated C-style comment", fn, nline);
+    src_close(src);
+    if (fp != stdin)
+        fclose(fp);
 }
 
-static int parse_std_arg(const char *std)
+/* Write the results of a job, and release them */
+static void job_output(Job *job)
 {
-    size_t len = strlen(std);
-    char name[len + 1];
-    for (size_t i = 0; i < len; i++)
-        name[i] = toupper((unsigned char)std[i]);
-    name[len] = '\0';
-    for (size_t i = 0; i < NUM_STDNAMES; i++)
+    if (job->open_err != 0)
+    {
+        errno = job->open_err;
+        err_sysrem("failed to open file %s\n", job->name);
+        return;
+    }
+    if (job->binary)
+        return;
+    if (job->read_err != 0)
     {
-        if (strcmp(name, std_name[i]) == 0)
-            return i;
+        errno = job->read_err;
+        err_sysrem("read error on file %s\n", job->name);
     }
-    err_error("Unrecognized standard name %s\n", std);
-    /*NOTREACHED*/
-    return -1;
+    nomem_check(job->nomem);
+    nomem_check(job->diags.nomem);
+    nomem_check(job->lmap.nomem);
+    if (job->out_len > 0)
+        fwrite(job->out, sizeof(char), job->out_len, stdout);
+    diag_flush(&job->diags);
+    if (comments_fp != 0 && job->cmt_len > 0)
+        fwrite(job->cmt, sizeof(char), job->cmt_len, comments_fp);
+    if (map_file != 0)
+        map_add(&job->lmap);
+    lm_free(&job->lmap);
+    if (job->ip_err != 0)
+    {
+        errno = job->ip_err;
+        err_sysrem("%s %s\n", job->ip_failed, job->name);
+    }
+    if (stats_format != ST_NONE)
+        stats_add_file(job->name, &job->stats, job->seconds);
+    free(job->out);
+    free(job->cmt);
+    diag_free(&job->diags);
+    job->out = 0;
+    job->cmt = 0;
 }
 
-static void set_features(int code)
+static void *pool_worker(void *arg)
 {
-    switch (code)
+    Worker *wp = arg;
+    Pool *pool = wp->pool;
+
+    for (;;)
     {
-    case C89:
-    case C90:
-    case C94:
-        break;
-    case C:                     /* Current C standard is C18 */
-    case C11:
-    case C18:
-        f_Unicode = true;
-        /*FALLTHROUGH*/
-    case C99:
-        f_HexFloat = true;
-        f_Universal = true;
-        f_DoubleSlash = true;
-        break;
-    case CXX:                   /* Current C++ standard is C++17 */
-    case CXX17:
-        f_HexFloat = true;
-        /*FALLTHROUGH*/
-    case CXX14:
-        f_Binary = true;
-        f_NumPunct = true;
-        /*FALLTHROUGH*/
-    case CXX11:
-        f_RawString = true;
-        f_Unicode = true;
-        /*FALLTHROUGH*/
-    case CXX98:
-    case CXX03:
-        f_Universal = true;
-        f_DoubleSlash = true;
-        break;
-    default:
-        err_internal(__func__, "Invalid standard code %d\n", code);
-        break;
+        pthread_mutex_lock(&pool->lock);
+        while (pool->next_job < pool->num_jobs &&
+               (pool->next_job >= pool->next_out + pool->window ||
+                pool->held + pool->jobs[pool->next_job].size > pool->window_bytes))
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        if (pool->next_job >= pool->num_jobs)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        Job *job = &pool->jobs[pool->next_job++];
+        pool->held += job->size;
+        pthread_mutex_unlock(&pool->lock);
+        if (job->serial)
+            continue;
+
+        job_run(job, wp->scanner, &wp->source);
+
+        pthread_mutex_lock(&pool->lock);
+        job->done = true;
+        pthread_cond_broadcast(&pool->cond);
+        pthread_mutex_unlock(&pool->lock);
     }
+    return 0;
+}
+
+static void scc_parallel(const SCC_Options *opts)
+{
+    Pool pool = { .num_jobs = num_in_files };
+    size_t nworkers = ((size_t)nthreads < pool.num_jobs) ? (size_t)nthreads : pool.num_jobs;
+
+    pool.window = JOB_WINDOW * nworkers;
+    pool.window_bytes = JOB_WINDOW_BYTES * nworkers;
+    pool.jobs = calloc(pool.num_jobs, sizeof(*pool.jobs));
+    Worker *workers = calloc(nworkers, sizeof(*workers));
+    if (pool.jobs == 0 || workers == 0)
+        err_syserr("failed to allocate memory for %zu files: ", pool.num_jobs);
+    for (size_t i = 0; i < pool.num_jobs; i++)
+    {
+        pool.jobs[i].name = in_files[i].name;
+        pool.jobs[i].std_code = in_files[i].std_code;
+        pool.jobs[i].text_only = in_files[i].text_only;
+        pool.jobs[i].first = (i == 0);
+        /* Files stripped in place add nothing to the output held */
+        struct stat sb;
+        if (strcmp(in_files[i].name, "-") == 0)
+            pool.jobs[i].serial = true;
+        else if (stat(in_files[i].name, &sb) != 0)
+            continue;
+        else if (!S_ISREG(sb.st_mode))
+            pool.jobs[i].serial = true;
+        else if (in_place == 0 && (uintmax_t)sb.st_size > pool.window_bytes)
+            pool.jobs[i].serial = true;
+        else if (in_place == 0)
+            pool.jobs[i].size = (size_t)sb.st_size;
+        pool.jobs[i].done = pool.jobs[i].serial;
+    }
+    pthread_mutex_init(&pool.lock, 0);
+    pthread_cond_init(&pool.cond, 0);
+
+    for (size_t i = 0; i < nworkers; i++)
+    {
+        workers[i].pool = &pool;
+        if ((workers[i].scanner = scc_create(opts)) == 0)
+            err_syserr("failed to create scanner: ");
+        int rc = pthread_create(&workers[i].thread, 0, pool_worker, &workers[i]);
+        if (rc != 0)
+        {
+            errno = rc;
+            err_syserr("failed to create thread: ");
+        }
+    }
+
+    for (size_t i = 0; i < pool.num_jobs; i++)
+    {
+        Job *job = &pool.jobs[i];
+        pthread_mutex_lock(&pool.lock);
+        while (!job->done)
+            pthread_cond_wait(&pool.cond, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+
+        if (!job->serial)
+            job_output(job);
+        else
+        {
+            lm_files = i;   /* The first file of the output is named (--line-directives) */
+            in_file_strip(job->name, job->std_code, job->text_only);
+        }
+        if (null_output)
+            null_record();
+
+        pthread_mutex_lock(&pool.lock);
+        pool.held -= job->size;
+        pool.next_out++;
+        pthread_cond_broadcast(&pool.cond);
+        pthread_mutex_unlock(&pool.lock);
+    }
+
+    for (size_t i = 0; i < nworkers; i++)
+    {
+        pthread_join(workers[i].thread, 0);
+        scc_destroy(workers[i].scanner);
+        free(workers[i].source.rd_buffer);
+    }
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&pool.lock);
+    free(workers);
+    free(pool.jobs);
+}
+
+/* Close the output of the comments (--comments-out), if any */
+static void comments_close(void)
+{
+    if (comments_fp != 0 && fclose(comments_fp) != 0)
+        err_syserr("failed to write %s: ", comments_out);
+    comments_fp = 0;
 }
 
-static void print_features(int code)
+static void print_features(int std_code)
 {
-    printf("Standard: %s\n", std_name[code]);
-    if (f_DoubleSlash)
+    unsigned features = scc_std_features(std_code);
+    printf("Standard: %s\n", scc_std_name(std_code));
+    if (features & SCC_F_DOUBLESLASH)
         printf("Feature:  Double slash comments // to EOL\n");
-    if (f_RawString)
+    if (features & SCC_F_RAWSTRING)
         printf("Feature:  Raw strings R\"ZZ(string)ZZ\"\n");
-    if (f_Unicode)
+    if (features & SCC_F_UNICODE)
         printf("Feature:  Unicode strings (u\"A\", U\"A\", u8\"A\")\n");
-    if (f_Binary)
+    if (features & SCC_F_BINARY)
         printf("Feature:  Binary constants 0b0101\n");
-    if (f_HexFloat)
+    if (features & SCC_F_HEXFLOAT)
         printf("Feature:  Hexadecimal floats 0x2.34P-12\n");
-    if (f_NumPunct)
+    if (features & SCC_F_NUMPUNCT)
         printf("Feature:  Numeric punctuation 0x1234'5678\n");
-    if (f_Universal)
+    if (features & SCC_F_UNIVERSAL)
         printf("Feature:  Universal character names \\uXXXX and \\Uxxxxxxxx\n");
 }
 
+static int parse_jobs_arg(const char *arg)
+{
+    char *end;
+    long num = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || num < 0 || num > 1024)
+        err_error("Invalid number of jobs %s (0..1024 allowed)\n", arg);
+    if (num == 0)
+    {
+        num = sysconf(_SC_NPROCESSORS_ONLN);
+        if (num < 1)
+            num = 1;
+    }
+    return (int)num;
+}
+
+static StatsFormat parse_stats_arg(const char *arg)
+{
+    if (arg == 0 || strcmp(arg, "text") == 0)
+        return ST_TEXT;
+    if (strcmp(arg, "json") == 0)
+        return ST_JSON;
+    err_error("Unrecognized statistics format %s (text or json allowed)\n", arg);
+    /*NOTREACHED*/
+}
+
+static size_t parse_slowest_arg(const char *arg)
+{
+    char *end;
+    long num = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || num < 0)
+        err_error("Invalid number of slowest files %s\n", arg);
+    return (size_t)num;
+}
+
+/* --max-warnings=n[,total] */
+static void parse_max_warnings_arg(const char *arg)
+{
+    char *end;
+    unsigned long long num = strtoull(arg, &end, 10);
+    unsigned long long total = SIZE_MAX;
+    if (end != arg && *end == ',' && end[1] != '-')
+    {
+        const char *str = end + 1;
+        total = strtoull(str, &end, 10);
+        if (end == str)
+            end = (char *)arg;
+    }
+    if (end == arg || *end != '\0' || arg[0] == '-' || num > SIZE_MAX || total > SIZE_MAX)
+        err_error("Invalid number of warnings %s\n", arg);
+    max_warnings = (size_t)num;
+    max_total_warnings = (size_t)total;
+}
+
+static size_t parse_size_arg(const char *arg)
+{
+    char *end;
+    unsigned long long num = strtoull(arg, &end, 10);
+    unsigned long long unit = 1;
+    if (*end == 'K' || *end == 'k')
+        unit = 1024;
+    else if (*end == 'M' || *end == 'm')
+        unit = 1024 * 1024;
+    else if (*end == 'G' || *end == 'g')
+        unit = 1024 * 1024 * 1024;
+    if (unit != 1)
+        end++;
+    if (end == arg || *end != '\0' || arg[0] == '-' || num == 0 || num > SIZE_MAX / unit)
+        err_error("Invalid cache size %s\n", arg);
+    return (size_t)(num * unit);
+}
+
+static MapFormat parse_map_format_arg(const char *arg)
+{
+    if (strcmp(arg, "binary") == 0)
+        return MF_BINARY;
+    if (strcmp(arg, "json") == 0)
+        return MF_JSON;
+    err_error("Unrecognized map format %s (binary or json allowed)\n", arg);
+    /*NOTREACHED*/
+}
+
+static int parse_std_arg(const char *std)
+{
+    int code = scc_std_code(std);
+    if (code < 0)
+        err_error("Unrecognized standard name %s\n", std);
+    return code;
+}
+
+/* Default extensions (-r): C sources and headers, C++ sources and headers */
+static void ext_std_init(void)
+{
+    static const char *const c_ext[] = { ".c", ".h" };
+    static const char *const cpp_ext[] = { ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx" };
+    for (size_t i = 0; i < sizeof(c_ext) / sizeof(c_ext[0]); i++)
+        ext_std_add(c_ext[i], scc_std_code("C18"));
+    for (size_t i = 0; i < sizeof(cpp_ext) / sizeof(cpp_ext[0]); i++)
+        ext_std_add(cpp_ext[i], scc_std_code("C++17"));
+}
+
+/* List of .ext=std, separated by commas; the argument is modified */
+static void parse_ext_arg(char *arg)
+{
+    char *item = arg;
+    while (item != 0)
+    {
+        char *next = strchr(item, ',');
+        if (next != 0)
+            *next++ = '\0';
+        char *eq = strchr(item, '=');
+        if (item[0] != '.' || eq == 0 || eq == item + 1)
+            err_error("Invalid extension %s (.ext=std expected)\n", item);
+        *eq = '\0';
+        ext_std_add(item, parse_std_arg(eq + 1));
+        item = next;
+    }
+}
+
+static void add_tree(const char ***trees, size_t *num_trees, const char *dir)
+{
+    void *new_trees = realloc(*trees, (*num_trees + 1) * sizeof(**trees));
+    if (new_trees == 0)
+        err_syserr("failed to allocate memory for %zu trees: ", *num_trees + 1);
+    *trees = new_trees;
+    (*trees)[(*num_trees)++] = dir;
+}
+
 int main(int argc, char **argv)
 {
     int opt;
     bool fflag = false;
+    SCC_Options opts;
+    const char **trees = 0;     /* -r */
+    size_t num_trees = 0;
 
     err_setarg0(argv[0]);
+    scc_options_init(&opts);
+    ext_std_init();
 
-    while ((opt = getopt(argc, argv, optstr)) != EOF)
+    while ((opt = getopt_long(argc, argv, optstr, longopts, 0)) != EOF)
     {
         switch (opt)
         {
+        case OPT_STATS:
+            stats_format = parse_stats_arg(optarg);
+            break;
+        case OPT_SLOWEST:
+            stats_slowest = parse_slowest_arg(optarg);
+            break;
+        case OPT_EXT:
+            parse_ext_arg(optarg);
+            break;
+        case OPT_FSYNC:
+            fsync_flag = true;
+            break;
+        case OPT_ZERO_COPY:
+            zero_copy = true;
+            break;
+        case OPT_CACHE:
+            cache_dir = optarg;
+            break;
+        case OPT_CACHE_SIZE:
+            cache_limit = parse_size_arg(optarg);
+            break;
+        case OPT_MAP:
+            map_file = optarg;
+            break;
+        case OPT_MAP_FORMAT:
+            map_format = parse_map_format_arg(optarg);
+            break;
+        case OPT_LINE_DIRECTIVES:
+            line_directives = true;
+            break;
+        case OPT_CODE_OUT:
+            code_out = optarg;
+            break;
+        case OPT_COMMENTS_OUT:
+            comments_out = optarg;
+            break;
+        case OPT_SERVER:
+            server = (optarg == 0) ? "" : optarg;
+            break;
+        case OPT_FILES_FROM:
+            files_from = optarg;
+            break;
+        case OPT_NULL_OUTPUT:
+            null_output = true;
+            break;
+        case OPT_MAX_WARNINGS:
+            parse_max_warnings_arg(optarg);
+            break;
         case 'c':
-            cflag = true;
+            opts.cflag = true;
             break;
         case 'e':
-            eflag = true;
+            opts.eflag = true;
             break;
         case 'f':
             fflag = true;
@@ -1288,23 +2634,32 @@ int main(int argc, char **argv)
         case 'h':
             err_help(usestr, hlpstr);
             break;
+        case 'i':
+            in_place = (optarg == 0) ? "" : optarg;
+            break;
+        case 'j':
+            nthreads = parse_jobs_arg(optarg);
+            break;
         case 'n':
-            nflag = true;
+            opts.nflag = true;
             break;
         case 'q':
-            qchar = *optarg;
+            opts.qchar = *optarg;
+            break;
+        case 'r':
+            add_tree(&trees, &num_trees, optarg);
             break;
         case 's':
-            schar = *optarg;
+            opts.schar = *optarg;
             break;
         case 't':
-            tflag = true;
+            opts.tflag = true;
             break;
         case 'w':
-            wflag = true;
+            opts.wflag = true;
             break;
         case 'S':
-            std_code = parse_std_arg(optarg);
+            opts.std_code = std_override = parse_std_arg(optarg);
             break;
         case 'V':
             err_version(cmdname_info, version_info);
@@ -1315,13 +2670,114 @@ int main(int argc, char **argv)
         }
     }
 
-    set_features(std_code);
     if (fflag)
     {
-        print_features(std_code);
+        print_features(opts.std_code);
         return 0;
     }
 
-    filter(argc, argv, optind, scc);
+    if (server != 0)
+    {
+        if (optind < argc || num_trees > 0 || in_place != 0 || map_file != 0 || line_directives ||
+            code_out != 0 || comments_out != 0 || cache_dir != 0 || stats_format != ST_NONE ||
+            files_from != 0 || null_output || max_warnings != SIZE_MAX ||
+            max_total_warnings != SIZE_MAX)
+            err_error("--server cannot be used with files or output options\n");
+        /* A client that goes away only ends its connection */
+        signal(SIGPIPE, SIG_IGN);
+        if (server[0] == '\0')
+        {
+            if (serve_stream(STDIN_FILENO, STDOUT_FILENO, &opts) != 0)
+                err_syserr("failed to serve requests on standard input: ");
+        }
+        else if (serve_socket(server, &opts) != 0)
+            err_syserr("failed to serve requests on socket %s: ", server);
+        free(trees);
+        return 0;
+    }
+
+    if (in_place != 0)
+    {
+        if (num_trees == 0 && files_from == 0 && optind >= argc)
+            err_error("no files to strip in place\n");
+        for (int i = optind; i < argc; i++)
+        {
+            if (strcmp(argv[i], "-") == 0)
+                err_error("cannot strip standard input in place\n");
+        }
+    }
+
+    if (map_file != 0 && in_place != 0)
+        err_error("cannot write a map of files stripped in place\n");
+    if (map_file != 0 && line_directives)
+        err_error("--map and --line-directives cannot be used together\n");
+    if ((code_out != 0 || comments_out != 0) && (opts.cflag || in_place != 0))
+        err_error("--code-out and --comments-out cannot be used with -c or -i\n");
+    if (null_output && (in_place != 0 || map_file != 0))
+        err_error("--null-output cannot be used with -i or --map\n");
+
+    if (code_out != 0 && freopen(code_out, "w", stdout) == 0)
+        err_syserr("failed to open %s: ", code_out);
+    if (comments_out != 0 && (comments_fp = fopen(comments_out, "w")) == 0)
+        err_syserr("failed to open %s: ", comments_out);
+
+    if (cache_dir != 0 && (cache = cache_open(cache_dir, cache_limit, version_info)) == 0)
+        err_syserr("failed to open cache directory %s: ", cache_dir);
+
+    for (size_t i = 0; i < num_trees; i++)
+        walk_root(trees[i]);
+    free(trees);
+    if (files_from != 0)
+        read_file_list(files_from, opts.std_code);
+
+    if ((scanner = scc_create(&opts)) == 0)
+        err_syserr("failed to create scanner: ");
+    if (comments_fp != 0)
+    {
+        SCC_Sink comment_sink = { .write = out_write, .data = comments_fp };
+        if (scc_set_comment_sink(scanner, &comment_sink) != 0)
+            err_syserr("failed to create scanner: ");
+    }
+    struct stat sb;
+    if (fstat(output.fd, &sb) == 0)
+    {
+        /* Pages passed by reference only if asked for (--zero-copy) */
+        if (S_ISREG(sb.st_mode))
+            output.kcopy = KC_COPY_RANGE;
+        else if (S_ISFIFO(sb.st_mode) && zero_copy)
+            output.kcopy = KC_VMSPLICE;
+        else if (S_ISSOCK(sb.st_mode) && zero_copy)
+            output.kcopy = KC_SENDFILE;
+    }
+    if (nthreads > 1 && num_in_files + (size_t)(argc - optind) > 1)
+    {
+        for (int i = optind; i < argc; i++)
+            in_file_add(argv[i], opts.std_code, false);
+        scc_parallel(&opts);
+    }
+    else if (num_trees == 0 && files_from == 0 && !null_output)
+        filter(argc, argv, optind, scc);
+    else
+    {
+        /* Named files follow the others; each gets its NUL byte, opened or not */
+        char dash[] = "-";
+        for (int i = optind; i < argc; i++)
+            in_file_add(argv[i], opts.std_code, false);
+        if (num_trees == 0 && files_from == 0 && optind >= argc)
+            in_file_add(dash, opts.std_code, false);
+        scc_in_files();
+    }
+    comments_close();
+    if (map_file != 0)
+        map_write();
+    if (cache != 0)
+        cache_close(cache, &cache_stats);
+    diag_summary();
+    if (stats_format != ST_NONE)
+        stats_report();
+    in_files_free();
+    diag_free(&file_diags);
+    scc_destroy(scanner);
+    free(source.rd_buffer);
     return(0);
 }
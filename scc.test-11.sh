@@ -0,0 +1,166 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-11.sh,v 1.1 2026/10/16 23:20:00 jleffler Exp $
+#
+# Test driver for SCC: parallel processing (-j) matches serial processing
+# - both for several files and for a single large file (in chunks) - and
+# does not hold more than a window of the output in memory
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+# Large enough to be divided into several chunks
+i=0
+while [ $i -lt 40 ]
+do
+    cat scc-bogus.*.c* scc-test.*.c*
+    : $((i++))
+done > $tmp.L
+
+# A missing file checks that open errors are reported in sequence too
+SOURCES="scc-bogus.*.c* scc-test.*.c* $tmp.missing scc-bogus.ucns.c"
+
+{
+fail=0
+pass=0
+# Don't quote options - spaces need trimming
+for options in "-w" "-c" "-n" "-e -S C++11" "-t -S C89" "-s S -q Q -S C++17"
+do
+    for jobs in 2 3 16
+    do
+        test=0
+        "$T_SCC" $options $SOURCES > "$tmp.1" 2> "$tmp.2"
+        "$T_SCC" -j $jobs $options $SOURCES > "$tmp.3" 2> "$tmp.4"
+        if cmp -s "$tmp.1" "$tmp.3"
+        then : OK
+        else
+            echo "Differences: -j $jobs $options - standard output (serial vs parallel)"
+            diff "$tmp.1" "$tmp.3"
+            test=1
+        fi
+        if cmp -s "$tmp.2" "$tmp.4"
+        then : OK
+        else
+            echo "Differences: -j $jobs $options - standard error (serial vs parallel)"
+            diff "$tmp.2" "$tmp.4"
+            test=1
+        fi
+        if [ $test = 0 ]
+        then
+            [ "$qflag" = yes ] || echo "== PASS == (-j $jobs $options)"
+            : $((pass++))
+        else
+            echo "!! FAIL !! (-j $jobs $options)"
+            : $((fail++))
+        fi
+        rm -f "$tmp".[1-4]
+    done
+    test=0
+    "$T_SCC" $options $tmp.L > "$tmp.1" 2> "$tmp.2"
+    "$T_SCC" -j 4 $options $tmp.L > "$tmp.3" 2> "$tmp.4"
+    if cmp -s "$tmp.1" "$tmp.3" && cmp -s "$tmp.2" "$tmp.4"
+    then
+        [ "$qflag" = yes ] || echo "== PASS == (-j 4 $options large file)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! (-j 4 $options large file)"
+        diff "$tmp.1" "$tmp.3" | sed 10q
+        diff "$tmp.2" "$tmp.4" | sed 10q
+        : $((fail++))
+    fi
+    rm -f "$tmp".[1-4]
+done
+
+# Standard input and a pipe are stripped in sequence with the other files
+mkfifo $tmp.F
+for options in "-w" "--line-directives"
+do
+    "$T_SCC" $options scc-test.example2.c - scc-test.ucns.c $tmp.L < scc-test.example1.c > "$tmp.1" 2> "$tmp.2"
+    cat scc-test.example1.c > $tmp.F &
+    "$T_SCC" -j 2 $options scc-test.example2.c $tmp.F scc-test.ucns.c $tmp.L > "$tmp.3" 2> "$tmp.4"
+    wait
+    sed "s%$tmp.F%(standard input)%" "$tmp.3" > "$tmp.5"
+    sed "s%$tmp.F%(standard input)%" "$tmp.4" > "$tmp.6"
+    if cmp -s "$tmp.1" "$tmp.5" && cmp -s "$tmp.2" "$tmp.6"
+    then
+        [ "$qflag" = yes ] || echo "== PASS == (-j 2 $options pipe)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! (-j 2 $options pipe)"
+        : $((fail++))
+    fi
+    rm -f "$tmp".[1-6]
+done
+
+# Input far larger than the memory available - from a pipe, in a file, or
+# in files stripped ahead while a pipe is read - is not all held at once
+# (with the warnings about the files held limited, in the last case)
+i=0
+while [ $i -lt 12 ]
+do
+    cat $tmp.L
+    : $((i++))
+done > $tmp.B
+cat $tmp.B $tmp.B $tmp.B > $tmp.C
+"$T_SCC" scc-test.example1.c $tmp.C scc-test.example2.c > "$tmp.1" 2> /dev/null
+(ulimit -v 48000; cat $tmp.C | "$T_SCC" -j 2 scc-test.example1.c - scc-test.example2.c > "$tmp.3" 2> /dev/null)
+piped=$?
+(ulimit -v 48000; "$T_SCC" -j 2 scc-test.example1.c $tmp.C scc-test.example2.c > "$tmp.4" 2> /dev/null)
+named=$?
+if [ $piped = 0 ] && [ $named = 0 ] && cmp -s "$tmp.1" "$tmp.3" && cmp -s "$tmp.1" "$tmp.4"
+then
+    [ "$qflag" = yes ] || echo "== PASS == (-j 2 large pipe and file in bounded memory)"
+    : $((pass++))
+else
+    echo "!! FAIL !! (-j 2 large pipe and file in bounded memory)"
+    : $((fail++))
+fi
+rm -f "$tmp".[1-4] $tmp.C
+"$T_SCC" --max-warnings=1 $tmp.F $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B > "$tmp.1" 2> /dev/null &
+(sleep 1; echo 'int x;') > $tmp.F
+wait
+(sleep 1; echo 'int x;') > $tmp.F &
+(ulimit -v 48000; "$T_SCC" -j 2 --max-warnings=1 $tmp.F $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B $tmp.B > "$tmp.3" 2> /dev/null)
+if [ $? = 0 ] && wait && cmp -s "$tmp.1" "$tmp.3"
+then
+    [ "$qflag" = yes ] || echo "== PASS == (-j 2 files held while a pipe is read in bounded memory)"
+    : $((pass++))
+else
+    echo "!! FAIL !! (-j 2 files held while a pipe is read in bounded memory)"
+    : $((fail++))
+fi
+rm -f "$tmp".[13BFL]
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
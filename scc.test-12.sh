@@ -0,0 +1,122 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-12.sh,v 1.1 2026/10/16 23:20:00 jleffler Exp $
+#
+# Test driver for SCC: input read from a pipe (streamed in blocks)
+# matches the same input read from a file - including lines and runs of
+# white space far longer than the stream buffer
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+# Ordinary source, and the same source as a single line of about 1 MB
+cat scc-bogus.*.c* scc-test.*.c* > $tmp.A
+i=0
+while [ $i -lt 40 ]
+do
+    tr '\n' ' ' < $tmp.A
+    : $((i++))
+done > $tmp.B
+echo >> $tmp.B
+
+# Runs of white space in code and in comments, at the end of lines and not
+awk 'BEGIN {
+    for (n = 0; n < 3; n++)
+    {
+        printf("int x%d = %d;", n, n);
+        for (i = 0; i < 200000; i++)
+            printf("%s", (i % 7 == n) ? "\t" : " ");
+        printf(n == 1 ? "\n/* comment" : "/* comment */ y");
+        for (i = 0; i < 100000; i++)
+            printf("%s", (i % 5 == n) ? "\t" : " ");
+        printf(n == 1 ? "*/\n" : "\n");
+    }
+}' > $tmp.C
+
+{
+fail=0
+pass=0
+# Don't quote options - spaces need trimming
+for options in "" "-c" "-n" "-t" "-ct -S C++17" "-e -w -S C++11" "-s S -q Q -S C++17"
+do
+    for file in $tmp.A $tmp.B $tmp.C
+    do
+        test=0
+        "$T_SCC" $options $file > "$tmp.1" 2> "$tmp.2"
+        cat $file | "$T_SCC" $options > "$tmp.3" 2> "$tmp.4"
+        sed "s%(standard input)%$file%" "$tmp.4" > "$tmp.5"
+        if cmp -s "$tmp.1" "$tmp.3" && cmp -s "$tmp.2" "$tmp.5"
+        then
+            [ "$qflag" = yes ] || echo "== PASS == ($options $(basename $file))"
+            : $((pass++))
+        else
+            echo "!! FAIL !! ($options $(basename $file))"
+            diff "$tmp.1" "$tmp.3" | sed 10q
+            diff "$tmp.2" "$tmp.5" | sed 10q
+            : $((fail++))
+        fi
+        rm -f "$tmp".[1-5]
+    done
+done
+
+# Tokens far longer than the memory available - a number, a slash or a
+# star before a chain of backslash-newlines, a run of backslashes in a
+# string - are carried over from one block to the next, not buffered
+for token in number slash star backslash
+do
+    awk -v token=$token 'BEGIN {
+        head["number"] = "int x = 1"; body["number"] = "0000000000"; tail["number"] = ";"
+        head["slash"] = "a /"; body["slash"] = "\\\n\\\n\\\n\\\n\\\n"; tail["slash"] = "* c */ b"
+        head["star"] = "/* *"; body["star"] = "\\\n\\\n\\\n\\\n\\\n"; tail["star"] = "/ y"
+        head["backslash"] = "s = \""; body["backslash"] = "\\\\\\\\\\\\\\\\\\\\"; tail["backslash"] = "\";"
+        printf("%s", head[token]);
+        for (i = 0; i < 2400000; i++)
+            printf("%s", body[token]);
+        printf("%s\nint z;\n", tail[token]);
+    }' > $tmp.D
+    "$T_SCC" $tmp.D > $tmp.1 2> /dev/null
+    (ulimit -v 16000; cat $tmp.D | "$T_SCC" > $tmp.3 2> /dev/null)
+    if [ $? = 0 ] && cmp -s $tmp.1 $tmp.3
+    then
+        [ "$qflag" = yes ] || echo "== PASS == (oversized $token in bounded memory)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! (oversized $token in bounded memory)"
+        : $((fail++))
+    fi
+    rm -f $tmp.[13D]
+done
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
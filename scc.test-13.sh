@@ -0,0 +1,98 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-13.sh,v 1.1 2026/10/16 23:20:00 jleffler Exp $
+#
+# Test driver for SCC: output written to a pipe (where long unchanged
+# stretches of a mapped file are spliced) matches output written to a
+# file, including when mapped files and standard input are mixed
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+# Long stretches without comments, separated by the odd comment
+awk 'BEGIN {
+    for (i = 0; i < 30000; i++)
+    {
+        printf("static const int value%d = %d;\n", i, i);
+        if (i % 10000 == 9999)
+            printf("/* Block %d */ int block%d;   \n", i, i);
+    }
+}' > $tmp.A
+cat scc-bogus.*.c* scc-test.*.c* > $tmp.B
+
+{
+fail=0
+pass=0
+# Don't quote options - spaces need trimming
+for options in "" "-c" "-t" "-s S -q Q -S C++17" "-j 3" "--zero-copy"
+do
+    for files in "$tmp.A" "$tmp.B" "$tmp.A - $tmp.B $tmp.A"
+    do
+        test=0
+        "$T_SCC" $options $files < $tmp.B > "$tmp.1" 2> "$tmp.2"
+        "$T_SCC" $options $files < $tmp.B 2> "$tmp.4" | cat > "$tmp.3"
+        if cmp -s "$tmp.1" "$tmp.3" && cmp -s "$tmp.2" "$tmp.4"
+        then
+            [ "$qflag" = yes ] || echo "== PASS == ($options $(echo $files | sed "s%$tmp%T%g"))"
+            : $((pass++))
+        else
+            echo "!! FAIL !! ($options $(echo $files | sed "s%$tmp%T%g"))"
+            diff "$tmp.1" "$tmp.3" | sed 10q
+            diff "$tmp.2" "$tmp.4" | sed 10q
+            : $((fail++))
+        fi
+        rm -f "$tmp".[1-4]
+    done
+done
+
+# Output waiting in a pipe after scc has exited does not change when the
+# input does, unless --zero-copy was given
+awk 'BEGIN { for (i = 0; i < 1000; i++) printf("static const int value%d = %d;\n", i, i) }' > $tmp.C
+"$T_SCC" $tmp.C > "$tmp.1"
+"$T_SCC" $tmp.C | { sleep 2; cat > "$tmp.3"; } &
+sleep 1
+printf 'XXXXXXXX' | dd of=$tmp.C conv=notrunc 2> /dev/null
+wait
+if cmp -s "$tmp.1" "$tmp.3"
+then
+    [ "$qflag" = yes ] || echo "== PASS == (output in a pipe independent of later input)"
+    : $((pass++))
+else
+    echo "!! FAIL !! (output in a pipe independent of later input)"
+    : $((fail++))
+fi
+rm -f "$tmp".[13C]
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
@@ -0,0 +1,95 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-14.sh,v 1.1 2026/10/17 10:30:00 jleffler Exp $
+#
+# Test driver for SCC: files that need no change (which are copied
+# without being scanned) and files that only just fail to qualify give
+# the same output and warnings as when they are piped to SCC and
+# scanned, and the files that need no change are copied exactly
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+# A generated table with no comments, quotes or trailing blanks
+awk 'BEGIN {
+    printf("#include <stddef.h>\nconst double table[] =\n{\n");
+    for (i = 0; i < 5000; i++)
+        printf("    %d, 0x%X, 0%o, %d.%de+%d, .%d, 0e0, %du, %dUL, 08, x%d/y, *p,\n",
+               i, i, i, i, i % 7, i % 30, i, i, i, i);
+    printf("};\n");
+}' > $tmp.A
+
+{
+fail=0
+pass=0
+# Each variant of the table is followed by whether it needs no change
+for variant in plain blank noeol comment slashes hexfloat binary octal exponent string
+do
+    case "$variant" in
+    (plain)    cat $tmp.A;;
+    (blank)    cat $tmp.A; echo "int x; ";;
+    (noeol)    cat $tmp.A; printf "int x;";;
+    (comment)  cat $tmp.A; echo "int x; /* comment */";;
+    (slashes)  cat $tmp.A; echo "int x; //";;
+    (hexfloat) cat $tmp.A; echo "double d = 0x1.8p3;";;
+    (binary)   cat $tmp.A; echo "int b = 0b101;";;
+    (octal)    cat $tmp.A; echo "int o = 0179;";;
+    (exponent) cat $tmp.A; echo "double e = 12e;";;
+    (string)   cat $tmp.A; echo 'char s[] = "s";';;
+    esac > $tmp.B
+    # Don't quote options - spaces need trimming
+    for options in "" "-t" "-S C89" "-S C++17" "-s S" "-c" "-j 3"
+    do
+        "$T_SCC" $options $tmp.B > "$tmp.1" 2> "$tmp.2"
+        cat $tmp.B | "$T_SCC" $options > "$tmp.3" 2> "$tmp.4"
+        sed "s%$tmp.B%(standard input)%" "$tmp.2" > "$tmp.5"
+        if [ "$variant" = plain ] && [ "$options" != "-c" ] && ! cmp -s "$tmp.1" "$tmp.B"
+        then
+            echo "!! FAIL !! ($variant $options) - not copied exactly"
+            : $((fail++))
+        elif cmp -s "$tmp.1" "$tmp.3" && cmp -s "$tmp.5" "$tmp.4"
+        then
+            [ "$qflag" = yes ] || echo "== PASS == ($variant $options)"
+            : $((pass++))
+        else
+            echo "!! FAIL !! ($variant $options)"
+            diff "$tmp.1" "$tmp.3" | sed 10q
+            diff "$tmp.5" "$tmp.4" | sed 10q
+            : $((fail++))
+        fi
+        rm -f "$tmp".[1-5]
+    done
+done
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
@@ -0,0 +1,148 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-15.sh,v 1.1 2026/10/17 14:00:00 jleffler Exp $
+#
+# Test driver for SCC: the statistics (--stats) count what is in the
+# input, agree with wc, and are the same whether the file is mapped,
+# piped, stripped by a worker thread (-j) or in parallel chunks
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+# Remove the times, which vary, and the file names, which are compared separately
+normalize()
+{
+    sed -e 's/"lexer_seconds": [0-9.]*/"lexer_seconds": T/g' \
+        -e 's/"mb_per_sec": [0-9.]*/"mb_per_sec": R/g' \
+        -e 's/"name": "[^"]*"/"name": N/g' "$@"
+}
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+# Known counts: the fraction of 1.5e3 is part of the number, and
+# the comment markers in the raw string are not comments
+cat > $tmp.A <<'EOF'
+/* one */ int a = 10;   // two
+char c = 'x'; const char *s = "str";
+auto r = R"x(raw /* not */ )x";
+int h = 0x1F, o = 017, b = 0b11, z = 0, n = 0'1;
+double d = 1.5e3 + .5;
+EOF
+printf 'int tail = 1;' >> $tmp.A
+
+cat > $tmp.B <<'EOF'
+Comments:  C 1 (9 bytes), C++ 1 (6 bytes)
+Literals:  strings 1, characters 1, raw strings 1
+Numbers:   decimal 5, octal 2, hex 1, binary 1
+Warnings:  feature 0, comment 0, literal 0, rawmark 0, number 0, ucn 0
+Unchanged: 0 of 1 files copied without scanning
+EOF
+"$T_SCC" -S C++17 --stats $tmp.A 2>&1 >/dev/null | sed -n '/^Comments:/,/^Unchanged:/p' > $tmp.1
+cmp -s $tmp.1 $tmp.B
+check $? "counts of comments, literals and numbers"
+
+# Warnings by type, in C89
+"$T_SCC" -S C89 --stats $tmp.A 2>&1 >/dev/null | grep '^Warnings:' > $tmp.1
+echo "Warnings:  feature 3, comment 0, literal 0, rawmark 0, number 0, ucn 0" > $tmp.2
+cmp -s $tmp.1 $tmp.2
+check $? "counts of warnings by type"
+
+# Bytes and lines agree with wc, for a file with and without a final newline
+for file in $tmp.A scc-test.example1.c
+do
+    "$T_SCC" --stats=json $file 2>&1 > $tmp.1 |
+    sed -n '/"total"/,/}/s/.*"bytes_in": \([0-9]*\), "bytes_out": \([0-9]*\), "lines": \([0-9]*\).*/\1 \2 \3/p' > $tmp.2
+    lines=$(wc -l < $file)
+    [ -z "$(tail -c 1 $file | tr -d '\n')" ] || lines=$((lines + 1))
+    echo $(wc -c < $file) $(wc -c < $tmp.1) $lines > $tmp.3
+    cmp -s $tmp.2 $tmp.3
+    check $? "bytes and lines of $(basename $file)"
+done
+
+# Each file says whether it is unchanged; the total counts them instead
+"$T_SCC" --stats=json scc-test.example1.c $tmp.A 2>&1 >/dev/null | grep -v '^scc: ' > $tmp.1
+[ $(grep -c '"unchanged":' $tmp.1) = 2 ] &&
+[ -z "$(sed -n '/"total"/,/}/{/"unchanged":/p;}' $tmp.1)" ] &&
+grep -q '"unchanged_files": ' $tmp.1
+check $? "unchanged files and their total"
+
+# The same counts however the files are read and stripped
+cat scc-test.*.c* scc-bogus.* > $tmp.C
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16
+do cat $tmp.C
+done > $tmp.D
+for file in scc-test.example2.c scc-test.rawstring.cpp $tmp.D
+do
+    "$T_SCC" -S C++17 --stats=json $file 2>&1 >/dev/null | grep -v '^scc: ' | normalize > $tmp.1
+    cat $file | "$T_SCC" -S C++17 --stats=json 2>&1 >/dev/null | grep -v '^scc: ' | normalize > $tmp.2
+    "$T_SCC" -S C++17 -j 2 --stats=json $file $file 2>&1 >/dev/null | grep -v '^scc: ' |
+    normalize > $tmp.3
+    "$T_SCC" -S C++17 -j 3 --stats=json $file 2>&1 >/dev/null | grep -v '^scc: ' | normalize > $tmp.4
+    cmp -s $tmp.1 $tmp.2
+    check $? "mapped and piped $(basename $file)"
+    cmp -s $tmp.1 $tmp.4
+    check $? "serial and chunked $(basename $file)"
+    # Two copies: twice the total of one
+    n1=$(sed -n '/"total"/,/}/s/.*"bytes_in": \([0-9]*\).*/\1/p' $tmp.1)
+    n3=$(sed -n '/"total"/,/}/s/.*"bytes_in": \([0-9]*\).*/\1/p' $tmp.3)
+    [ "$n3" = $((2 * n1)) ] && [ $(grep -c '"bytes_in"' $tmp.3) = 3 ]
+    check $? "two files with -j 2 of $(basename $file)"
+done
+
+# The slowest files are listed, up to the number requested
+"$T_SCC" --stats --slowest=2 scc-test.example1.c scc-test.example2.c scc-test.example3.c \
+    2>&1 >/dev/null | sed -n '/^Slowest files:/,$p' > $tmp.1
+[ $(wc -l < $tmp.1) = 3 ]
+check $? "slowest files"
+
+"$T_SCC" --stats=xml $tmp.A > /dev/null 2>&1
+[ $? != 0 ]
+check $? "invalid statistics format"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
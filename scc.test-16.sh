@@ -0,0 +1,120 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-16.sh,v 1.1 2026/10/17 16:00:00 jleffler Exp $
+#
+# Test driver for SCC: recursive directory mode (-r) strips the C and
+# C++ files in a tree, in name order, with the standard chosen by the
+# extension, and skips binary files, symbolic links and other files
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -fr $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+# The raw string is only recognized as such in C++
+t=$tmp.T
+mkdir -p $t/sub/deep $t/misc
+cp scc-test.example1.c $t/a.c
+cp scc-test.rawstring.cpp $t/sub/r.cpp
+cp scc-test.rawstring.cpp $t/sub/deep/r.h
+cp scc-test.example2.c $t/sub/deep/x.hpp
+echo 'int notes; // text' > $t/misc/notes.txt
+printf 'int\0binary; // comment\n' > $t/misc/bin.c
+ln -s ../a.c $t/misc/link.c
+
+# Expected: the files in name order, each with its standard
+{
+"$T_SCC" $t/a.c
+"$T_SCC" -S C18 $t/sub/deep/r.h
+"$T_SCC" -S C++17 $t/sub/deep/x.hpp $t/sub/r.cpp
+} > $tmp.1 2>&1
+
+"$T_SCC" -r $t > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "tree in name order, by extension"
+
+"$T_SCC" -j 3 -r $t > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "tree with -j 3"
+
+# Files named as well as trees follow them
+{ cat $tmp.1; "$T_SCC" scc-test.example3.c; } > $tmp.3 2>&1
+"$T_SCC" -r $t scc-test.example3.c > $tmp.2 2>&1
+cmp -s $tmp.3 $tmp.2
+check $? "tree and file"
+
+"$T_SCC" -j 2 -r $t scc-test.example3.c > $tmp.2 2>&1
+cmp -s $tmp.3 $tmp.2
+check $? "tree and file with -j 2"
+
+# -S sets the standard of every file; --ext adds to (or overrides) the extensions
+"$T_SCC" -S C89 $t/a.c $t/misc/notes.txt $t/sub/deep/r.h $t/sub/deep/x.hpp $t/sub/r.cpp > $tmp.1 2>&1
+"$T_SCC" -S C89 --ext=.txt=C++17 -r $t > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "standard (-S) and extension (--ext) overrides"
+
+{
+"$T_SCC" $t/a.c
+"$T_SCC" -S C++17 $t/sub/deep/r.h
+"$T_SCC" -S C++17 $t/sub/deep/x.hpp $t/sub/r.cpp
+} > $tmp.1 2>&1
+"$T_SCC" --ext=.h=C++17 -r $t > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "extension override of default"
+
+# Only the text files selected are counted
+"$T_SCC" --stats -r $t 2>&1 >/dev/null | grep '^Total' > $tmp.1
+grep -q '(4 files)' $tmp.1
+check $? "binary files, links and other files skipped"
+
+"$T_SCC" --ext=txt=C -r $t > /dev/null 2>&1
+[ $? != 0 ]
+check $? "invalid extension"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -fr $tmp.?
+trap 0
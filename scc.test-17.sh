@@ -0,0 +1,152 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-17.sh,v 1.1 2026/10/17 18:00:00 jleffler Exp $
+#
+# Test driver for SCC: in-place mode (-i) replaces each file with its
+# stripped version, keeping the original with a suffix if asked, and
+# leaves files that would not change untouched
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -fr $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+# Input and expected output of each file, and warnings, as without -i
+setup()
+{
+    rm -fr $tmp.D $tmp.E
+    mkdir $tmp.D $tmp.E
+    for file in scc-test.example1.c scc-test.example2.c scc-test.rawstring.cpp
+    do
+        cp $file $tmp.D
+        "$T_SCC" -S C++17 $file > $tmp.E/$file 2>> $tmp.E/warnings
+    done
+    # Unchanged: a file that needs no change, and one whose output is the same
+    printf 'int x;\nint y;\n' > $tmp.D/plain.c
+    printf 'int z = "/* not a comment */";\n' > $tmp.D/same.c
+    # Output shorter than the input, and a prefix of it
+    printf 'int t;   ' > $tmp.D/trail.c
+    cp $tmp.D/plain.c $tmp.D/same.c $tmp.E
+    printf 'int t;' > $tmp.E/trail.c
+    chmod 640 $tmp.D/scc-test.example1.c
+    touch -t 202001010000 $tmp.D/*
+    touch -t 202101010000 $tmp.R
+    sed "s%^scc: %scc: $tmp.D/%" $tmp.E/warnings > $tmp.E/messages
+}
+
+same_files()
+{
+    for file in scc-test.example1.c scc-test.example2.c scc-test.rawstring.cpp plain.c same.c trail.c
+    do cmp -s $tmp.D/$file $tmp.E/$file || return 1
+    done
+    return 0
+}
+
+for jobs in 1 3
+do
+    setup
+    "$T_SCC" -j $jobs -S C++17 -i $tmp.D/scc-test.* $tmp.D/plain.c $tmp.D/same.c $tmp.D/trail.c > $tmp.1 2> $tmp.2
+    same_files
+    check $? "files stripped in place (-j $jobs)"
+    [ ! -s $tmp.1 ] && cmp -s $tmp.2 $tmp.E/messages
+    check $? "no output and the same warnings (-j $jobs)"
+    [ -z "$(find $tmp.D/plain.c $tmp.D/same.c -newer $tmp.R)" ] &&
+    [ -n "$(find $tmp.D/trail.c -newer $tmp.R)" ]
+    check $? "unchanged files not rewritten (-j $jobs)"
+    [ $(ls -a $tmp.D | wc -l) = 8 ]
+    check $? "no temporary files or backups left (-j $jobs)"
+done
+
+# The mode is kept; the original is kept with the suffix
+setup
+"$T_SCC" -S C++17 -i.orig --fsync $tmp.D/scc-test.example1.c $tmp.D/plain.c 2> /dev/null
+cmp -s $tmp.D/scc-test.example1.c $tmp.E/scc-test.example1.c &&
+cmp -s $tmp.D/scc-test.example1.c.orig scc-test.example1.c &&
+[ ! -f $tmp.D/plain.c.orig ]
+check $? "backup with suffix"
+[ "$(ls -l $tmp.D/scc-test.example1.c | cut -c1-10)" = "-rw-r-----" ]
+check $? "mode kept"
+
+# Files in a tree
+setup
+"$T_SCC" -i -r $tmp.D 2> /dev/null
+cmp -s $tmp.D/scc-test.example2.c $tmp.E/scc-test.example2.c
+check $? "files in a tree"
+
+# A symbolic link is kept, and the file it refers to is stripped (and
+# backed up) in its own directory
+setup
+mkdir $tmp.D/sub
+mv $tmp.D/scc-test.example1.c $tmp.D/sub
+ln -s sub/scc-test.example1.c $tmp.D/link.c
+ln -s ../link.c $tmp.D/sub/chain.c
+"$T_SCC" -S C++17 -i.orig $tmp.D/sub/chain.c 2> /dev/null
+[ -L $tmp.D/link.c ] && [ -L $tmp.D/sub/chain.c ] &&
+cmp -s $tmp.D/sub/scc-test.example1.c $tmp.E/scc-test.example1.c &&
+cmp -s $tmp.D/sub/scc-test.example1.c.orig scc-test.example1.c &&
+[ $(ls -a $tmp.D/sub | wc -l) = 5 ]
+check $? "symbolic link followed"
+
+# A file that cannot be stripped (memory runs out holding a long run of
+# blanks) is left as it was, and no temporary file is left behind
+rm -fr $tmp.D
+mkdir $tmp.D
+awk 'BEGIN { printf "int a;"; for (i = 0; i < 32768; i++) printf "%1024s", ""; print "/* c */" }' > $tmp.D/blanks.c
+cp $tmp.D/blanks.c $tmp.1
+(ulimit -v 64000; "$T_SCC" -i $tmp.D/blanks.c) 2> $tmp.2
+cmp -s $tmp.D/blanks.c $tmp.1 &&
+grep -q "failed to strip $tmp.D/blanks.c" $tmp.2 &&
+[ $(ls -a $tmp.D | wc -l) = 3 ]
+check $? "file left alone when stripping fails"
+
+"$T_SCC" -i - < /dev/null > /dev/null 2>&1
+[ $? != 0 ]
+check $? "standard input rejected"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -fr $tmp.?
+trap 0
@@ -0,0 +1,153 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-18.sh,v 1.1 2026/10/17 20:00:00 jleffler Exp $
+#
+# Test driver for SCC: the cache (--cache) gives the same output and
+# warnings as stripping, is shared by files with the same contents,
+# depends on the options, and is kept within its size limit
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -fr $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+# Remove the times, which vary, and what follows the totals
+normalize()
+{
+    sed -e 's/"lexer_seconds": [0-9.]*/"lexer_seconds": T/g' \
+        -e 's/"mb_per_sec": [0-9.]*/"mb_per_sec": R/g' \
+        -e '/"cache":/,$d' -e '/"slowest":/,$d' "$@"
+}
+
+cache_line()
+{
+    "$T_SCC" --cache $tmp.C --stats "$@" 2>&1 >/dev/null | grep '^Cache:'
+}
+
+# Files with warnings, and a copy of one of them
+files="scc-test.example1.c scc-test.example2.c scc-test.rawstring.cpp scc-bogus.endcomment.c"
+cp scc-test.example1.c $tmp.A
+"$T_SCC" $files $tmp.A > $tmp.1 2>&1
+
+"$T_SCC" --cache $tmp.C $files $tmp.A > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "output and warnings on misses"
+
+"$T_SCC" --cache $tmp.C $files $tmp.A > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "output and warnings on hits"
+
+"$T_SCC" --cache $tmp.C $files $tmp.A 2>&1 | cat > $tmp.2
+cmp -s $tmp.1 $tmp.2
+check $? "output and warnings on hits to a pipe"
+
+"$T_SCC" -j 3 --cache $tmp.C $files $tmp.A > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "output and warnings on hits with -j 3"
+
+[ "$(cache_line $files $tmp.A)" = "Cache:     hits 5, misses 0, stored 0, evicted 0" ]
+check $? "all hits"
+
+rm -fr $tmp.C
+[ "$(cache_line $files $tmp.A)" = "Cache:     hits 1, misses 4, stored 4, evicted 0" ]
+check $? "same contents within a run"
+
+# Other options and standards have their own entries
+"$T_SCC" -c -S C89 $files > $tmp.1 2>&1
+"$T_SCC" -c -S C89 --cache $tmp.C $files > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "options are part of the key"
+
+# The statistics of a hit are those of the file
+"$T_SCC" --stats=json $files 2>&1 >/dev/null | normalize > $tmp.1
+"$T_SCC" --cache $tmp.C --stats=json $files 2>&1 >/dev/null | normalize > $tmp.2
+cmp -s $tmp.1 $tmp.2
+check $? "counts from the cache"
+
+# The least recently used entries go when the cache is over its limit
+rm -fr $tmp.C $tmp.D
+mkdir $tmp.D
+i=0
+while [ $i -lt 40 ]
+do
+    echo "/* $i */ int v$i;" > $tmp.D/f$i.c
+    : $((i++))
+done
+"$T_SCC" --cache $tmp.C --cache-size=2K $tmp.D/*.c > /dev/null
+[ $(find $tmp.C -type f -exec cat {} + | wc -c) -le 2048 ] && [ $(find $tmp.C -type f | wc -l) -gt 0 ]
+check $? "cache within its size limit"
+
+# A damaged entry is a miss, and is replaced
+corrupt()
+{
+    printf '\377\377\377\177' | dd of="$1" bs=1 seek="$2" conv=notrunc 2> /dev/null
+}
+bogus=scc-bogus.endcomment.c
+"$T_SCC" $bogus > $tmp.1 2>&1
+rm -fr $tmp.C
+"$T_SCC" --cache $tmp.C $bogus > /dev/null 2>&1
+entry=$(find $tmp.C -type f)
+offset=$(grep -obUa "C-style comment end" $entry | sed -n '1s/:.*//p')
+corrupt $entry $((offset - 4))
+[ "$(cache_line $bogus)" = "Cache:     hits 0, misses 1, stored 1, evicted 0" ] &&
+"$T_SCC" --cache $tmp.C $bogus > $tmp.2 2>&1 &&
+cmp -s $tmp.1 $tmp.2
+check $? "warning longer than its entry"
+
+corrupt $entry 44
+[ "$(cache_line $bogus)" = "Cache:     hits 0, misses 1, stored 1, evicted 0" ] &&
+"$T_SCC" --cache $tmp.C $bogus > $tmp.2 2>&1 &&
+cmp -s $tmp.1 $tmp.2
+check $? "more warnings than fit in the entry"
+
+"$T_SCC" --cache $tmp.C --cache-size=-1 $tmp.A > /dev/null 2>&1
+[ $? != 0 ]
+check $? "invalid cache size"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -fr $tmp.?
+trap 0
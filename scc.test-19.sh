@@ -0,0 +1,158 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-19.sh,v 1.1 2026/10/17 21:00:00 jleffler Exp $
+#
+# Test driver for SCC: the source maps (--map) and #line directives
+# (--line-directives) show where the stripped output came from, and
+# do not change the output
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+# Known points: after the comment that opens the file, after the comment
+# that shortened a line, and after the comment spanning lines
+cat > $tmp.A <<'EOF'
+/* header */
+int a;   /* one */ int b;
+int c = /* over
+two lines */ 3;
+EOF
+
+cat > $tmp.B <<'EOF'
+{
+  "version": 1,
+  "sources": [
+    "(standard input)"
+  ],
+  "points": [
+    [1, 0, 0, 1, 12],
+    [2, 10, 0, 2, 18],
+    [3, 10, 0, 4, 13]
+  ]
+}
+EOF
+"$T_SCC" --map $tmp.1 --map-format=json < $tmp.A > /dev/null
+cmp -s $tmp.1 $tmp.B
+check $? "points of a JSON map"
+
+# The same points in binary: deltas, as LEB128 numbers
+"$T_SCC" --map $tmp.1 < $tmp.A > /dev/null
+[ "$(echo $(od -An -tx1 $tmp.1))" = "53 43 43 4d 41 50 31 0a 01 10 28 73 74 61 6e 64 61 72 64 20 69 6e 70 75 74 29 03 00 00 00 00 18 01 0a 00 02 0c 01 0a 00 04 09" ]
+check $? "points of a binary map"
+
+# The map does not change the output, however the files are stripped
+files="scc-test.example1.c scc-test.example2.c scc-test.rawstring.cpp"
+"$T_SCC" -S C++17 $files > $tmp.1 2>&1
+"$T_SCC" -S C++17 --map $tmp.C $files > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2
+check $? "output unchanged by a map"
+
+"$T_SCC" -S C++17 -j 2 --map $tmp.D $files > $tmp.2 2>&1
+cmp -s $tmp.1 $tmp.2 && cmp -s $tmp.C $tmp.D
+check $? "same output and map with -j 2"
+
+"$T_SCC" -S C++17 --map $tmp.C --map-format=json scc-test.example2.c > /dev/null
+"$T_SCC" -S C++17 --map $tmp.D --map-format=json < scc-test.example2.c > /dev/null
+sed -e '/"sources"/,/\]/d' $tmp.C > $tmp.1
+sed -e '/"sources"/,/\]/d' $tmp.D > $tmp.2
+cmp -s $tmp.1 $tmp.2
+check $? "same points for a file and a pipe"
+
+# The #line directives keep the line numbers of the tokens
+cat > $tmp.A <<'EOF'
+/* A header
+** comment
+*/
+int a = __LINE__;
+int b = /* split
+over lines */ __LINE__;
+int c = 1 + \
+/* spliced
+*/ __LINE__;
+EOF
+
+cat > $tmp.B <<'EOF'
+
+#line 4 "(standard input)"
+int a = __LINE__;
+int b =
+#line 6 "(standard input)"
+   __LINE__;
+int c = 1 + \
+
+#line 9 "(standard input)"
+  __LINE__;
+EOF
+"$T_SCC" --line-directives < $tmp.A > $tmp.1
+cmp -s $tmp.1 $tmp.B
+check $? "#line directives"
+
+if command -v cpp > /dev/null 2>&1
+then
+    cpp -P $tmp.A | tr -s ' \n' '  ' > $tmp.1
+    cpp -P $tmp.B | tr -s ' \n' '  ' > $tmp.2
+    cmp -s $tmp.1 $tmp.2
+    check $? "#line directives to the preprocessor"
+fi
+
+"$T_SCC" -i --map $tmp.C $tmp.A > /dev/null 2>&1
+[ $? != 0 ]
+check $? "no map of files stripped in place"
+
+"$T_SCC" --map $tmp.C --line-directives $tmp.A > /dev/null 2>&1
+[ $? != 0 ]
+check $? "map and #line directives together"
+
+"$T_SCC" --map $tmp.C --map-format=xml $tmp.A > /dev/null 2>&1
+[ $? != 0 ]
+check $? "invalid map format"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
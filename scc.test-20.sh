@@ -0,0 +1,103 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-20.sh,v 1.1 2026/10/17 22:00:00 jleffler Exp $
+#
+# Test driver for SCC: one pass writes the code (--code-out) and the
+# comments (--comments-out) exactly as separate runs without and with
+# -c would, whatever other options are used and however the files are
+# read and stripped
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+files="scc-test.example1.c scc-test.example2.c scc-test.rawstring.cpp scc-bogus.endcomment.c"
+
+for flags in "" "-n" "-e" "-t" "-n -e -t" "-s X -q Y"
+do
+    "$T_SCC" -S C++17 $flags $files > $tmp.1 2> $tmp.2
+    "$T_SCC" -S C++17 -c $flags $files > $tmp.3 2> /dev/null
+
+    "$T_SCC" -S C++17 $flags --code-out $tmp.4 --comments-out $tmp.5 $files 2> $tmp.6
+    cmp -s $tmp.1 $tmp.4 && cmp -s $tmp.3 $tmp.5 && cmp -s $tmp.2 $tmp.6
+    check $? "code and comments of files, flags '$flags'"
+
+    cat $files | "$T_SCC" -S C++17 $flags --comments-out $tmp.5 > $tmp.4 2> /dev/null
+    cat $files | "$T_SCC" -S C++17 $flags > $tmp.1 2> /dev/null
+    cat $files | "$T_SCC" -S C++17 -c $flags > $tmp.3 2> /dev/null
+    cmp -s $tmp.1 $tmp.4 && cmp -s $tmp.3 $tmp.5
+    check $? "code and comments of a pipe, flags '$flags'"
+done
+
+# Files stripped by worker threads, and a large file in one piece
+"$T_SCC" -S C++17 $files > $tmp.1 2>&1
+"$T_SCC" -S C++17 -c $files > $tmp.3 2> /dev/null
+"$T_SCC" -S C++17 -j 3 --comments-out $tmp.5 $files > $tmp.4 2>&1
+cmp -s $tmp.1 $tmp.4 && cmp -s $tmp.3 $tmp.5
+check $? "code and comments with -j 3"
+
+for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16
+do cat $files $files $files $files
+done > $tmp.A
+"$T_SCC" -S C++17 $tmp.A > $tmp.1 2> /dev/null
+"$T_SCC" -S C++17 -c $tmp.A > $tmp.3 2> /dev/null
+"$T_SCC" -S C++17 -j 3 --comments-out $tmp.5 $tmp.A > $tmp.4 2> /dev/null
+cmp -s $tmp.1 $tmp.4 && cmp -s $tmp.3 $tmp.5
+check $? "code and comments of a large file with -j 3"
+
+"$T_SCC" -c --comments-out $tmp.5 $files > /dev/null 2>&1
+[ $? != 0 ]
+check $? "comments with -c"
+
+"$T_SCC" -i --code-out $tmp.4 $tmp.A > /dev/null 2>&1
+[ $? != 0 ]
+check $? "code of files stripped in place"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
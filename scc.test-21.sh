@@ -0,0 +1,133 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-21.sh,v 1.1 2026/10/17 23:00:00 jleffler Exp $
+#
+# Test driver for SCC: a server (--server) strips the files named or sent
+# in its requests as separate runs of SCC would, on standard input and
+# on a UNIX socket
+
+T_SCC=./scc             # Version of SCC under test
+T_CLIENT=./sccclient    # Client of the server
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+[ -x "$T_CLIENT" ] || ${MAKE:-make} "$T_CLIENT" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+files="scc-test.example1.c scc-test.example2.c scc-test.rawstring.cpp scc-bogus.endcomment.c"
+
+# Warnings are compared without the program name
+for flags in "" "-c" "-n -e -t" "-w -s X -q Y"
+do
+    "$T_SCC" -S C++17 $flags $files > $tmp.1 2> $tmp.2
+    "$T_CLIENT" -x "$T_SCC" -S C++17 $flags $files > $tmp.3 2> $tmp.4
+    cmp -s $tmp.1 $tmp.3 && [ "$(sed 's/^[^:]*: //' $tmp.2)" = "$(sed 's/^[^:]*: //' $tmp.4)" ]
+    check $? "files named in requests, flags '$flags'"
+
+    "$T_CLIENT" -x "$T_SCC" -C -S C++17 $flags $files > $tmp.3 2> $tmp.4
+    cmp -s $tmp.1 $tmp.3 && [ "$(sed 's/^[^:]*: //' $tmp.2)" = "$(sed 's/^[^:]*: //' $tmp.4)" ]
+    check $? "files sent in requests, flags '$flags'"
+done
+
+# Options given to the server apply unless a request gives its own
+"$T_SCC" -n -S C90 scc-test.example1.c > $tmp.1 2> /dev/null
+"$T_CLIENT" -x "$T_SCC" -S C90 -n < scc-test.example1.c > $tmp.3 2> /dev/null
+cmp -s $tmp.1 $tmp.3
+check $? "standard input sent in a request"
+
+# A hand-made request on standard input, and its response
+frame()
+{
+    printf '%d\n%s' ${#1} "$1"
+}
+request='name x.c
+
+int i; // c
+'
+frame "$request" | "$T_SCC" --server -S C90 > $tmp.3
+frame 'status ok
+output 12
+warnings 66
+
+int i; // c
+x.c:1: Double slash comment feature used but not supported in C90
+' > $tmp.1
+cmp -s $tmp.1 $tmp.3
+check $? "server options applied to a request"
+
+"$T_CLIENT" -x "$T_SCC" $tmp.X > $tmp.3 2> /dev/null
+[ $? != 0 ] && [ ! -s $tmp.3 ]
+check $? "error response for a missing file"
+
+printf 'x\n' | "$T_SCC" --server > /dev/null 2>&1
+[ $? != 0 ]
+check $? "malformed request"
+
+# A server on a socket, with two clients at once
+rm -f $tmp.S
+"$T_SCC" --server=$tmp.S 2> /dev/null &
+server=$!
+i=0
+while [ ! -S $tmp.S ] && [ $((i++)) -lt 50 ]
+do sleep 0.1
+done
+"$T_SCC" -S C++17 $files > $tmp.1 2> /dev/null
+"$T_CLIENT" -u $tmp.S -S C++17 $files > $tmp.3 2> /dev/null &
+"$T_CLIENT" -u $tmp.S -C -S C++17 $files > $tmp.4 2> /dev/null
+wait $!
+cmp -s $tmp.1 $tmp.3 && cmp -s $tmp.1 $tmp.4
+check $? "requests on a socket"
+kill $server
+wait $server 2> /dev/null
+rm -f $tmp.S
+
+"$T_SCC" --server scc-test.example1.c > /dev/null 2>&1
+[ $? != 0 ]
+check $? "server with files"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
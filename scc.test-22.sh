@@ -0,0 +1,110 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-22.sh,v 1.1 2026/10/17 23:30:00 jleffler Exp $
+#
+# Test driver for SCC: the files named in a list (--files-from) are
+# stripped as if named on the command line, and --null-output ends the
+# output for each file with a NUL byte
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+files="scc-test.example1.c scc-test.example2.c scc-test.rawstring.cpp scc-bogus.endcomment.c"
+
+"$T_SCC" -S C++17 -w $files > $tmp.1 2> $tmp.2
+for j in 1 3
+do
+    printf '%s\n' $files > $tmp.L
+    "$T_SCC" -S C++17 -w -j $j --files-from $tmp.L > $tmp.3 2> $tmp.4
+    cmp -s $tmp.1 $tmp.3 && cmp -s $tmp.2 $tmp.4
+    check $? "files in a list separated by newlines, -j $j"
+
+    printf '%s\0' $files | "$T_SCC" -S C++17 -w -j $j --files-from - > $tmp.3 2> $tmp.4
+    cmp -s $tmp.1 $tmp.3 && cmp -s $tmp.2 $tmp.4
+    check $? "files in a list separated by NUL bytes, -j $j"
+done
+
+# Files in the list come before those named
+set -- $files
+printf '%s\n\n%s\n' $1 $2 > $tmp.L
+"$T_SCC" -S C++17 -w --files-from $tmp.L $3 $4 > $tmp.3 2> $tmp.4
+cmp -s $tmp.1 $tmp.3 && cmp -s $tmp.2 $tmp.4
+check $? "files in a list and named"
+
+# A NUL byte ends each file, and a file that cannot be opened has an empty record
+for j in 1 3
+do
+    printf '%s\0%s\0%s\0' scc-test.example1.c $tmp.X scc-test.example2.c |
+    "$T_SCC" -j $j --null-output --files-from - > $tmp.3 2> $tmp.4
+    {
+        "$T_SCC" scc-test.example1.c 2> /dev/null
+        printf '\0\0'
+        "$T_SCC" scc-test.example2.c
+        printf '\0'
+    } > $tmp.1
+    cmp -s $tmp.1 $tmp.3 && grep -q "failed to open file $tmp.X" $tmp.4
+    check $? "NUL bytes after each file, -j $j"
+done
+
+"$T_SCC" --null-output < scc-test.example1.c > $tmp.3 2> /dev/null
+{ "$T_SCC" < scc-test.example1.c 2> /dev/null; printf '\0'; } > $tmp.1
+cmp -s $tmp.1 $tmp.3
+check $? "NUL byte after standard input"
+
+"$T_SCC" --null-output --map $tmp.M scc-test.example1.c > /dev/null 2>&1
+[ $? != 0 ]
+check $? "NUL bytes with a map"
+
+"$T_SCC" --files-from $tmp.X > /dev/null 2>&1
+[ $? != 0 ]
+check $? "missing list"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
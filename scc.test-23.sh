@@ -0,0 +1,93 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-23.sh,v 1.1 2026/10/17 23:30:00 jleffler Exp $
+#
+# Test driver for SCC: the time per byte does not grow with the input on
+# adversarial inputs, and scc_strip(), streaming and parallel stripping
+# agree on them and on the test files
+
+T_SCC=./scc             # Version of SCC under test
+T_BENCH=./sccbench      # Benchmark, with the adversarial inputs
+T_FUZZ=./sccfuzz-check  # Fuzz target checks, run on files
+
+for prog in "$T_SCC" "$T_BENCH" "$T_FUZZ"
+do [ -x "$prog" ] || ${MAKE:-make} "$prog" || exit 1
+done
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.*; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+kinds="rawmiss backslashes slashsplice starsplice blanks"
+
+# Eight times the input takes well under eight times as long per byte
+"$T_BENCH" -l -r 1 -x 4 -z 256K,2M -o '-,-c,-S C89' > $tmp.1 2>&1
+check $? "time per byte on adversarial inputs"
+
+for kind in $kinds
+do
+    "$T_BENCH" -g $kind -z 64K > $tmp.$kind
+    [ $(wc -c < $tmp.$kind) = 65536 ]
+    check $? "adversarial input $kind"
+done
+
+"$T_FUZZ" -s $(for kind in $kinds; do echo $tmp.$kind; done) > $tmp.1 2>&1
+check $? "stripping adversarial inputs three ways"
+
+"$T_FUZZ" -s scc-test.*.c* scc-bogus.* > $tmp.1 2>&1
+check $? "stripping test files three ways"
+
+# NUL bytes after a whole delimiter are not part of it
+{
+    printf 'R"abcdefghijklmnop(x)abcdefghijklmnop'
+    head -c 64 /dev/zero
+    printf '"\n'
+} > $tmp.2
+"$T_SCC" -S C++11 $tmp.2 > $tmp.3 2> $tmp.4
+cmp -s $tmp.2 $tmp.3 && grep -q "Unexpected EOF in raw string" $tmp.4
+check $? "NUL bytes after a raw string delimiter"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.*
+trap 0
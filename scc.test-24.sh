@@ -0,0 +1,114 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-24.sh,v 1.1 2026/10/17 23:30:00 jleffler Exp $
+#
+# Test driver for SCC: the warnings about each file are written after its
+# output, and --max-warnings limits them for each file and in all
+
+T_SCC=./scc             # Version of SCC under test
+
+[ -x "$T_SCC" ] || ${MAKE:-make} "$T_SCC" || exit 1
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+# Noisy files: two warnings on each line (numeric punctuation in C)
+awk 'BEGIN { for (i = 1; i <= 100; i++) printf "int x%d = 0x12%c34%c56;\n", i, 39, 39 }' > $tmp.A
+awk 'BEGIN { for (i = 1; i <= 50; i++) printf "int y%d = 0x12%c34;\n", i, 39 }' > $tmp.B
+cp $tmp.A $tmp.C
+
+"$T_SCC" -S C $tmp.A > $tmp.1 2> $tmp.2
+[ $(grep -c "^scc: $tmp.A:[0-9]*: Numeric punctuation" $tmp.2) = 200 ]
+check $? "every warning without --max-warnings"
+
+"$T_SCC" -S C $tmp.A > $tmp.3 2>&1
+cat $tmp.1 $tmp.2 | cmp -s - $tmp.3
+check $? "warnings after the output of the file"
+
+"$T_SCC" -S C --max-warnings=10 $tmp.A > $tmp.3 2> $tmp.4
+{
+    for i in 1 2 3 4 5 6 7 8 9 10
+    do echo "scc: $tmp.A:$i: Numeric punctuation feature used but not supported in C"
+    done
+    echo "scc: $tmp.A: 90 more warnings not shown"
+} > $tmp.5
+cmp -s $tmp.1 $tmp.3 && cmp -s $tmp.4 $tmp.5
+check $? "warnings for a file limited, repeats on a line once"
+
+"$T_SCC" -S C --max-warnings=0 $tmp.B 2>&1 > /dev/null | cmp -s - <(echo "scc: $tmp.B: 50 more warnings not shown")
+check $? "no warnings for a file"
+
+for j in 1 3
+do
+    "$T_SCC" -S C -j $j --max-warnings=40,100 $tmp.A $tmp.B $tmp.C > $tmp.3 2> $tmp.4
+    {
+        sed -n 1,40p $tmp.2 | awk 'NR % 2 == 1'
+        sed -n 41,80p $tmp.2 | awk 'NR % 2 == 1'
+        echo "scc: $tmp.A: 60 more warnings not shown"
+        "$T_SCC" -S C $tmp.B 2>&1 > /dev/null | sed -n 1,40p
+        echo "scc: $tmp.B: 10 more warnings not shown"
+        "$T_SCC" -S C $tmp.C 2>&1 > /dev/null | awk 'NR % 2 == 1' | sed -n 1,20p
+        echo "scc: 80 more warnings not shown (limit of 100 reached)"
+    } > $tmp.5
+    cmp -s $tmp.4 $tmp.5
+    check $? "warnings limited for each file and in all, -j $j"
+done
+
+"$T_SCC" -S C -j 3 $tmp.A $tmp.B $tmp.C > $tmp.3 2>&1
+for file in $tmp.A $tmp.B $tmp.C
+do "$T_SCC" -S C $file 2>&1
+done | cmp -s - $tmp.3
+check $? "output and warnings of each file in turn, -j 3"
+
+"$T_SCC" -S C --max-warnings=1 --stats $tmp.A 2>&1 > /dev/null | grep -q "^Warnings: *feature 200,"
+check $? "all warnings counted by --stats"
+
+"$T_SCC" -S C --max-warnings=x $tmp.A > /dev/null 2>&1
+[ $? != 0 ]
+check $? "invalid --max-warnings"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
@@ -0,0 +1,131 @@
+#!/bin/ksh
+#
+# @(#)$Id: scc.test-25.sh,v 1.1 2026/10/17 23:00:00 jleffler Exp $
+#
+# Test driver for SCC: messages reported by several threads at once are
+# written whole, to standard error or to a sink, with their time stamps
+
+T_SCC=./scc             # Version of SCC under test
+T_STDERR=./stderr-test  # Error reporting from several threads
+
+for prog in "$T_SCC" "$T_STDERR"
+do [ -x "$prog" ] || ${MAKE:-make} "$prog" || exit 1
+done
+
+arg0=$(basename "$0" .sh)
+
+usage()
+{
+    echo "Usage: $arg0 [-q]" >&2
+    exit 1
+}
+
+# -q  Quiet mode
+
+qflag=no
+while getopts q opt
+do
+    case "$opt" in
+    (q) qflag=yes;;
+    (*) usage;;
+    esac
+done
+shift $((OPTIND - 1))
+[ "$#" = 0 ] || usage
+
+tmp="${TMPDIR:-/tmp}/scc-test.$$"
+trap "rm -f $tmp.?; exit 1" 0 1 2 3 13 15
+
+{
+fail=0
+pass=0
+
+check()
+{
+    if [ "$1" = 0 ]
+    then
+        [ "$qflag" = yes ] || echo "== PASS == ($2)"
+        : $((pass++))
+    else
+        echo "!! FAIL !! ($2)"
+        : $((fail++))
+    fi
+}
+
+# Each line is a whole message, in order for its thread, padded as sent,
+# and its time stamp (if any) is no earlier than the one before
+messages()
+{
+    awk -v total="$2" -v head="$3" '
+    {
+        if ($0 !~ "^stderr-test: " head "thread [0-9]+ message [0-9]+ x* end$")
+        {
+            bad++
+            next
+        }
+        stamp = $0
+        sub(/ - .*/, "", stamp)
+        sub(/.*thread /, "")
+        split($0, f, " ")
+        t = f[1]
+        m = f[3]
+        pad = length($0) - length(t " message " m " ") - length(" end")
+        if (m != next_msg[t] + 0 || pad != (t * 101 + m * 37) % 2000)
+            bad++
+        if (head != "" && stamp < last_stamp[t])
+            bad++
+        next_msg[t] = m + 1
+        last_stamp[t] = stamp
+        n++
+    }
+    END { exit !(bad == 0 && n == total) }' "$1"
+}
+
+"$T_STDERR" -t 8 -n 1000 > $tmp.1 2> $tmp.2
+[ ! -s $tmp.1 ] && messages $tmp.2 8000 ""
+check $? "messages from 8 threads to a file"
+
+"$T_STDERR" -t 8 -n 1000 2>&1 | cat > $tmp.2
+messages $tmp.2 8000 ""
+check $? "messages from 8 threads to a pipe"
+
+"$T_STDERR" -l -t 4 -n 2000 > $tmp.1 2> $tmp.2
+stamp="[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9] [0-9][0-9]:[0-9][0-9]:[0-9][0-9][.][0-9][0-9][0-9] - pid=[0-9]+: "
+[ ! -s $tmp.1 ] && messages $tmp.2 8000 "$stamp"
+check $? "messages with time stamps from 4 threads"
+
+"$T_STDERR" -s -t 8 -n 1000 > $tmp.1 2> $tmp.2
+[ ! -s $tmp.2 ] && messages $tmp.1 8000 ""
+check $? "messages from 8 threads to a sink"
+
+# Messages reported in batches arrive whole, each line with its prefix
+"$T_STDERR" -b 16 -t 8 -n 1000 2>&1 | cat > $tmp.2
+messages $tmp.2 8000 ""
+check $? "batches of messages from 8 threads to a pipe"
+
+"$T_STDERR" -b 7 -l -t 4 -n 2000 > $tmp.1 2> $tmp.2
+[ ! -s $tmp.1 ] && messages $tmp.2 8000 "$stamp"
+check $? "batches of messages with time stamps from 4 threads"
+
+"$T_STDERR" -b 5 -s -t 8 -n 1000 > $tmp.1 2> $tmp.2
+[ ! -s $tmp.2 ] && messages $tmp.1 8000 ""
+check $? "batches of messages from 8 threads to a sink"
+
+# Errors from scc still follow the output written before them
+printf 'int x;\n' > $tmp.3
+"$T_SCC" $tmp.3 $tmp.4 $tmp.3 > $tmp.1 2>&1
+{
+    printf 'int x;\n'
+    echo "scc: failed to open file $tmp.4"
+    printf 'int x;\n'
+} | cmp -s - <(grep -v '^error (' $tmp.1)
+check $? "error after the output before it"
+
+if [ $fail = 0 ]
+then echo "== PASS == ($pass tests OK)"
+else echo "!! FAIL !! ($pass tests OK, $fail tests failed)"
+fi
+}
+
+rm -f $tmp.?
+trap 0
@@ -0,0 +1,820 @@
+/*
+@(#)File:           $RCSfile: sccbench.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 12:00:00 $
+@(#)Purpose:        Throughput benchmark for the SCC library
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+*/
+
+/*TABSTOP=4*/
+
+/*
+**  Generates reproducible synthetic corpora of several kinds and sizes
+**  in memory, strips each of them with several sets of options, and
+**  reports the throughput in MB/s and ns/byte.  The times can be
+**  recorded as a baseline (-w) and later runs compared with it (-b):
+**  a measurement more than the threshold (-t, percent) slower than the
+**  baseline counts as a regression and the exit status is 1.  An
+**  apparent regression is measured again before it is believed.
+**
+**  With -g kind, the corpus of that kind and size (-z) is written to
+**  standard output instead, so the same inputs can be used elsewhere.
+**
+**  With -l, the scanning time is checked for linearity instead: each
+**  corpus is stripped whole, streamed and stripped with a source map
+**  at each size, and the ns/byte at any size more than the factor (-x)
+**  times that at the first size is a failure.  By default, the kinds
+**  checked are the adversarial ones, single tokens as long as the
+**  corpus that would make a lexer which backtracks or rescans its input
+**  take quadratic time.  Streaming such a token costs up to about twice
+**  as much per byte as stripping it whole, since it is scanned again as
+**  the data grows, and the default factor allows for that.
+**
+**  Only the scanning is timed: the output is counted and discarded, as
+**  are the warnings.  Baselines are specific to the machine and the
+**  compiler options, and shared hosts vary a good deal from minute to
+**  minute, so the threshold is generous by default; use -t to tighten
+**  it on a quiet machine.
+*/
+
+#include "posixver.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "libscc.h"
+#include "stderr.h"
+
+typedef struct Buffer
+{
+    char   *data;
+    size_t  len;
+    size_t  size;
+} Buffer;
+
+typedef struct Corpus
+{
+    const char *name;
+    const char *desc;
+    void      (*line)(Buffer *bp);  /* Append one line (or a few) */
+    const char *head;               /* Written once before the lines, or null */
+} Corpus;
+
+typedef struct Baseline
+{
+    char   *key;                    /* "kind size options" */
+    double  ns_per_byte;
+} Baseline;
+
+static const char optstr[] = "b:g:hk:lo:r:s:t:wx:z:";
+static const char usestr[] =
+    "[-hw][-b baseline][-k kind,...][-o opts,...][-r reps][-s seed][-t pct][-z size,...]\n"
+    "       -l [-k kind,...][-o opts,...][-r reps][-s seed][-x factor][-z size,...]\n"
+    "       -g kind [-s seed][-z size]";
+static const char hlpstr[] =
+    "  -b file   Compare with (or with -w, write) the baseline in file\n"
+    "  -g kind   Write the corpus of the given kind to standard output\n"
+    "  -h        Print this help and exit\n"
+    "  -k kinds  Comma-separated corpus kinds (default all; with -l, the adversarial kinds)\n"
+    "  -l        Check that the time per byte does not grow with the size\n"
+    "  -o opts   Comma-separated option sets, such as '-,-c,-S C89' (default all)\n"
+    "  -r reps   Repetitions of each measurement; the best is used (default 5)\n"
+    "  -s seed   Seed for the corpus generator (default 1)\n"
+    "  -t pct    Slow-down relative to the baseline that fails (default 50)\n"
+    "  -w        Write a new baseline instead of comparing\n"
+    "  -x factor Growth in ns/byte from the first size that fails -l (default 3)\n"
+    "  -z sizes  Comma-separated corpus sizes, with K, M or G suffix (default 1K,1M,16M;\n"
+    "            with -l, 256K,1M,4M)\n"
+    ;
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_sccbench_c[];
+const char jlss_id_sccbench_c[] = "@(#)$Id: sccbench.c,v 1.1 2026/10/17 12:00:00 jleffler Exp $";
+#endif /* lint */
+
+enum { MIN_NSEC = 25 * 1000 * 1000 };   /* Shortest timed run of a measurement */
+enum { MAX_RETRIES = 2 };                /* Extra measurements of a regression */
+enum { STREAM_PIECE = 64 * 1024 };      /* Bytes per scc_stream_write() call */
+
+/* Ways of stripping a corpus measured by -l */
+enum { M_STRIP, M_STREAM, M_MAP, NUM_METHODS };
+static const char *const method_names[NUM_METHODS] = { "strip", "stream", "map" };
+
+static const char def_sizes[] = "1K,1M,16M";
+static const char def_lin_sizes[] = "256K,1M,4M";
+static const char def_opts[] = "-,-c,-n,-e,-t,-s,-S C89,-S C++17";
+
+static uint64_t seed = 1;
+
+/* Deterministic pseudo-random numbers (xorshift64*) */
+static unsigned rnd(unsigned n)
+{
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    return (unsigned)((seed * UINT64_C(2685821657736338717)) >> 33) % n;
+}
+
+static void buf_add(Buffer *bp, const char *str, size_t len)
+{
+    if (len > bp->size - bp->len)
+    {
+        size_t new_size = bp->size * 2 + len;
+        char *new_data = realloc(bp->data, new_size);
+        if (new_data == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", new_size);
+        bp->data = new_data;
+        bp->size = new_size;
+    }
+    memcpy(bp->data + bp->len, str, len);
+    bp->len += len;
+}
+
+static void buf_printf(Buffer *bp, const char *fmt, ...) PRINTFLIKE(2, 3);
+
+static void buf_printf(Buffer *bp, const char *fmt, ...)
+{
+    char line[1024];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    buf_add(bp, line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+}
+
+static const char *word(void)
+{
+    static const char *const words[] =
+    {
+        "buffer", "count", "index", "value", "result", "length", "offset",
+        "state", "token", "input", "output", "scanner", "comment", "line",
+        "the", "of", "and", "is", "a", "when", "returns", "null", "error",
+    };
+    return words[rnd(sizeof(words) / sizeof(words[0]))];
+}
+
+/* Comment-dense code: block, line and multi-line comments */
+static void gen_comments(Buffer *bp)
+{
+    switch (rnd(4))
+    {
+    case 0:
+        buf_printf(bp, "    int %s%u = %u; /* %s %s %s */\n", word(), rnd(1000), rnd(100000),
+                   word(), word(), word());
+        break;
+    case 1:
+        buf_printf(bp, "    // %s %s %s %s %s\n", word(), word(), word(), word(), word());
+        break;
+    case 2:
+        buf_printf(bp, "/*\n** %s %s %s %s\n** %s %s %s\n*/\n", word(), word(), word(),
+                   word(), word(), word(), word());
+        break;
+    default:
+        buf_printf(bp, "    %s = %s(%s); /* %s */ // %s\n", word(), word(), word(),
+                   word(), word());
+        break;
+    }
+}
+
+/* String-dense code: string literals and character constants */
+static void gen_strings(Buffer *bp)
+{
+    switch (rnd(3))
+    {
+    case 0:
+        buf_printf(bp, "    puts(\"%s %s /* not a comment */ %s\\n\");\n", word(), word(), word());
+        break;
+    case 1:
+        buf_printf(bp, "    static const char %s[] = \"%s \\\"%s\\\" // %s\";\n", word(),
+                   word(), word(), word());
+        break;
+    default:
+        buf_printf(bp, "    c = (c == '\\'') ? '\\\\' : (c == '%c') ? '\\n' : L'%c';\n",
+                   'a' + rnd(26), 'a' + rnd(26));
+        break;
+    }
+}
+
+/* Raw strings (C++11), single and multi-line, with prefixes */
+static void gen_rawstrings(Buffer *bp)
+{
+    static const char *const prefixes[] = { "R", "LR", "uR", "UR", "u8R" };
+    const char *pfx = prefixes[rnd(5)];
+    switch (rnd(3))
+    {
+    case 0:
+        buf_printf(bp, "    auto %s = %s\"(%s \"/* %s */\" %s)\";\n", word(), pfx, word(),
+                   word(), word());
+        break;
+    case 1:
+        buf_printf(bp, "    auto %s = %s\"xyz(%s )\" // %s\n%s\n)xyz\";\n", word(), pfx,
+                   word(), word(), word());
+        break;
+    default:
+        buf_printf(bp, "    f(%s); // %s\n", word(), word());
+        break;
+    }
+}
+
+/* Numbers: digit separators, hex floats, binary, octal and exponents */
+static void gen_numbers(Buffer *bp)
+{
+    buf_printf(bp, "    x%u = %u'%03u'%03u + 0x%X.%Xp%u + 0b1010'%u%u%u%u + 0%o + %u.%ue-%u + .%uf + 0x%X'%04Xu;\n",
+               rnd(1000), rnd(1000), rnd(1000), rnd(1000), rnd(65536), rnd(16), rnd(20),
+               rnd(2), rnd(2), rnd(2), rnd(2), rnd(4096), rnd(1000), rnd(1000), rnd(40),
+               rnd(1000), rnd(65536), rnd(65536));
+}
+
+/* Very long lines: about 1 MB of code and comments without a newline */
+static void gen_longlines(Buffer *bp)
+{
+    for (int i = 0; i < 32 * 1024; i++)
+        buf_printf(bp, "a%u = b + c; /* c */ ", rnd(100));
+    buf_add(bp, "\n", 1);
+}
+
+/* Backslash-newline splices in macros, comments and comment markers */
+static void gen_splices(Buffer *bp)
+{
+    switch (rnd(4))
+    {
+    case 0:
+        buf_printf(bp, "#define %s(x) \\\n    do { %s(x); \\\n    } while (0)\n", word(), word());
+        break;
+    case 1:
+        buf_printf(bp, "    // %s %s \\\n    %s %s\n", word(), word(), word(), word());
+        break;
+    case 2:
+        buf_printf(bp, "    %s = 1; /\\\n* %s *\\\n/\n", word(), word());
+        break;
+    default:
+        buf_printf(bp, "    s = \"%s \\\n%s\";\n", word(), word());
+        break;
+    }
+}
+
+/* Code that needs no change at all (a generated table) */
+static void gen_plain(Buffer *bp)
+{
+    buf_printf(bp, "    { %u, 0x%X, %u.%u, %s%u },\n", rnd(100000), rnd(65536), rnd(100),
+               rnd(100), word(), rnd(100));
+}
+
+/* A mixture of ordinary code */
+static void gen_mixed(Buffer *bp)
+{
+    switch (rnd(8))
+    {
+    case 0:
+    case 1:
+        gen_comments(bp);
+        break;
+    case 2:
+        gen_strings(bp);
+        break;
+    case 3:
+        buf_printf(bp, "    if (%s > %u)\n        return %s(%s, %s);\n", word(), rnd(100),
+                   word(), word(), word());
+        break;
+    case 4:
+        buf_printf(bp, "\n");
+        break;
+    default:
+        buf_printf(bp, "    %s = %s + %s * %u;\n", word(), word(), word(), rnd(100));
+        break;
+    }
+}
+
+/*
+** The adversarial kinds are single tokens as long as the corpus, built
+** to make a lexer that backtracks or rescans take more than linear
+** time; they are not part of the default set, but are used by -l.
+*/
+
+/* Near misses of the delimiter )abcdefghijklmnop" of an unclosed raw string */
+static void gen_rawmiss(Buffer *bp)
+{
+    static const char *const misses[] =
+    {
+        ")abcdefghijklmno)", ")abcdefghijklmnop)", ")))", ")abcdefghijklmnop ",
+        ")abc\"", ")abcdefghijklmnopq\"",
+    };
+    const char *miss = misses[rnd(sizeof(misses) / sizeof(misses[0]))];
+    buf_add(bp, miss, strlen(miss));
+}
+
+/* Backslashes in an unclosed string: one run as long as the corpus */
+static void gen_backslashes(Buffer *bp)
+{
+    buf_add(bp, "\\\\\\\\\\\\\\\\", 8);
+}
+
+/* Backslash-newline splices after a slash: one chain as long as the corpus */
+static void gen_slashsplice(Buffer *bp)
+{
+    buf_add(bp, "\\\n\\\n\\\n\\\n", 8);
+}
+
+/* Stars each followed by splices in an unclosed comment */
+static void gen_starsplice(Buffer *bp)
+{
+    buf_printf(bp, "*%.*s", 2 * (int)rnd(8), "\\\n\\\n\\\n\\\n\\\n\\\n\\\n\\\n");
+}
+
+/* Spaces and tabs: one run of white space as long as the corpus */
+static void gen_blanks(Buffer *bp)
+{
+    buf_printf(bp, "%*s", (int)rnd(64) + 1, "\t");
+}
+
+static const Corpus corpora[] =
+{
+    { "comments",   "comment-dense",            gen_comments,    0 },
+    { "strings",    "string-dense",             gen_strings,     0 },
+    { "rawstrings", "raw-string-heavy (C++11)", gen_rawstrings,  0 },
+    { "numbers",    "number-heavy",             gen_numbers,     0 },
+    { "longlines",  "lines of about 1 MB",      gen_longlines,   0 },
+    { "splices",    "backslash-newline-heavy",  gen_splices,     0 },
+    { "plain",      "needing no change",        gen_plain,       0 },
+    { "mixed",      "ordinary code",            gen_mixed,       0 },
+};
+enum { NUM_CORPORA = sizeof(corpora) / sizeof(corpora[0]) };
+
+static const Corpus adversaries[] =
+{
+    { "rawmiss",     "raw string delimiter near misses",  gen_rawmiss,     "R\"abcdefghijklmnop(" },
+    { "backslashes", "backslash run in a string",         gen_backslashes, "s = \"" },
+    { "slashsplice", "splice chain after a slash",        gen_slashsplice, "a = b /" },
+    { "starsplice",  "splice chains after stars",         gen_starsplice,  "/*" },
+    { "blanks",      "white space run",                   gen_blanks,      "x;" },
+};
+enum { NUM_ADVERSARIES = sizeof(adversaries) / sizeof(adversaries[0]) };
+
+static const Corpus *find_corpus(const char *name)
+{
+    for (int i = 0; i < NUM_CORPORA; i++)
+    {
+        if (strcmp(corpora[i].name, name) == 0)
+            return &corpora[i];
+    }
+    for (int i = 0; i < NUM_ADVERSARIES; i++)
+    {
+        if (strcmp(adversaries[i].name, name) == 0)
+            return &adversaries[i];
+    }
+    err_error("unknown corpus kind %s\n", name);
+    /*NOTREACHED*/
+}
+
+/*
+** Generate size bytes of the given kind: whole lines while they fit,
+** then the start of the next line, and a final newline.
+*/
+static void generate(const Corpus *cp, size_t size, Buffer *out)
+{
+    Buffer line = { 0, 0, 0 };
+    seed = (seed == 0) ? 1 : seed;
+    out->len = 0;
+    if (cp->head != 0)
+        buf_add(out, cp->head, strlen(cp->head) < size ? strlen(cp->head) : size - 1);
+    while (out->len + 1 < size)
+    {
+        line.len = 0;
+        cp->line(&line);
+        size_t room = size - 1 - out->len;
+        buf_add(out, line.data, (line.len < room) ? line.len : room);
+    }
+    if (size > 0)
+        buf_add(out, "\n", 1);
+    free(line.data);
+}
+
+static size_t parse_size(const char *str)
+{
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(str, &end, 10);
+    size_t scale = 1;
+    if (*end == 'K' || *end == 'k')
+        scale = 1024;
+    else if (*end == 'M' || *end == 'm')
+        scale = 1024 * 1024;
+    else if (*end == 'G' || *end == 'g')
+        scale = 1024 * 1024 * 1024;
+    if (scale != 1)
+        end++;
+    if (errno != 0 || end == str || *end != '\0' || value == 0 || value > SIZE_MAX / scale)
+        err_error("invalid size %s\n", str);
+    return (size_t)value * scale;
+}
+
+/* Options from a set such as "-", "-c", "-cn" or "-S C++17" */
+static void parse_opts(const char *set, SCC_Options *opts)
+{
+    scc_options_init(opts);
+    const char *p = set;
+    if (*p++ != '-')
+        err_error("invalid option set '%s'\n", set);
+    for ( ; *p != '\0'; p++)
+    {
+        switch (*p)
+        {
+        case 'c': opts->cflag = true; break;
+        case 'e': opts->eflag = true; break;
+        case 'n': opts->nflag = true; break;
+        case 't': opts->tflag = true; break;
+        case 'w': opts->wflag = true; break;
+        case 'q': opts->qchar = 'Q'; break;
+        case 's': opts->schar = 'S'; break;
+        case 'S':
+            while (p[1] == ' ')
+                p++;
+            if ((opts->std_code = scc_std_code(p + 1)) < 0)
+                err_error("invalid standard in option set '%s'\n", set);
+            return;
+        default:
+            err_error("invalid option set '%s'\n", set);
+        }
+    }
+}
+
+/* Split a comma-separated list in place */
+static size_t split(char *list, char **items, size_t max_items)
+{
+    size_t n = 0;
+    for (char *item = strtok(list, ","); item != 0 && n < max_items; item = strtok(0, ","))
+        items[n++] = item;
+    return n;
+}
+
+static int count_write(void *data, const char *buffer, size_t len)
+{
+    (void)buffer;
+    *(size_t *)data += len;
+    return 0;
+}
+
+static void null_map(void *data, int out_line, size_t out_col, int in_line, size_t in_col)
+{
+    (void)data;
+    (void)out_line;
+    (void)out_col;
+    (void)in_line;
+    (void)in_col;
+}
+
+/* Strip the corpus by the given method: whole, streamed in pieces, or with a map */
+static int strip_by(SCC_Scanner *sc, const Buffer *in, SCC_Sink *sink, int method)
+{
+    sink->map = (method == M_MAP) ? null_map : 0;
+    if (method != M_STREAM)
+        return scc_strip(sc, "bench", in->data, in->len, sink);
+    if (scc_stream_begin(sc, "bench", sink) != 0)
+        return -1;
+    for (size_t off = 0; off < in->len; off += STREAM_PIECE)
+    {
+        size_t len = (in->len - off < STREAM_PIECE) ? in->len - off : STREAM_PIECE;
+        if (scc_stream_write(sc, in->data + off, len) != 0)
+            return -1;
+    }
+    return scc_stream_end(sc);
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Best time per byte over reps runs, each run long enough to time */
+static double measure(const SCC_Options *opts, const Buffer *in, int reps, int method)
+{
+    SCC_Scanner *sc = scc_create(opts);
+    if (sc == 0)
+        err_syserr("failed to create scanner: ");
+    size_t out_len = 0;
+    SCC_Sink sink = { .write = count_write, .data = &out_len };
+    double best = 0.0;
+    for (int r = 0; r < reps; r++)
+    {
+        double start = now_ns();
+        double elapsed;
+        size_t iters = 0;
+        do
+        {
+            if (strip_by(sc, in, &sink, method) != 0)
+                err_syserr("failed to strip corpus: ");
+            iters++;
+        } while ((elapsed = now_ns() - start) < MIN_NSEC);
+        double ns_per_byte = elapsed / ((double)iters * (double)in->len);
+        if (r == 0 || ns_per_byte < best)
+            best = ns_per_byte;
+    }
+    scc_destroy(sc);
+    return best;
+}
+
+static size_t read_baseline(const char *file, Baseline **base)
+{
+    FILE *fp = fopen(file, "r");
+    if (fp == 0)
+        err_syserr("failed to open baseline file %s: ", file);
+    size_t n = 0;
+    size_t max = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != 0)
+    {
+        double ns;
+        int offset;
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '#' || sscanf(line, "%lf %n", &ns, &offset) != 1)
+            continue;
+        if (n >= max)
+        {
+            max = max * 2 + 16;
+            if ((*base = realloc(*base, max * sizeof(**base))) == 0)
+                err_syserr("failed to allocate memory: ");
+        }
+        if (((*base)[n].key = strdup(line + offset)) == 0)
+            err_syserr("failed to allocate memory: ");
+        (*base)[n++].ns_per_byte = ns;
+    }
+    fclose(fp);
+    return n;
+}
+
+static const Baseline *find_baseline(const Baseline *base, size_t n, const char *key)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (strcmp(base[i].key, key) == 0)
+            return &base[i];
+    }
+    return 0;
+}
+
+/*
+** Check that the time per byte of each kind, option set and method does
+** not grow with the size of the corpus by more than factor; the input
+** of the first size is the reference.  A growth is measured again
+** before it is believed.  Returns the exit status.
+*/
+static int check_linear(char **kinds, size_t num_kinds, char **sets, size_t num_sets,
+                        char **sizes, size_t num_sizes, int reps, double factor)
+{
+    Buffer corpus = { 0, 0, 0 };
+    uint64_t seed0 = seed;
+    int measured = 0;
+    int failed = 0;
+
+    printf("%-11s %5s  %-10s %-6s %9s %7s\n", "kind", "size", "options", "method",
+           "ns/byte", "growth");
+    fflush(stdout);
+    for (size_t k = 0; k < num_kinds; k++)
+    {
+        const Corpus *cp = find_corpus(kinds[k]);
+        for (size_t o = 0; o < num_sets; o++)
+        {
+            SCC_Options opts;
+            parse_opts(sets[o], &opts);
+            for (int m = 0; m < NUM_METHODS; m++)
+            {
+                double ref = 0.0;
+                for (size_t z = 0; z < num_sizes; z++)
+                {
+                    seed = seed0;
+                    generate(cp, parse_size(sizes[z]), &corpus);
+                    double ns = measure(&opts, &corpus, reps, m);
+                    for (int retry = 0; z > 0 && retry < MAX_RETRIES && ns > factor * ref; retry++)
+                    {
+                        double again = measure(&opts, &corpus, reps, m);
+                        if (again < ns)
+                            ns = again;
+                    }
+                    if (z == 0)
+                        ref = ns;
+                    printf("%-11s %5s  %-10s %-6s %9.3f %6.2fx", cp->name, sizes[z], sets[o],
+                           method_names[m], ns, ns / ref);
+                    if (ns > factor * ref)
+                    {
+                        printf("  !! SUPERLINEAR !!");
+                        failed++;
+                    }
+                    measured++;
+                    putchar('\n');
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+    free(corpus.data);
+
+    if (failed == 0)
+    {
+        printf("== PASS == (%d measurements within %.1f times the ns/byte at %s)\n",
+               measured, factor, sizes[0]);
+        return 0;
+    }
+    printf("!! FAIL !! (%d of %d measurements more than %.1f times the ns/byte at %s)\n",
+           failed, measured, factor, sizes[0]);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    const char *gen_kind = 0;
+    const char *base_file = 0;
+    char kinds[256] = "";
+    char opt_sets[256];
+    char sizes[256] = "";
+    int reps = 5;
+    double threshold = 50.0;
+    double factor = 3.0;
+    bool lflag = false;
+    bool wflag = false;
+
+    err_setarg0(argv[0]);
+    strcpy(opt_sets, def_opts);
+
+    while ((opt = getopt(argc, argv, optstr)) != EOF)
+    {
+        switch (opt)
+        {
+        case 'b':
+            base_file = optarg;
+            break;
+        case 'g':
+            gen_kind = optarg;
+            break;
+        case 'h':
+            err_help(usestr, hlpstr);
+            break;
+        case 'k':
+            snprintf(kinds, sizeof(kinds), "%s", optarg);
+            break;
+        case 'l':
+            lflag = true;
+            break;
+        case 'o':
+            snprintf(opt_sets, sizeof(opt_sets), "%s", optarg);
+            break;
+        case 'r':
+            if ((reps = atoi(optarg)) <= 0)
+                err_error("invalid repetition count %s\n", optarg);
+            break;
+        case 's':
+            seed = strtoull(optarg, 0, 0);
+            break;
+        case 't':
+            if ((threshold = atof(optarg)) <= 0.0)
+                err_error("invalid threshold %s\n", optarg);
+            break;
+        case 'w':
+            wflag = true;
+            break;
+        case 'x':
+            if ((factor = atof(optarg)) < 1.0)
+                err_error("invalid growth factor %s\n", optarg);
+            break;
+        case 'z':
+            snprintf(sizes, sizeof(sizes), "%s", optarg);
+            break;
+        default:
+            err_usage(usestr);
+            break;
+        }
+    }
+    if (optind != argc || (wflag && base_file == 0) || (lflag && (wflag || base_file != 0)))
+        err_usage(usestr);
+    if (sizes[0] == '\0')
+        strcpy(sizes, lflag ? def_lin_sizes : def_sizes);
+    if (kinds[0] == '\0')
+    {
+        const Corpus *set = lflag ? adversaries : corpora;
+        int num = lflag ? NUM_ADVERSARIES : NUM_CORPORA;
+        for (int i = 0; i < num; i++)
+        {
+            strcat(kinds, (i > 0) ? "," : "");
+            strcat(kinds, set[i].name);
+        }
+    }
+
+    Buffer corpus = { 0, 0, 0 };
+    uint64_t seed0 = seed;
+
+    if (gen_kind != 0)
+    {
+        generate(find_corpus(gen_kind), parse_size(sizes), &corpus);
+        if (fwrite(corpus.data, 1, corpus.len, stdout) != corpus.len || fflush(stdout) != 0)
+            err_syserr("failed to write corpus: ");
+        free(corpus.data);
+        return 0;
+    }
+
+    char *kind_list[(NUM_CORPORA + NUM_ADVERSARIES) * 2];
+    char *set_list[32];
+    char *size_list[16];
+    size_t num_kinds = split(kinds, kind_list, sizeof(kind_list) / sizeof(kind_list[0]));
+    size_t num_sets = split(opt_sets, set_list, sizeof(set_list) / sizeof(set_list[0]));
+    size_t num_sizes = split(sizes, size_list, sizeof(size_list) / sizeof(size_list[0]));
+    if (lflag)
+        return check_linear(kind_list, num_kinds, set_list, num_sets, size_list, num_sizes,
+                            reps, factor);
+
+    Baseline *base = 0;
+    size_t num_base = 0;
+    FILE *wfp = 0;
+    if (wflag)
+    {
+        if ((wfp = fopen(base_file, "w")) == 0)
+            err_syserr("failed to create baseline file %s: ", base_file);
+        fprintf(wfp, "# SCC benchmark baseline (sccbench -w): ns/byte kind size options\n");
+        fprintf(wfp, "# Specific to the machine and compiler options used to record it\n");
+    }
+    else if (base_file != 0)
+        num_base = read_baseline(base_file, &base);
+
+    printf("%-10s %5s  %-10s %9s %9s", "kind", "size", "options", "MB/s", "ns/byte");
+    if (num_base > 0)
+        printf(" %9s %8s", "baseline", "change");
+    putchar('\n');
+    fflush(stdout);
+
+    int measured = 0;
+    int slower = 0;
+    for (size_t k = 0; k < num_kinds; k++)
+    {
+        const Corpus *cp = find_corpus(kind_list[k]);
+        for (size_t z = 0; z < num_sizes; z++)
+        {
+            seed = seed0;
+            generate(cp, parse_size(size_list[z]), &corpus);
+            for (size_t o = 0; o < num_sets; o++)
+            {
+                SCC_Options opts;
+                char key[128];
+                parse_opts(set_list[o], &opts);
+                snprintf(key, sizeof(key), "%s %s %s", cp->name, size_list[z], set_list[o]);
+                double ns = measure(&opts, &corpus, reps, M_STRIP);
+                const Baseline *bp = find_baseline(base, num_base, key);
+                /* Measure an apparent regression again before believing it */
+                for (int retry = 0; retry < MAX_RETRIES; retry++)
+                {
+                    if (bp == 0 || (ns / bp->ns_per_byte - 1.0) * 100.0 <= threshold)
+                        break;
+                    double again = measure(&opts, &corpus, reps, M_STRIP);
+                    if (again < ns)
+                        ns = again;
+                }
+                printf("%-10s %5s  %-10s %9.1f %9.3f", cp->name, size_list[z], set_list[o],
+                       1000.0 / ns, ns);
+                if (bp != 0)
+                {
+                    double change = (ns / bp->ns_per_byte - 1.0) * 100.0;
+                    printf(" %9.3f %+7.1f%%", bp->ns_per_byte, change);
+                    if (change > threshold)
+                    {
+                        printf("  !! SLOWER !!");
+                        slower++;
+                    }
+                    measured++;
+                }
+                putchar('\n');
+                fflush(stdout);
+                if (wfp != 0)
+                    fprintf(wfp, "%.4f %s\n", ns, key);
+            }
+        }
+    }
+
+    free(corpus.data);
+    for (size_t i = 0; i < num_base; i++)
+        free(base[i].key);
+    free(base);
+    if (wfp != 0)
+    {
+        if (fclose(wfp) != 0)
+            err_syserr("failed to write baseline file %s: ", base_file);
+        printf("== Baseline written to %s ==\n", base_file);
+        return 0;
+    }
+    if (num_base == 0)
+        return 0;
+    if (slower == 0)
+    {
+        printf("== PASS == (%d measurements within %.0f%% of baseline)\n", measured, threshold);
+        return 0;
+    }
+    printf("!! FAIL !! (%d of %d measurements more than %.0f%% slower than baseline)\n",
+           slower, measured, threshold);
+    return 1;
+}
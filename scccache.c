@@ -0,0 +1,586 @@
+/*
+@(#)File:           $RCSfile: scccache.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 20:00:00 $
+@(#)Purpose:        Cache of SCC output across runs
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+@(#)Product:        SCC Version 8.0.3 (2022-05-30)
+*/
+
+/*TABSTOP=4*/
+
+/*
+** The cache directory holds 256 subdirectories, named by the first two
+** hex digits of the hash; an entry is named by the rest of the hash and
+** the length of the input.  An entry is a header, the warnings and the
+** output, so that the output can be passed on as it is (or copied by
+** the kernel) straight from the mapped entry.  The entries are in the
+** byte order of the machine.  Each hit updates the modification time
+** of the entry, which is what eviction goes by.
+*/
+
+#include "posixver.h"
+#include "scccache.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+enum { CACHE_DIVISOR = 16 };    /* Largest input kept: 1/CACHE_DIVISOR of the limit */
+
+static const char cache_magic[8] = "SCCache1";
+
+typedef struct CacheHeader
+{
+    char        magic[8];
+    uint64_t    hash;
+    uint64_t    in_len;
+    uint64_t    out_len;
+    uint64_t    diag_len;       /* Bytes of warnings after the header */
+    uint64_t    num_diag;
+    SCC_Stats   stats;
+} CacheHeader;
+
+/* Each warning: this, the message and its null, padded to a multiple of 8 bytes */
+typedef struct CacheDiag
+{
+    uint64_t    offset;         /* Output preceding the warning */
+    uint32_t    line;
+    uint32_t    msg_len;        /* Including the null */
+} CacheDiag;
+
+struct Cache
+{
+    char           *dir;
+    int             dfd;
+    size_t          limit;
+    uint64_t        salt;
+    pthread_mutex_t lock;       /* Protects stats */
+    CacheStats      stats;
+};
+
+/* An entry seen while evicting */
+typedef struct CacheFile
+{
+    char       *name;           /* Relative to the cache directory */
+    off_t       size;
+    struct timespec mtime;
+} CacheFile;
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_scccache_c[];
+const char jlss_id_scccache_c[] = "@(#)$Id: scccache.c,v 1.1 2026/10/17 20:00:00 jleffler Exp $";
+#endif /* lint */
+
+/*
+** XXH64, as specified by its author (Yann Collet), reading the input
+** as little-endian 64-bit and 32-bit words whatever the machine.
+*/
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint32_t read32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t xxh_merge(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t cache_hash(const void *data, size_t len, uint64_t seed)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = p + len;
+    uint64_t h;
+
+    if (len >= 32)
+    {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        do
+        {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= end - 32);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    }
+    else
+        h = seed + PRIME64_5;
+    h += (uint64_t)len;
+
+    while (end - p >= 8)
+    {
+        h ^= xxh_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (end - p >= 4)
+    {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= *p++ * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static void cache_count(Cache *cp, size_t *counter)
+{
+    pthread_mutex_lock(&cp->lock);
+    (*counter)++;
+    pthread_mutex_unlock(&cp->lock);
+}
+
+/* Name of entry, relative to the cache directory: "xx/xxxxxxxxxxxxxx-len" */
+static void entry_name(char *buffer, size_t buflen, const CacheKey *key)
+{
+    snprintf(buffer, buflen, "%02x/%014llx-%zx", (unsigned)(key->hash >> 56),
+             (unsigned long long)(key->hash & 0x00FFFFFFFFFFFFFFULL), key->len);
+}
+
+Cache *cache_open(const char *dir, size_t limit, const char *salt)
+{
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+        return 0;
+    Cache *cp = calloc(1, sizeof(*cp));
+    if (cp == 0)
+        return 0;
+    if ((cp->dir = strdup(dir)) == 0 ||
+        (cp->dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+    {
+        int errnum = errno;
+        free(cp->dir);
+        free(cp);
+        errno = errnum;
+        return 0;
+    }
+    cp->limit = limit;
+    cp->salt = cache_hash(salt, strlen(salt), 0);
+    pthread_mutex_init(&cp->lock, 0);
+    return cp;
+}
+
+bool cache_eligible(const Cache *cp, size_t len)
+{
+    return len <= cp->limit / CACHE_DIVISOR;
+}
+
+CacheKey cache_key(const Cache *cp, const SCC_Options *opts, const char *in, size_t len)
+{
+    char buffer[64];
+    int n = snprintf(buffer, sizeof(buffer), "r=%d S=%d c=%d e=%d n=%d t=%d w=%d q=%d s=%d",
+                     SCC_REVISION, opts->std_code, opts->cflag, opts->eflag, opts->nflag, opts->tflag,
+                     opts->wflag, opts->qchar, opts->schar);
+    uint64_t seed = cache_hash(buffer, (size_t)n, cp->salt);
+    return (CacheKey){ cache_hash(in, len, seed), len };
+}
+
+/*
+** Whether the warnings of an entry (diag_len bytes) are well formed:
+** each record and its message within the warnings, the message ending
+** with its null, and each offset within the output and no less than
+** the one before.
+*/
+static bool diags_valid(const CacheEntry *ep, size_t diag_len)
+{
+    const char *dp = ep->diag;
+    const char *end = ep->diag + diag_len;
+    uint64_t offset = 0;
+
+    for (size_t i = 0; i < ep->num_diag; i++)
+    {
+        CacheDiag diag;
+        if ((size_t)(end - dp) < sizeof(diag))
+            return false;
+        memcpy(&diag, dp, sizeof(diag));
+        size_t size = (sizeof(diag) + (size_t)diag.msg_len + 7) & ~(size_t)7;
+        if (diag.msg_len == 0 || size > (size_t)(end - dp) ||
+            dp[sizeof(diag) + diag.msg_len - 1] != '\0' ||
+            diag.offset < offset || diag.offset > ep->out_len)
+            return false;
+        offset = diag.offset;
+        dp += size;
+    }
+    return true;
+}
+
+bool cache_lookup(Cache *cp, const CacheKey *key, CacheEntry *ep)
+{
+    char name[64];
+    struct stat sb;
+    CacheHeader hdr;
+
+    entry_name(name, sizeof(name), key);
+    *ep = (CacheEntry){ .fd = -1 };
+    if ((ep->fd = openat(cp->dfd, name, O_RDONLY | O_CLOEXEC)) < 0)
+    {
+        cache_count(cp, &cp->stats.misses);
+        return false;
+    }
+    if (fstat(ep->fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(hdr) &&
+        (ep->map = mmap(0, (size_t)sb.st_size, PROT_READ, MAP_SHARED, ep->fd, 0)) != MAP_FAILED)
+    {
+        ep->map_len = (size_t)sb.st_size;
+        memcpy(&hdr, ep->map, sizeof(hdr));
+        if (memcmp(hdr.magic, cache_magic, sizeof(cache_magic)) == 0 &&
+            hdr.hash == key->hash && hdr.in_len == key->len &&
+            hdr.diag_len <= ep->map_len - sizeof(hdr) &&
+            hdr.out_len == ep->map_len - sizeof(hdr) - hdr.diag_len &&
+            hdr.num_diag <= hdr.diag_len / sizeof(CacheDiag))
+        {
+            ep->diag = ep->map + sizeof(hdr);
+            ep->num_diag = (size_t)hdr.num_diag;
+            ep->out = ep->diag + hdr.diag_len;
+            ep->out_len = (size_t)hdr.out_len;
+            ep->stats = hdr.stats;
+        }
+        if (ep->diag != 0 && diags_valid(ep, (size_t)hdr.diag_len))
+        {
+            /* Used now, as far as eviction is concerned */
+            futimens(ep->fd, 0);
+            cache_count(cp, &cp->stats.hits);
+            return true;
+        }
+    }
+    else
+        ep->map = 0;
+    cache_release(ep);
+    cache_count(cp, &cp->stats.misses);
+    return false;
+}
+
+static int replay_output(const SCC_Sink *sink, const char *buffer, size_t len)
+{
+    if (len == 0)
+        return 0;
+    if (sink->writev != 0)
+    {
+        struct iovec iov = { .iov_base = (void *)buffer, .iov_len = len };
+        return (*sink->writev)(sink->data, &iov, 1);
+    }
+    return (*sink->write)(sink->data, buffer, len);
+}
+
+int cache_replay(const CacheEntry *ep, const char *name, const SCC_Sink *sink)
+{
+    const char *dp = ep->diag;
+    size_t offset = 0;
+
+    for (size_t i = 0; i < ep->num_diag; i++)
+    {
+        CacheDiag diag;
+        memcpy(&diag, dp, sizeof(diag));
+        if (diag.offset > ep->out_len || diag.offset < offset)
+            break;
+        if (replay_output(sink, ep->out + offset, diag.offset - offset) != 0)
+            return -1;
+        offset = diag.offset;
+        if (sink->diag != 0)
+            (*sink->diag)(sink->data, name, (int)diag.line, dp + sizeof(diag));
+        dp += (sizeof(diag) + diag.msg_len + 7) & ~(size_t)7;
+    }
+    return replay_output(sink, ep->out + offset, ep->out_len - offset);
+}
+
+void cache_release(CacheEntry *ep)
+{
+    if (ep->map != 0)
+        munmap((void *)ep->map, ep->map_len);
+    if (ep->fd >= 0)
+        close(ep->fd);
+    ep->map = 0;
+    ep->fd = -1;
+}
+
+/*
+** Recording: the sink keeps a copy of the output and the warnings.  If
+** memory runs out, the recording is abandoned (the results still go to
+** the next sink).
+*/
+static bool record_grow(CacheRecord *rp, char **buffer, size_t *size, size_t need)
+{
+    if (need <= *size)
+        return true;
+    size_t new_size = *size * 2 + need;
+    char *new_buffer = realloc(*buffer, new_size);
+    if (new_buffer == 0)
+    {
+        rp->cache = 0;
+        return false;
+    }
+    *buffer = new_buffer;
+    *size = new_size;
+    return true;
+}
+
+static void record_output(CacheRecord *rp, const char *buffer, size_t len)
+{
+    if (rp->cache != 0 && record_grow(rp, &rp->out, &rp->out_size, rp->out_len + len))
+    {
+        memcpy(rp->out + rp->out_len, buffer, len);
+        rp->out_len += len;
+    }
+}
+
+static int record_write(void *data, const char *buffer, size_t len)
+{
+    CacheRecord *rp = data;
+    record_output(rp, buffer, len);
+    return (*rp->next.write)(rp->next.data, buffer, len);
+}
+
+static int record_writev(void *data, const struct iovec *iov, int iovcnt)
+{
+    CacheRecord *rp = data;
+    for (int i = 0; i < iovcnt; i++)
+        record_output(rp, iov[i].iov_base, iov[i].iov_len);
+    return (*rp->next.writev)(rp->next.data, iov, iovcnt);
+}
+
+static void record_diag(void *data, const char *name, int line, const char *msg)
+{
+    CacheRecord *rp = data;
+    CacheDiag diag = { rp->out_len, (uint32_t)line, (uint32_t)strlen(msg) + 1 };
+    size_t size = (sizeof(diag) + diag.msg_len + 7) & ~(size_t)7;
+    if (rp->cache != 0 && record_grow(rp, &rp->diag, &rp->diag_size, rp->diag_len + size))
+    {
+        memset(rp->diag + rp->diag_len, '\0', size);
+        memcpy(rp->diag + rp->diag_len, &diag, sizeof(diag));
+        memcpy(rp->diag + rp->diag_len + sizeof(diag), msg, diag.msg_len);
+        rp->diag_len += size;
+        rp->num_diag++;
+    }
+    if (rp->next.diag != 0)
+        (*rp->next.diag)(rp->next.data, name, line, msg);
+}
+
+SCC_Sink cache_record(CacheRecord *rp, Cache *cp, const CacheKey *key, const SCC_Sink *next)
+{
+    *rp = (CacheRecord){ .cache = cp, .key = *key, .next = *next };
+    SCC_Sink sink = { .write = record_write, .diag = record_diag, .data = rp, .flags = next->flags };
+    if (next->writev != 0)
+        sink.writev = record_writev;
+    return sink;
+}
+
+/* Write the entry to a temporary file in its subdirectory, and rename it into place */
+void cache_store(CacheRecord *rp, const SCC_Stats *stats, bool ok)
+{
+    Cache *cp = rp->cache;
+    if (cp != 0 && ok)
+    {
+        char name[64];
+        entry_name(name, sizeof(name), &rp->key);
+        size_t size = strlen(cp->dir) + sizeof(name) + sizeof("/.XXXXXX");
+        char *path = malloc(size);
+        char *tmp = malloc(size);
+        if (path != 0 && tmp != 0)
+        {
+            snprintf(path, size, "%s/%.2s", cp->dir, name);
+            mkdir(path, 0777);
+            snprintf(path, size, "%s/%s", cp->dir, name);
+            snprintf(tmp, size, "%s/%.2s/.XXXXXX", cp->dir, name);
+            int fd = mkstemp(tmp);
+            if (fd >= 0)
+            {
+                CacheHeader hdr = { .hash = rp->key.hash, .in_len = rp->key.len,
+                                    .out_len = rp->out_len, .diag_len = rp->diag_len,
+                                    .num_diag = rp->num_diag, .stats = *stats };
+                memcpy(hdr.magic, cache_magic, sizeof(cache_magic));
+                struct iovec iov[3] =
+                {
+                    { &hdr, sizeof(hdr) }, { rp->diag, rp->diag_len }, { rp->out, rp->out_len }
+                };
+                size_t total = sizeof(hdr) + rp->diag_len + rp->out_len;
+                ssize_t nbytes = writev(fd, iov, 3);
+                bool written = (nbytes >= 0 && (size_t)nbytes == total);
+                if (close(fd) == 0 && written && fchmodat(AT_FDCWD, tmp, 0644, 0) == 0 &&
+                    rename(tmp, path) == 0)
+                    cache_count(cp, &cp->stats.stored);
+                else
+                    unlink(tmp);
+            }
+        }
+        free(path);
+        free(tmp);
+    }
+    free(rp->out);
+    free(rp->diag);
+    rp->out = rp->diag = 0;
+}
+
+static int cmp_mtime(const void *v1, const void *v2)
+{
+    const CacheFile *f1 = v1;
+    const CacheFile *f2 = v2;
+    if (f1->mtime.tv_sec != f2->mtime.tv_sec)
+        return (f1->mtime.tv_sec < f2->mtime.tv_sec) ? -1 : +1;
+    if (f1->mtime.tv_nsec != f2->mtime.tv_nsec)
+        return (f1->mtime.tv_nsec < f2->mtime.tv_nsec) ? -1 : +1;
+    return strcmp(f1->name, f2->name);
+}
+
+/* Remove the entries used least recently until the cache is within 90% of its limit */
+static void cache_evict(Cache *cp)
+{
+    CacheFile *files = 0;
+    size_t num_files = 0;
+    size_t max_files = 0;
+    unsigned long long total = 0;
+
+    for (int sub = 0; sub < 256; sub++)
+    {
+        char subdir[4];
+        snprintf(subdir, sizeof(subdir), "%02x", sub);
+        int fd = openat(cp->dfd, subdir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        DIR *dp;
+        if (fd < 0 || (dp = fdopendir(fd)) == 0)
+        {
+            if (fd >= 0)
+                close(fd);
+            continue;
+        }
+        struct dirent *de;
+        while ((de = readdir(dp)) != 0)
+        {
+            struct stat sb;
+            if (de->d_name[0] == '.' ||
+                fstatat(dirfd(dp), de->d_name, &sb, AT_SYMLINK_NOFOLLOW) != 0 ||
+                !S_ISREG(sb.st_mode))
+                continue;
+            if (num_files >= max_files)
+            {
+                size_t new_max = max_files * 2 + 256;
+                void *new_files = realloc(files, new_max * sizeof(*files));
+                if (new_files == 0)
+                    break;
+                files = new_files;
+                max_files = new_max;
+            }
+            size_t size = sizeof(subdir) + strlen(de->d_name) + 1;
+            char *name = malloc(size);
+            if (name == 0)
+                break;
+            snprintf(name, size, "%s/%s", subdir, de->d_name);
+            files[num_files++] = (CacheFile){ name, sb.st_size, sb.st_mtim };
+            total += (unsigned long long)sb.st_size;
+        }
+        closedir(dp);
+    }
+
+    if (total > cp->limit)
+    {
+        unsigned long long target = cp->limit / 10 * 9;
+        qsort(files, num_files, sizeof(*files), cmp_mtime);
+        for (size_t i = 0; i < num_files && total > target; i++)
+        {
+            if (unlinkat(cp->dfd, files[i].name, 0) == 0)
+            {
+                total -= (unsigned long long)files[i].size;
+                cp->stats.evicted++;
+            }
+        }
+    }
+    for (size_t i = 0; i < num_files; i++)
+        free(files[i].name);
+    free(files);
+}
+
+void cache_close(Cache *cp, CacheStats *stats)
+{
+    /* Only a run that added entries can have taken the cache over its limit */
+    if (cp->stats.stored > 0)
+        cache_evict(cp);
+    if (stats != 0)
+        *stats = cp->stats;
+    close(cp->dfd);
+    pthread_mutex_destroy(&cp->lock);
+    free(cp->dir);
+    free(cp);
+}
+
+#ifdef TEST
+
+/* Known values of XXH64 */
+int main(void)
+{
+    static const struct { const char *data; uint64_t seed; uint64_t hash; } tests[] =
+    {
+        { "",    0, 0xEF46DB3751D8E999ULL },
+        { "a",   0, 0xD24EC4F1A98C6E5BULL },
+        { "abc", 0, 0x44BC2CF5AD770999ULL },
+        { "Nobody inspects the spammish repetition", 0, 0xFBCEA83C8A378BF1ULL },
+    };
+    int fail = 0;
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+    {
+        uint64_t hash = cache_hash(tests[i].data, strlen(tests[i].data), tests[i].seed);
+        if (hash != tests[i].hash)
+        {
+            printf("!! FAIL !! XXH64(\"%s\", %llu) = %016llX, not %016llX\n", tests[i].data,
+                   (unsigned long long)tests[i].seed, (unsigned long long)hash,
+                   (unsigned long long)tests[i].hash);
+            fail++;
+        }
+    }
+    if (fail == 0)
+        printf("== PASS == XXH64 known values\n");
+    return (fail == 0) ? 0 : 1;
+}
+
+#endif /* TEST */
@@ -0,0 +1,116 @@
+/*
+@(#)File:           $RCSfile: scccache.h,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 20:00:00 $
+@(#)Purpose:        Cache of SCC output across runs
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+@(#)Product:        SCC Version 8.0.3 (2022-05-30)
+*/
+
+/*TABSTOP=4*/
+
+#ifndef SCCCACHE_H_INCLUDED
+#define SCCCACHE_H_INCLUDED
+
+#ifdef MAIN_PROGRAM
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_scccache_h[];
+const char jlss_id_scccache_h[] = "@(#)$Id: scccache.h,v 1.1 2026/10/17 20:00:00 jleffler Exp $";
+#endif /* lint */
+#endif /* MAIN_PROGRAM */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "libscc.h"
+
+/*
+** A directory of the results of stripping inputs: the output, the
+** warnings (without the file name) and the counts.  An entry is named
+** by a hash of the input and the options, so inputs with the same
+** contents share it, within a run and across runs.  Entries are
+** written to a temporary file and renamed into place, so that runs
+** can share a cache.  The entries used least recently are removed
+** when the cache grows beyond its size limit.  A Cache can be used by
+** several threads at once.
+*/
+typedef struct Cache Cache;
+
+typedef struct CacheKey
+{
+    uint64_t    hash;       /* Hash of the input and the options */
+    size_t      len;        /* Length of the input */
+} CacheKey;
+
+/* An entry found in the cache, mapped into memory */
+typedef struct CacheEntry
+{
+    int         fd;
+    const char *map;
+    size_t      map_len;
+    const char *out;        /* Output, within the mapping */
+    size_t      out_len;
+    const char *diag;       /* Warnings, within the mapping */
+    size_t      num_diag;
+    SCC_Stats   stats;      /* Counts from stripping the input */
+} CacheEntry;
+
+/* The results of stripping an input, as they are produced */
+typedef struct CacheRecord
+{
+    Cache      *cache;      /* Null if the results are not kept */
+    CacheKey    key;
+    SCC_Sink    next;       /* Where the results go as well */
+    char       *out;
+    size_t      out_len;
+    size_t      out_size;
+    char       *diag;
+    size_t      diag_len;
+    size_t      diag_size;
+    size_t      num_diag;
+} CacheRecord;
+
+typedef struct CacheStats
+{
+    size_t      hits;
+    size_t      misses;
+    size_t      stored;     /* Entries added */
+    size_t      evicted;    /* Entries removed to keep within the limit */
+} CacheStats;
+
+/* XXH64 hash of data[0..len-1] */
+extern uint64_t cache_hash(const void *data, size_t len, uint64_t seed);
+
+/*
+** Open (creating if need be) the cache in dir, limited to about limit
+** bytes.  The salt (such as the version of the program) is part of
+** every key, so that a different salt does not find the same entries.
+** Returns null with errno set on failure.
+*/
+extern Cache *cache_open(const char *dir, size_t limit, const char *salt);
+/* Remove the oldest entries if the cache is over its limit, and close it */
+extern void cache_close(Cache *cp, CacheStats *stats);
+
+/* Whether an input of len bytes is small enough to be kept */
+extern bool cache_eligible(const Cache *cp, size_t len);
+extern CacheKey cache_key(const Cache *cp, const SCC_Options *opts, const char *in, size_t len);
+
+/* Find an entry; returns true (counting a hit) with *ep set, or false (counting a miss) */
+extern bool cache_lookup(Cache *cp, const CacheKey *key, CacheEntry *ep);
+/* Send the output and warnings of an entry to sink, as from input name; 0 or -1 */
+extern int cache_replay(const CacheEntry *ep, const char *name, const SCC_Sink *sink);
+extern void cache_release(CacheEntry *ep);
+
+/*
+** Record the results sent to the sink returned, which passes them on to
+** next; cache_store() adds them to the cache if ok, and frees them.  The
+** sink has the flags of next: if next does not need the warnings in
+** order with the output (SCC_SINK_UNORDERED), neither does a replay, and
+** the offset recorded for a warning is only a lower bound.
+*/
+extern SCC_Sink cache_record(CacheRecord *rp, Cache *cp, const CacheKey *key, const SCC_Sink *next);
+extern void cache_store(CacheRecord *rp, const SCC_Stats *stats, bool ok);
+
+#endif /* SCCCACHE_H_INCLUDED */
@@ -0,0 +1,536 @@
+/*
+@(#)File:           $RCSfile: sccclient.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 23:00:00 $
+@(#)Purpose:        Client of the SCC server, and latency benchmark
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+*/
+
+/*TABSTOP=4*/
+
+/*
+**  Strips each named file (or standard input) by sending a request to
+**  an SCC server (scc --server; see sccserve.h for the protocol), and
+**  writes the output to standard output and the warnings to standard
+**  error, as scc would.  The server is reached through its socket (-u)
+**  or started as a child talking through pipes (-x prog, default scc).
+**  By default a file is named in the request and read by the server;
+**  with -C its contents are sent instead.
+**
+**  With -L n, nothing is written: each request is sent n times and the
+**  round trips are timed, and then the program (-x) is run n times on
+**  each file as separate processes, which is what the server saves.
+**  The minimum, median, 90th and 99th percentile times are reported in
+**  microseconds.
+*/
+
+#include "posixver.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "stderr.h"
+
+typedef struct Buffer
+{
+    char   *data;
+    size_t  len;
+    size_t  size;
+} Buffer;
+
+/* A response, pointing into the buffer it was read into */
+typedef struct Response
+{
+    const char *error;      /* Message if the status is an error, or null */
+    const char *out;
+    size_t      out_len;
+    const char *warn;
+    size_t      warn_len;
+} Response;
+
+static const char optstr[] = "CcehL:nq:s:S:tu:wx:";
+static const char usestr[] = "[-Ccehntw][-q rep][-s rep][-S std][-u socket][-x prog][-L n] [file ...]";
+static const char hlpstr[] =
+    "  -C        Send the contents of the files rather than their names\n"
+    "  -c        Print comments and not the code\n"
+    "  -e        Print empty comment /* */ or //\n"
+    "  -h        Print this help and exit\n"
+    "  -L n      Time n round trips for each file, and n runs of the program\n"
+    "  -n        Keep newlines in comments\n"
+    "  -q rep    Replace the body of character literals with rep\n"
+    "  -s rep    Replace the body of string literals with rep\n"
+    "  -S std    Specify language standard\n"
+    "  -t        Retain trailing white space\n"
+    "  -u socket Connect to the server listening on the UNIX socket\n"
+    "  -w        Warn about nested C-style comments\n"
+    "  -x prog   Start prog --server (default scc), and run it for -L\n"
+    ;
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_sccclient_c[];
+const char jlss_id_sccclient_c[] = "@(#)$Id: sccclient.c,v 1.1 2026/10/17 23:00:00 jleffler Exp $";
+#endif /* lint */
+
+static char flags[16];          /* Flags without arguments, such as "-cn" */
+static const char *qrep = 0;    /* -q */
+static const char *srep = 0;    /* -s */
+static const char *std = 0;     /* -S */
+static bool send_content = false;   /* -C */
+static int to_fd = -1;          /* Requests go here */
+static int from_fd = -1;        /* Responses come from here */
+
+static void buf_add(Buffer *bp, const char *str, size_t len)
+{
+    if (len > bp->size - bp->len)
+    {
+        size_t new_size = bp->size * 2 + len;
+        char *new_data = realloc(bp->data, new_size);
+        if (new_data == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", new_size);
+        bp->data = new_data;
+        bp->size = new_size;
+    }
+    memcpy(bp->data + bp->len, str, len);
+    bp->len += len;
+}
+
+static void buf_str(Buffer *bp, const char *str)
+{
+    buf_add(bp, str, strlen(str));
+}
+
+static void read_all(int fd, const char *name, Buffer *bp)
+{
+    char buffer[65536];
+    ssize_t nbytes;
+    while ((nbytes = read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+            err_syserr("read error on file %s: ", name);
+        buf_add(bp, buffer, (size_t)nbytes);
+    }
+}
+
+/* Connect to the server on the socket */
+static void connect_socket(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path))
+        err_error("socket name %s is too long\n", path);
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        err_syserr("failed to connect to %s: ", path);
+    to_fd = from_fd = fd;
+}
+
+/* Start prog --server, talking to it through pipes */
+static void start_server(const char *prog)
+{
+    int req[2];
+    int rsp[2];
+    if (pipe(req) != 0 || pipe(rsp) != 0)
+        err_syserr("failed to create pipes: ");
+    pid_t pid = fork();
+    if (pid < 0)
+        err_syserr("failed to fork: ");
+    if (pid == 0)
+    {
+        dup2(req[0], STDIN_FILENO);
+        dup2(rsp[1], STDOUT_FILENO);
+        close(req[0]);
+        close(req[1]);
+        close(rsp[0]);
+        close(rsp[1]);
+        execlp(prog, prog, "--server", (char *)0);
+        err_syserr("failed to execute %s: ", prog);
+    }
+    close(req[0]);
+    close(rsp[1]);
+    to_fd = req[1];
+    from_fd = rsp[0];
+}
+
+/* The request for a file, with its length prefix */
+static void make_request(const char *file, Buffer *rq)
+{
+    Buffer body = { 0, 0, 0 };
+    bool is_stdin = (strcmp(file, "-") == 0);
+
+    if (flags[1] != '\0' || qrep != 0 || srep != 0)
+    {
+        buf_str(&body, "options");
+        if (flags[1] != '\0')
+        {
+            buf_str(&body, " ");
+            buf_str(&body, flags);
+        }
+        if (qrep != 0)
+        {
+            buf_str(&body, " -q ");
+            buf_str(&body, qrep);
+        }
+        if (srep != 0)
+        {
+            buf_str(&body, " -s ");
+            buf_str(&body, srep);
+        }
+        buf_str(&body, "\n");
+    }
+    if (std != 0)
+    {
+        buf_str(&body, "std ");
+        buf_str(&body, std);
+        buf_str(&body, "\n");
+    }
+    buf_str(&body, "name ");
+    buf_str(&body, is_stdin ? "(standard input)" : file);
+    buf_str(&body, "\n");
+    if (!send_content && !is_stdin)
+    {
+        /* The server may have another working directory */
+        char *path = realpath(file, 0);
+        buf_str(&body, "path ");
+        buf_str(&body, (path != 0) ? path : file);
+        buf_str(&body, "\n\n");
+        free(path);
+    }
+    else
+    {
+        int fd = is_stdin ? STDIN_FILENO : open(file, O_RDONLY);
+        if (fd < 0)
+            err_syserr("failed to open file %s: ", file);
+        buf_str(&body, "\n");
+        read_all(fd, file, &body);
+        if (!is_stdin)
+            close(fd);
+    }
+
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "%zu\n", body.len);
+    rq->len = 0;
+    buf_str(rq, prefix);
+    buf_add(rq, body.data, body.len);
+    free(body.data);
+}
+
+static void send_request(const Buffer *rq)
+{
+    const char *data = rq->data;
+    size_t len = rq->len;
+    while (len > 0)
+    {
+        ssize_t nbytes = write(to_fd, data, len);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+            err_syserr("failed to send request: ");
+        data += nbytes;
+        len -= (size_t)nbytes;
+    }
+}
+
+/* Read exactly len bytes into buffer */
+static void read_exact(char *buffer, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t nbytes = read(from_fd, buffer, len);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+            err_syserr("failed to read response: ");
+        if (nbytes == 0)
+            err_error("server closed the connection\n");
+        buffer += nbytes;
+        len -= (size_t)nbytes;
+    }
+}
+
+/* Value of header name in the response header hdr, or null */
+static const char *header_value(const char *hdr, const char *name)
+{
+    size_t len = strlen(name);
+    for (const char *line = hdr; *line != '\0'; line = strchr(line, '\n') + 1)
+    {
+        if (strncmp(line, name, len) == 0 && line[len] == ' ')
+            return line + len + 1;
+    }
+    return 0;
+}
+
+static void receive_response(Buffer *buf, Response *rp)
+{
+    char digit;
+    size_t len = 0;
+    int ndigits = 0;
+
+    for (;;)
+    {
+        read_exact(&digit, 1);
+        if (digit == '\n' && ndigits > 0)
+            break;
+        if (digit < '0' || digit > '9' || ++ndigits > 10)
+            err_error("malformed response from server\n");
+        len = len * 10 + (size_t)(digit - '0');
+    }
+    if (len + 1 > buf->size)
+    {
+        char *new_data = realloc(buf->data, len + 1);
+        if (new_data == 0)
+            err_syserr("failed to allocate %zu bytes of memory: ", len + 1);
+        buf->data = new_data;
+        buf->size = len + 1;
+    }
+    read_exact(buf->data, len);
+    buf->data[len] = '\0';
+    buf->len = len;
+
+    char *end = strstr(buf->data, "\n\n");
+    if (end == 0)
+        err_error("malformed response from server\n");
+    end[1] = '\0';
+    const char *status = header_value(buf->data, "status");
+    const char *out = header_value(buf->data, "output");
+    const char *warn = header_value(buf->data, "warnings");
+    if (status == 0 || out == 0 || warn == 0)
+        err_error("malformed response from server\n");
+    rp->error = 0;
+    if (strncmp(status, "error ", 6) == 0)
+    {
+        char *msg = buf->data + (status - buf->data) + 6;
+        *strchr(msg, '\n') = '\0';
+        rp->error = msg;
+    }
+    rp->out_len = strtoul(out, 0, 10);
+    rp->warn_len = strtoul(warn, 0, 10);
+    rp->out = end + 2;
+    rp->warn = rp->out + rp->out_len;
+    if ((size_t)(rp->warn + rp->warn_len - buf->data) != len)
+        err_error("malformed response from server\n");
+}
+
+/* Strip the file, writing the output and warnings; false if the server failed */
+static bool strip_file(const char *file, Buffer *rq, Buffer *rsp)
+{
+    Response r;
+    make_request(file, rq);
+    send_request(rq);
+    receive_response(rsp, &r);
+    if (r.error != 0)
+    {
+        err_remark("%s: %s\n", file, r.error);
+        return false;
+    }
+    /* Warnings follow the output that preceded them, as nearly as can be told */
+    fflush(stdout);
+    if (fwrite(r.out, sizeof(char), r.out_len, stdout) != r.out_len)
+        err_syserr("failed to write output: ");
+    fflush(stdout);
+    for (const char *w = r.warn; w < r.warn + r.warn_len; )
+    {
+        const char *nl = memchr(w, '\n', (size_t)(r.warn + r.warn_len - w));
+        int len = (nl != 0) ? (int)(nl - w) : (int)(r.warn + r.warn_len - w);
+        err_remark("%.*s\n", len, w);
+        w += len + 1;
+    }
+    return true;
+}
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *v1, const void *v2)
+{
+    double d1 = *(const double *)v1;
+    double d2 = *(const double *)v2;
+    return (d1 > d2) - (d1 < d2);
+}
+
+static void report(const char *file, const char *how, double *times, size_t n)
+{
+    qsort(times, n, sizeof(*times), cmp_double);
+    printf("%-28s %-8s %10.1f %10.1f %10.1f %10.1f\n", file, how, times[0],
+           times[n / 2], times[n * 9 / 10], times[n * 99 / 100]);
+}
+
+/* Run prog with the options on file, discarding the output */
+static void run_program(const char *prog, const char *file)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+        err_syserr("failed to fork: ");
+    if (pid == 0)
+    {
+        const char *args[12];
+        int n = 0;
+        int fd = open("/dev/null", O_WRONLY);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        args[n++] = prog;
+        if (flags[1] != '\0')
+            args[n++] = flags;
+        if (qrep != 0)
+        {
+            args[n++] = "-q";
+            args[n++] = qrep;
+        }
+        if (srep != 0)
+        {
+            args[n++] = "-s";
+            args[n++] = srep;
+        }
+        if (std != 0)
+        {
+            args[n++] = "-S";
+            args[n++] = std;
+        }
+        args[n++] = file;
+        args[n] = 0;
+        execvp(prog, (char **)args);
+        _exit(127);
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+}
+
+/* Time n round trips for each file, then n runs of the program */
+static void latency(const char *prog, char **files, int nfiles, size_t n)
+{
+    double *times = malloc(n * sizeof(*times));
+    Buffer rq = { 0, 0, 0 };
+    Buffer rsp = { 0, 0, 0 };
+    Response r;
+
+    if (times == 0)
+        err_syserr("failed to allocate memory for %zu times: ", n);
+    printf("%-28s %-8s %10s %10s %10s %10s\n", "File", "Method", "Min us", "Median", "90%", "99%");
+    for (int i = 0; i < nfiles; i++)
+    {
+        make_request(files[i], &rq);
+        for (size_t j = 0; j < n; j++)
+        {
+            double start = now_us();
+            send_request(&rq);
+            receive_response(&rsp, &r);
+            times[j] = now_us() - start;
+            if (r.error != 0)
+                err_error("%s: %s\n", files[i], r.error);
+        }
+        report(files[i], "server", times, n);
+        for (size_t j = 0; j < n; j++)
+        {
+            double start = now_us();
+            run_program(prog, files[i]);
+            times[j] = now_us() - start;
+        }
+        report(files[i], "process", times, n);
+    }
+    free(times);
+    free(rq.data);
+    free(rsp.data);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    const char *socket_path = 0;
+    const char *prog = "scc";
+    size_t nlatency = 0;
+    size_t nflags = 1;
+
+    err_setarg0(argv[0]);
+    flags[0] = '-';
+    while ((opt = getopt(argc, argv, optstr)) != EOF)
+    {
+        switch (opt)
+        {
+        case 'C':
+            send_content = true;
+            break;
+        case 'c':
+        case 'e':
+        case 'n':
+        case 't':
+        case 'w':
+            if (strchr(flags, opt) == 0)
+                flags[nflags++] = (char)opt;
+            break;
+        case 'h':
+            err_help(usestr, hlpstr);
+            break;
+        case 'L':
+            if (atoi(optarg) <= 0)
+                err_error("invalid count %s\n", optarg);
+            nlatency = (size_t)atoi(optarg);
+            break;
+        case 'q':
+            qrep = optarg;
+            break;
+        case 's':
+            srep = optarg;
+            break;
+        case 'S':
+            std = optarg;
+            break;
+        case 'u':
+            socket_path = optarg;
+            break;
+        case 'x':
+            prog = optarg;
+            break;
+        default:
+            err_usage(usestr);
+            break;
+        }
+    }
+
+    if (socket_path != 0)
+        connect_socket(socket_path);
+    else
+        start_server(prog);
+
+    int status = 0;
+    if (nlatency > 0)
+    {
+        if (optind >= argc)
+            err_error("no files to time\n");
+        latency(prog, &argv[optind], argc - optind, nlatency);
+    }
+    else
+    {
+        Buffer rq = { 0, 0, 0 };
+        Buffer rsp = { 0, 0, 0 };
+        if (optind >= argc)
+            status = !strip_file("-", &rq, &rsp);
+        for (int i = optind; i < argc; i++)
+        {
+            if (!strip_file(argv[i], &rq, &rsp))
+                status = 1;
+        }
+        free(rq.data);
+        free(rsp.data);
+    }
+    close(to_fd);
+    if (from_fd != to_fd)
+        close(from_fd);
+    while (socket_path == 0 && wait(0) > 0)
+        ;
+    return status;
+}
@@ -0,0 +1,316 @@
+/*
+@(#)File:           $RCSfile: sccfuzz.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 23:30:00 $
+@(#)Purpose:        Fuzz target for the SCC library (libFuzzer)
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+*/
+
+/*TABSTOP=4*/
+
+/*
+**  LLVMFuzzerTestOneInput() strips each input three ways: whole with
+**  scc_strip(), streamed in small pieces, and in small chunks with
+**  scc_strip_parallel().  It aborts, so that the fuzzer keeps the input,
+**  if the outputs or warnings differ, or if any of them takes longer
+**  per byte than the bound: the lexer is linear in its input, so an
+**  input that is slow per byte shows a path that does more work than
+**  it should.  The bound is SCC_FUZZ_NS_PER_BYTE nanoseconds (default
+**  FUZZ_NS_PER_BYTE), only applied to inputs of FUZZ_MIN_TIMED bytes or
+**  more, and an input over it is timed again before it is believed.
+**
+**  The first three bytes of an input choose how it is stripped:
+**      byte 0: options -c, -e, -n, -t, -w, -q, -s and a source map
+**              (bits 0 to 7)
+**      byte 1: the standard (modulo the number of standards)
+**      byte 2: the size of the pieces streamed (1 + byte) and of the
+**              chunks (16 + 4 * byte)
+**
+**  Build with clang -fsanitize=fuzzer (make fuzz).  Built with
+**  -DFUZZ_MAIN instead, it is a program that runs the named files, or
+**  with -s each source file under a spread of options, through the
+**  same checks (make fuzz-check).
+*/
+
+#include "posixver.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "libscc.h"
+#include "stderr.h"
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_sccfuzz_c[];
+const char jlss_id_sccfuzz_c[] = "@(#)$Id: sccfuzz.c,v 1.1 2026/10/17 23:30:00 jleffler Exp $";
+#endif /* lint */
+
+enum { FUZZ_HEADER = 3 };               /* Bytes of options before the source */
+enum { FUZZ_MIN_TIMED = 1024 };         /* Shortest input checked against the bound */
+enum { FUZZ_NS_PER_BYTE = 1000 };       /* Default bound on the time per byte */
+
+typedef struct Result
+{
+    char   *data;
+    size_t  len;
+    size_t  size;
+} Result;
+
+/* Output and warnings of one way of stripping */
+typedef struct Strip
+{
+    Result  out;
+    Result  diag;
+} Strip;
+
+extern int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static double bound = 0.0;
+
+static void add(Result *rp, const char *str, size_t len)
+{
+    if (len > rp->size - rp->len)
+    {
+        size_t new_size = rp->size * 2 + len;
+        char *new_data = realloc(rp->data, new_size);
+        if (new_data == 0)
+        {
+            perror("sccfuzz: failed to allocate memory");
+            abort();
+        }
+        rp->data = new_data;
+        rp->size = new_size;
+    }
+    memcpy(rp->data + rp->len, str, len);
+    rp->len += len;
+}
+
+static int fuzz_write(void *data, const char *buffer, size_t len)
+{
+    add(&((Strip *)data)->out, buffer, len);
+    return 0;
+}
+
+static void fuzz_diag(void *data, const char *name, int line, const char *msg)
+{
+    char head[64];
+    int len = snprintf(head, sizeof(head), "%d: ", line);
+    (void)name;
+    add(&((Strip *)data)->diag, head, (size_t)len);
+    add(&((Strip *)data)->diag, msg, strlen(msg));
+    add(&((Strip *)data)->diag, "\n", 1);
+}
+
+static void fuzz_map(void *data, int out_line, size_t out_col, int in_line, size_t in_col)
+{
+    (void)data;
+    (void)out_line;
+    (void)out_col;
+    (void)in_line;
+    (void)in_col;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fail(const uint8_t *hdr, const char *fmt, ...) PRINTFLIKE(2, 3);
+
+static void fail(const uint8_t *hdr, const char *fmt, ...)
+{
+    va_list args;
+    fprintf(stderr, "sccfuzz: options 0x%.2X 0x%.2X 0x%.2X: ", hdr[0], hdr[1], hdr[2]);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    putc('\n', stderr);
+    abort();
+}
+
+/* Strip in[0..len-1] by the given way into sp; returns the time taken */
+static double strip_way(SCC_Scanner *sc, int way, const char *in, size_t len,
+                        const SCC_Sink *sink, size_t piece, size_t chunk, Strip *sp)
+{
+    int rc = 0;
+    sp->out.len = sp->diag.len = 0;
+    double start = now_ns();
+    if (way == 0)
+        rc = scc_strip(sc, "fuzz", in, len, sink);
+    else if (way == 1)
+    {
+        rc = scc_stream_begin(sc, "fuzz", sink);
+        for (size_t off = 0; rc == 0 && off < len; off += piece)
+            rc = scc_stream_write(sc, in + off, (len - off < piece) ? len - off : piece);
+        if (rc == 0)
+            rc = scc_stream_end(sc);
+    }
+    else
+        rc = scc_strip_parallel(sc, "fuzz", in, len, sink, 2, chunk);
+    double elapsed = now_ns() - start;
+    if (rc != 0)
+    {
+        perror("sccfuzz: failed to strip input");
+        abort();
+    }
+    return elapsed;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static const char *const ways[] = { "scc_strip()", "streaming", "scc_strip_parallel()" };
+    static int num_stds = 0;
+    static Strip strips[3];
+
+    if (size < FUZZ_HEADER)
+        return 0;
+    if (num_stds == 0)
+    {
+        while (scc_std_name(num_stds) != 0)
+            num_stds++;
+        const char *env = getenv("SCC_FUZZ_NS_PER_BYTE");
+        bound = (env != 0 && atof(env) > 0.0) ? atof(env) : FUZZ_NS_PER_BYTE;
+    }
+
+    SCC_Options opts;
+    scc_options_init(&opts);
+    opts.cflag = (data[0] & 0x01) != 0;
+    opts.eflag = (data[0] & 0x02) != 0;
+    opts.nflag = (data[0] & 0x04) != 0;
+    opts.tflag = (data[0] & 0x08) != 0;
+    opts.wflag = (data[0] & 0x10) != 0;
+    opts.qchar = (data[0] & 0x20) ? 'Q' : 0;
+    opts.schar = (data[0] & 0x40) ? 'S' : 0;
+    opts.std_code = data[1] % num_stds;
+    size_t piece = 1 + data[2];
+    size_t chunk = 16 + 4 * (size_t)data[2];
+    const char *in = (const char *)data + FUZZ_HEADER;
+    size_t len = size - FUZZ_HEADER;
+
+    SCC_Scanner *sc = scc_create(&opts);
+    if (sc == 0)
+    {
+        perror("sccfuzz: failed to create scanner");
+        abort();
+    }
+    for (int way = 0; way < 3; way++)
+    {
+        SCC_Sink sink = { .write = fuzz_write, .diag = fuzz_diag, .data = &strips[way] };
+        if (data[0] & 0x80)
+            sink.map = fuzz_map;
+        double ns = strip_way(sc, way, in, len, &sink, piece, chunk, &strips[way]);
+        if (len >= FUZZ_MIN_TIMED && ns / len > bound)
+        {
+            /* Measure again before believing it */
+            double again = strip_way(sc, way, in, len, &sink, piece, chunk, &strips[way]);
+            if (again < ns)
+                ns = again;
+            if (ns / len > bound)
+                fail(data, "%s took %.0f ns/byte", ways[way], ns / len);
+        }
+        if (way == 0)
+            continue;
+        if (strips[way].out.len != strips[0].out.len || (strips[0].out.len > 0 &&
+            memcmp(strips[way].out.data, strips[0].out.data, strips[0].out.len) != 0))
+            fail(data, "output of %s differs from scc_strip()", ways[way]);
+        if (strips[way].diag.len != strips[0].diag.len || (strips[0].diag.len > 0 &&
+            memcmp(strips[way].diag.data, strips[0].diag.data, strips[0].diag.len) != 0))
+            fail(data, "warnings of %s differ from scc_strip()", ways[way]);
+    }
+    scc_destroy(sc);
+    return 0;
+}
+
+#ifdef FUZZ_MAIN
+
+static const char optstr[] = "hs";
+static const char usestr[] = "[-hs] file ...";
+static const char hlpstr[] =
+    "  -h  Print this help and exit\n"
+    "  -s  The files are source files: run each under a spread of options\n"
+    "      (otherwise, each file is a fuzz input, options and source)\n"
+    ;
+
+/* Options tried on each source file with -s: each one, and some together */
+static const uint8_t spread[] = { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x8E, 0xE1 };
+
+static size_t read_file(const char *file, Result *rp)
+{
+    FILE *fp = fopen(file, "rb");
+    if (fp == 0)
+        err_syserr("failed to open file %s: ", file);
+    char buffer[BUFSIZ];
+    size_t nbytes;
+    while ((nbytes = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+        add(rp, buffer, nbytes);
+    if (ferror(fp))
+        err_syserr("failed to read file %s: ", file);
+    fclose(fp);
+    return rp->len;
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    bool sflag = false;
+
+    err_setarg0(argv[0]);
+    while ((opt = getopt(argc, argv, optstr)) != EOF)
+    {
+        switch (opt)
+        {
+        case 'h':
+            err_help(usestr, hlpstr);
+            break;
+        case 's':
+            sflag = true;
+            break;
+        default:
+            err_usage(usestr);
+            break;
+        }
+    }
+    if (optind == argc)
+        err_usage(usestr);
+
+    int runs = 0;
+    for (int i = optind; i < argc; i++)
+    {
+        Result input = { 0, 0, 0 };
+        if (sflag)
+            add(&input, "\0\0\0", FUZZ_HEADER);
+        read_file(argv[i], &input);
+        uint8_t *data = (uint8_t *)input.data;
+        fprintf(stderr, "%s\n", argv[i]);
+        if (!sflag)
+        {
+            LLVMFuzzerTestOneInput(data, input.len);
+            runs++;
+        }
+        for (size_t o = 0; sflag && o < sizeof(spread); o++)
+        {
+            /* Each standard in turn, with pieces and chunks of several sizes */
+            for (int std = 0; scc_std_name(std) != 0; std++)
+            {
+                data[0] = spread[o];
+                data[1] = (uint8_t)std;
+                data[2] = (uint8_t)((o * 37 + (size_t)std * 101) % 256);
+                LLVMFuzzerTestOneInput(data, input.len);
+                runs++;
+            }
+        }
+        free(input.data);
+    }
+    printf("== PASS == (%d runs within %.0f ns/byte, all ways alike)\n", runs, bound);
+    return 0;
+}
+
+#endif /* FUZZ_MAIN */
@@ -0,0 +1,584 @@
+/*
+@(#)File:           $RCSfile: sccserve.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 23:00:00 $
+@(#)Purpose:        Server mode of SCC (--server)
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+@(#)Product:        SCC Version 8.0.3 (2022-05-30)
+*/
+
+/*TABSTOP=4*/
+
+/*
+** A connection keeps its buffers and its scanners from one request to
+** the next, so a request costs little more than stripping its input:
+** the input read, the output and the warnings are collected in buffers
+** that only grow, and a scanner is kept for each of the last few sets
+** of options used (the standard is changed on the scanner as needed).
+** The response is sent with one writev() as soon as it is complete.
+*/
+
+#include "posixver.h"
+#include "sccserve.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+enum { SERVE_SCANNERS = 8 };    /* Scanners kept on a connection */
+enum { SERVE_READ = 64 * 1024 };    /* Least read from a connection at once */
+
+typedef struct Buffer
+{
+    char   *data;
+    size_t  len;
+    size_t  size;
+} Buffer;
+
+typedef struct Served
+{
+    SCC_Options     opts;       /* Options other than the standard */
+    SCC_Scanner    *sc;
+    unsigned long   used;       /* When last used */
+} Served;
+
+typedef struct Conn
+{
+    int             in_fd;
+    int             out_fd;
+    const SCC_Options *defaults;
+    Buffer          in;         /* Data read from in_fd */
+    size_t          in_pos;     /* Start of the data not yet handled */
+    Buffer          file;       /* Contents of a file named by a request */
+    Buffer          out;        /* Output of a request */
+    Buffer          warn;       /* Warnings of a request */
+    Served          scanners[SERVE_SCANNERS];
+    unsigned long   clock;
+} Conn;
+
+/* A request, parsed */
+typedef struct Request
+{
+    SCC_Options     opts;
+    const char     *path;       /* Null-terminated in the frame, or null */
+    const char     *name;
+    const char     *content;
+    size_t          content_len;
+} Request;
+
+typedef struct Session
+{
+    int             fd;
+    const SCC_Options *defaults;
+} Session;
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_sccserve_c[];
+const char jlss_id_sccserve_c[] = "@(#)$Id: sccserve.c,v 1.1 2026/10/17 23:00:00 jleffler Exp $";
+#endif /* lint */
+
+/* Make room for len more bytes; false with errno set if memory runs out */
+static bool buf_reserve(Buffer *bp, size_t len)
+{
+    if (len > bp->size - bp->len)
+    {
+        size_t new_size = bp->size * 2 + len;
+        char *new_data = realloc(bp->data, new_size);
+        if (new_data == 0)
+            return false;
+        bp->data = new_data;
+        bp->size = new_size;
+    }
+    return true;
+}
+
+static int conn_write(void *data, const char *buffer, size_t len)
+{
+    Buffer *bp = &((Conn *)data)->out;
+    if (!buf_reserve(bp, len))
+        return -1;
+    memcpy(bp->data + bp->len, buffer, len);
+    bp->len += len;
+    return 0;
+}
+
+/* A warning that does not fit in memory is dropped */
+static void conn_diag(void *data, const char *name, int line, const char *msg)
+{
+    Buffer *bp = &((Conn *)data)->warn;
+    int len = snprintf(0, 0, "%s:%d: %s\n", name, line, msg);
+    if (len > 0 && buf_reserve(bp, (size_t)len + 1))
+    {
+        snprintf(bp->data + bp->len, (size_t)len + 1, "%s:%d: %s\n", name, line, msg);
+        bp->len += (size_t)len;
+    }
+}
+
+/* Read a file into cp->file, whose length is set */
+static int read_file(Conn *cp, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    cp->file.len = 0;
+    for (;;)
+    {
+        if (!buf_reserve(&cp->file, SERVE_READ))
+        {
+            close(fd);
+            return -1;
+        }
+        ssize_t nbytes = read(fd, cp->file.data + cp->file.len, cp->file.size - cp->file.len);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+        {
+            int errnum = errno;
+            close(fd);
+            errno = errnum;
+            return -1;
+        }
+        if (nbytes == 0)
+            break;
+        cp->file.len += (size_t)nbytes;
+    }
+    close(fd);
+    return 0;
+}
+
+/* The next word of *str (separated by blanks), or null */
+static const char *next_word(char **str)
+{
+    char *s = *str + strspn(*str, " \t");
+    if (*s == '\0')
+        return 0;
+    char *end = s + strcspn(s, " \t");
+    if (*end != '\0')
+        *end++ = '\0';
+    *str = end;
+    return s;
+}
+
+/* Parse options like those of scc into opts; a message on failure */
+static const char *parse_options(char *str, SCC_Options *opts)
+{
+    int std_code = opts->std_code;
+    const char *word;
+
+    scc_options_init(opts);
+    opts->std_code = std_code;
+    while ((word = next_word(&str)) != 0)
+    {
+        if (word[0] != '-' || word[1] == '\0')
+            return "invalid option";
+        for (const char *p = word + 1; *p != '\0'; p++)
+        {
+            switch (*p)
+            {
+            case 'c':
+                opts->cflag = true;
+                break;
+            case 'e':
+                opts->eflag = true;
+                break;
+            case 'n':
+                opts->nflag = true;
+                break;
+            case 't':
+                opts->tflag = true;
+                break;
+            case 'w':
+                opts->wflag = true;
+                break;
+            case 'q':
+            case 's':
+            case 'S':
+                {
+                    /* The argument is the rest of the word, or the next word */
+                    const char *arg = (p[1] != '\0') ? p + 1 : next_word(&str);
+                    if (arg == 0)
+                        return "option requires an argument";
+                    if (*p == 'S')
+                    {
+                        if ((opts->std_code = scc_std_code(arg)) < 0)
+                            return "unrecognized standard";
+                    }
+                    else if (arg[1] != '\0')
+                        return "replacement must be a single character";
+                    else if (*p == 'q')
+                        opts->qchar = *arg;
+                    else
+                        opts->schar = *arg;
+                    p = arg + strlen(arg) - 1;
+                }
+                break;
+            default:
+                return "invalid option";
+            }
+        }
+    }
+    return 0;
+}
+
+/* Parse the header lines of a request (modified in place); a message on failure */
+static const char *parse_request(Conn *cp, char *frame, size_t len, Request *rq)
+{
+    char *end = frame + len;
+    char *line = frame;
+
+    *rq = (Request){ .opts = *cp->defaults };
+    for (;;)
+    {
+        char *nl = memchr(line, '\n', (size_t)(end - line));
+        if (nl == 0)
+            return "header not ended by an empty line";
+        *nl = '\0';
+        if (nl == line)
+        {
+            line = nl + 1;
+            break;
+        }
+        char *value = strchr(line, ' ');
+        if (value != 0)
+            *value++ = '\0';
+        else
+            value = nl;
+        if (strcmp(line, "options") == 0)
+        {
+            const char *msg = parse_options(value, &rq->opts);
+            if (msg != 0)
+                return msg;
+        }
+        else if (strcmp(line, "std") == 0)
+        {
+            if ((rq->opts.std_code = scc_std_code(value)) < 0)
+                return "unrecognized standard";
+        }
+        else if (strcmp(line, "path") == 0)
+            rq->path = value;
+        else if (strcmp(line, "name") == 0)
+            rq->name = value;
+        else
+            return "unrecognized header";
+        line = nl + 1;
+    }
+    rq->content = line;
+    rq->content_len = (size_t)(end - line);
+    if (rq->path != 0 && rq->content_len > 0)
+        return "both a path and content";
+    if (rq->name == 0)
+        rq->name = (rq->path != 0) ? rq->path : "(request)";
+    return 0;
+}
+
+static bool same_options(const SCC_Options *o1, const SCC_Options *o2)
+{
+    return o1->cflag == o2->cflag && o1->eflag == o2->eflag && o1->nflag == o2->nflag &&
+           o1->tflag == o2->tflag && o1->wflag == o2->wflag &&
+           o1->qchar == o2->qchar && o1->schar == o2->schar;
+}
+
+/* A scanner for the options, kept for later requests; null with errno set on failure */
+static SCC_Scanner *get_scanner(Conn *cp, const SCC_Options *opts)
+{
+    Served *sp = &cp->scanners[0];
+    for (size_t i = 0; i < SERVE_SCANNERS; i++)
+    {
+        Served *tp = &cp->scanners[i];
+        if (tp->sc != 0 && same_options(&tp->opts, opts))
+        {
+            sp = tp;
+            break;
+        }
+        /* Otherwise replace an unused or the least recently used scanner */
+        if (sp->sc != 0 && (tp->sc == 0 || tp->used < sp->used))
+            sp = tp;
+    }
+    if (sp->sc == 0 || !same_options(&sp->opts, opts))
+    {
+        scc_destroy(sp->sc);
+        sp->opts = *opts;
+        if ((sp->sc = scc_create(opts)) == 0)
+            return 0;
+    }
+    else if (scc_set_std(sp->sc, opts->std_code) != 0)
+        return 0;
+    sp->used = ++cp->clock;
+    return sp->sc;
+}
+
+static int write_all(int fd, struct iovec *iov, int n)
+{
+    while (n > 0)
+    {
+        ssize_t nbytes = writev(fd, iov, n);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+            return -1;
+        while (n > 0 && (size_t)nbytes >= iov->iov_len)
+        {
+            nbytes -= (ssize_t)iov->iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + nbytes;
+            iov->iov_len -= (size_t)nbytes;
+        }
+    }
+    return 0;
+}
+
+/* Send the response: the output and warnings collected, or an error */
+static int respond(Conn *cp, const char *error)
+{
+    char header[256];
+    char prefix[32];
+    size_t out_len = (error == 0) ? cp->out.len : 0;
+    size_t warn_len = (error == 0) ? cp->warn.len : 0;
+    int hlen;
+
+    if (error == 0)
+        hlen = snprintf(header, sizeof(header), "status ok\noutput %zu\nwarnings %zu\n\n",
+                        out_len, warn_len);
+    else
+        hlen = snprintf(header, sizeof(header), "status error %.160s\noutput 0\nwarnings 0\n\n",
+                        error);
+    int plen = snprintf(prefix, sizeof(prefix), "%zu\n", (size_t)hlen + out_len + warn_len);
+    struct iovec iov[4] =
+    {
+        { .iov_base = prefix, .iov_len = (size_t)plen },
+        { .iov_base = header, .iov_len = (size_t)hlen },
+        { .iov_base = cp->out.data, .iov_len = out_len },
+        { .iov_base = cp->warn.data, .iov_len = warn_len },
+    };
+    return write_all(cp->out_fd, iov, 4);
+}
+
+/* Strip the input of a request, and respond */
+static int handle(Conn *cp, char *frame, size_t len)
+{
+    Request rq;
+    const char *error = parse_request(cp, frame, len, &rq);
+    SCC_Scanner *sc = 0;
+
+    cp->out.len = 0;
+    cp->warn.len = 0;
+    if (error == 0 && (sc = get_scanner(cp, &rq.opts)) == 0)
+        error = strerror(errno);
+    if (error == 0 && rq.path != 0)
+    {
+        if (read_file(cp, rq.path) != 0)
+            error = strerror(errno);
+        else
+        {
+            rq.content = cp->file.data;
+            rq.content_len = cp->file.len;
+        }
+    }
+    if (error == 0)
+    {
+        SCC_Sink sink = { .write = conn_write, .diag = conn_diag, .data = cp, .flags = SCC_SINK_UNORDERED };
+        if (scc_strip(sc, rq.name, rq.content, rq.content_len, &sink) != 0)
+            error = strerror(errno);
+    }
+    return respond(cp, error);
+}
+
+/*
+** The next complete frame in cp->in, reading more as needed.  Returns
+** 1 with *frame and *len set, 0 at the end of the input, or -1 with
+** errno set.
+*/
+static int next_frame(Conn *cp, char **frame, size_t *len)
+{
+    for (;;)
+    {
+        char *data = cp->in.data + cp->in_pos;
+        size_t avail = cp->in.len - cp->in_pos;
+        char *nl = (avail > 0) ? memchr(data, '\n', avail) : 0;
+        if (nl != 0)
+        {
+            size_t flen = 0;
+            if (nl == data || (size_t)(nl - data) > 10)
+            {
+                errno = EPROTO;
+                return -1;
+            }
+            for (char *p = data; p < nl; p++)
+            {
+                if (*p < '0' || *p > '9')
+                {
+                    errno = EPROTO;
+                    return -1;
+                }
+                flen = flen * 10 + (size_t)(*p - '0');
+            }
+            if (flen > SERVE_FRAME_MAX)
+            {
+                errno = EPROTO;
+                return -1;
+            }
+            size_t need = (size_t)(nl + 1 - data) + flen;
+            if (avail >= need)
+            {
+                *frame = nl + 1;
+                *len = flen;
+                cp->in_pos += need;
+                return 1;
+            }
+        }
+        else if (avail > 11)
+        {
+            errno = EPROTO;
+            return -1;
+        }
+        /* Keep the partial frame at the start of the buffer, and read more */
+        if (avail > 0)
+            memmove(cp->in.data, data, avail);
+        cp->in.len = avail;
+        cp->in_pos = 0;
+        if (!buf_reserve(&cp->in, SERVE_READ))
+            return -1;
+        ssize_t nbytes = read(cp->in_fd, cp->in.data + cp->in.len, cp->in.size - cp->in.len);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes < 0)
+            return -1;
+        if (nbytes == 0)
+        {
+            if (avail == 0)
+                return 0;
+            errno = EPROTO;
+            return -1;
+        }
+        cp->in.len += (size_t)nbytes;
+    }
+}
+
+int serve_stream(int in_fd, int out_fd, const SCC_Options *defaults)
+{
+    Conn conn = { .in_fd = in_fd, .out_fd = out_fd, .defaults = defaults };
+    char *frame;
+    size_t len;
+    int rc;
+
+    while ((rc = next_frame(&conn, &frame, &len)) > 0)
+    {
+        if (handle(&conn, frame, len) != 0)
+        {
+            rc = -1;
+            break;
+        }
+    }
+    int errnum = errno;
+    for (size_t i = 0; i < SERVE_SCANNERS; i++)
+        scc_destroy(conn.scanners[i].sc);
+    free(conn.in.data);
+    free(conn.file.data);
+    free(conn.out.data);
+    free(conn.warn.data);
+    errno = errnum;
+    return (rc < 0) ? -1 : 0;
+}
+
+static void *serve_session(void *arg)
+{
+    Session session = *(Session *)arg;
+    free(arg);
+    serve_stream(session.fd, session.fd, session.defaults);
+    close(session.fd);
+    return 0;
+}
+
+/* Whether the socket at addr has no server listening on it */
+static bool stale_socket(const struct sockaddr_un *addr)
+{
+    struct stat st;
+    if (lstat(addr->sun_path, &st) != 0 || !S_ISSOCK(st.st_mode))
+        return false;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    bool stale = (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) != 0 &&
+                  errno == ECONNREFUSED);
+    close(fd);
+    return stale;
+}
+
+int serve_socket(const char *path, const SCC_Options *defaults)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    pthread_attr_t attr;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0)
+        return -1;
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        if (errno != EADDRINUSE || !stale_socket(&addr) || unlink(path) != 0 ||
+            bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            int errnum = errno;
+            close(lfd);
+            errno = errnum;
+            return -1;
+        }
+    }
+    if (listen(lfd, SOMAXCONN) != 0)
+    {
+        int errnum = errno;
+        close(lfd);
+        errno = errnum;
+        return -1;
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (;;)
+    {
+        int fd = accept(lfd, 0, 0);
+        if (fd < 0 && (errno == EINTR || errno == ECONNABORTED))
+            continue;
+        if (fd < 0)
+            break;
+        pthread_t thread;
+        Session *sp = malloc(sizeof(*sp));
+        if (sp == 0)
+        {
+            close(fd);
+            continue;
+        }
+        sp->fd = fd;
+        sp->defaults = defaults;
+        int rc = pthread_create(&thread, &attr, serve_session, sp);
+        if (rc != 0)
+        {
+            /* Serve it on this thread instead */
+            serve_session(sp);
+        }
+    }
+    int errnum = errno;
+    pthread_attr_destroy(&attr);
+    close(lfd);
+    errno = errnum;
+    return -1;
+}
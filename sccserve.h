@@ -0,0 +1,63 @@
+/*
+@(#)File:           $RCSfile: sccserve.h,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 23:00:00 $
+@(#)Purpose:        Server mode of SCC (--server)
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+@(#)Product:        SCC Version 8.0.3 (2022-05-30)
+*/
+
+/*TABSTOP=4*/
+
+#ifndef SCCSERVE_H_INCLUDED
+#define SCCSERVE_H_INCLUDED
+
+#ifdef MAIN_PROGRAM
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_sccserve_h[];
+const char jlss_id_sccserve_h[] = "@(#)$Id: sccserve.h,v 1.1 2026/10/17 23:00:00 jleffler Exp $";
+#endif /* lint */
+#endif /* MAIN_PROGRAM */
+
+#include "libscc.h"
+
+/*
+** The protocol.  Each message is a frame: its length in decimal, a
+** newline, and that many bytes.  A request is a frame holding header
+** lines, each a name, a space and a value, then an empty line and the
+** content to be stripped, if any:
+**
+**     options -n -q X      Options of scc (c, e, n, t, w, q rep, s rep,
+**                          S std); by default, those of the server
+**     std C++17            The standard; by default, the server's
+**     path /src/file.c     File to strip, read by the server
+**     name file.c          Name used in the warnings (default: the path,
+**                          or "(request)" for content)
+**
+** There must be a path or content, not both.  The response is a frame
+** holding the header lines "status ok" (or "status error" and a message),
+** "output n" and "warnings n", an empty line, the n bytes of output and
+** the n bytes of warnings, one per line in the form name:line: message.
+** Requests on a connection are answered in turn, each with a single
+** write as soon as it is stripped.
+*/
+
+enum { SERVE_FRAME_MAX = 1 << 30 };     /* Longest frame accepted */
+
+/*
+** Answer the requests read from in_fd on out_fd until the end of the
+** input.  Returns 0, or -1 with errno set if reading or writing fails
+** or a frame is malformed (EPROTO).
+*/
+extern int serve_stream(int in_fd, int out_fd, const SCC_Options *defaults);
+
+/*
+** Listen on the UNIX socket path, replacing a socket left by a server
+** that has gone, and serve each connection on a thread of its own.
+** Returns only on failure, with -1 and errno set.
+*/
+extern int serve_socket(const char *path, const SCC_Options *defaults);
+
+#endif /* SCCSERVE_H_INCLUDED */
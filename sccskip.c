@@ -0,0 +1,399 @@
+/*
+@(#)File:           $RCSfile: sccskip.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/16 23:20:00 $
+@(#)Purpose:        Fast-forward scanning of SCC input buffers
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+@(#)Product:        SCC Version 8.0.3 (2022-05-30)
+*/
+
+/*TABSTOP=4*/
+
+/*
+** Most of the bytes SCC reads are uninteresting: ordinary code,
+** comment text, or the body of a string.  These functions find the
+** next byte that matters 16, 32 or 64 bytes at a time.  SSE2 is the
+** baseline on x86; AVX2 and AVX-512BW are used when the CPU has them.
+** Other platforms use the scalar versions.
+*/
+
+#include "posixver.h"
+#include "sccskip.h"
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SKIP_X86
+#include <immintrin.h>
+#endif /* __GNUC__ && x86 */
+
+typedef struct SkipImpl
+{
+    const char  *name;
+    const char *(*code)(const char *ptr, const char *end);
+    const char *(*any3)(const char *ptr, const char *end, int c1, int c2, int c3);
+    size_t      (*count)(const char *ptr, const char *end);
+} SkipImpl;
+
+/* Chosen once, by whichever thread first needs it */
+static const SkipImpl *impl = 0;
+static pthread_once_t impl_once = PTHREAD_ONCE_INIT;
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_sccskip_c[];
+const char jlss_id_sccskip_c[] = "@(#)$Id: sccskip.c,v 1.1 2026/10/16 23:20:00 jleffler Exp $";
+#endif /* lint */
+
+const bool scc_skip_code_stop[UCHAR_MAX + 1] =
+{
+    ['/']  = true, ['"']  = true, ['\''] = true, ['\\'] = true,
+    ['*']  = true, ['.']  = true,
+    ['0']  = true, ['1']  = true, ['2']  = true, ['3']  = true,
+    ['4']  = true, ['5']  = true, ['6']  = true, ['7']  = true,
+    ['8']  = true, ['9']  = true,
+    ['L']  = true, ['R']  = true, ['U']  = true, ['u']  = true,
+};
+
+static const char *skip_code_scalar(const char *ptr, const char *end)
+{
+    while (ptr < end && !scc_skip_code_stop[(unsigned char)*ptr])
+        ptr++;
+    return ptr;
+}
+
+static const char *skip_any3_scalar(const char *ptr, const char *end, int c1, int c2, int c3)
+{
+    while (ptr < end && *ptr != c1 && *ptr != c2 && *ptr != c3)
+        ptr++;
+    return ptr;
+}
+
+static size_t count_newlines_scalar(const char *ptr, const char *end)
+{
+    size_t n = 0;
+    while (ptr < end)
+        n += (*ptr++ == '\n');
+    return n;
+}
+
+static const SkipImpl skip_scalar =
+{
+    "scalar", skip_code_scalar, skip_any3_scalar, count_newlines_scalar
+};
+
+#if defined(SKIP_X86)
+
+/*
+** Digits are detected as (unsigned)(c - '0') <= 9, using min_epu8
+** where there is no unsigned comparison; u and U are detected as
+** (c | 0x20) == 'u'.
+*/
+
+__attribute__((target("sse2")))
+static inline __m128i code_mask_sse2(__m128i v)
+{
+    __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8('/'));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('L')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('R')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+                                       _mm_set1_epi8('u')));
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d));
+    return m;
+}
+
+__attribute__((target("sse2")))
+static const char *skip_code_sse2(const char *ptr, const char *end)
+{
+    while (end - ptr >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)ptr);
+        unsigned mask = (unsigned)_mm_movemask_epi8(code_mask_sse2(v));
+        if (mask != 0)
+            return ptr + __builtin_ctz(mask);
+        ptr += 16;
+    }
+    return skip_code_scalar(ptr, end);
+}
+
+__attribute__((target("sse2")))
+static const char *skip_any3_sse2(const char *ptr, const char *end, int c1, int c2, int c3)
+{
+    __m128i v1 = _mm_set1_epi8((char)c1);
+    __m128i v2 = _mm_set1_epi8((char)c2);
+    __m128i v3 = _mm_set1_epi8((char)c3);
+    while (end - ptr >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)ptr);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, v1),
+                                              _mm_cmpeq_epi8(v, v2)),
+                                 _mm_cmpeq_epi8(v, v3));
+        unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        if (mask != 0)
+            return ptr + __builtin_ctz(mask);
+        ptr += 16;
+    }
+    return skip_any3_scalar(ptr, end, c1, c2, c3);
+}
+
+__attribute__((target("sse2")))
+static size_t count_newlines_sse2(const char *ptr, const char *end)
+{
+    size_t n = 0;
+    __m128i nl = _mm_set1_epi8('\n');
+    while (end - ptr >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)ptr);
+        n += (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+        ptr += 16;
+    }
+    return n + count_newlines_scalar(ptr, end);
+}
+
+static const SkipImpl skip_sse2 =
+{
+    "SSE2", skip_code_sse2, skip_any3_sse2, count_newlines_sse2
+};
+
+__attribute__((target("avx2")))
+static inline __m256i code_mask_avx2(__m256i v)
+{
+    __m256i m = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('L')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('R')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)),
+                                             _mm256_set1_epi8('u')));
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d));
+    return m;
+}
+
+__attribute__((target("avx2")))
+static const char *skip_code_avx2(const char *ptr, const char *end)
+{
+    while (end - ptr >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)ptr);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(code_mask_avx2(v));
+        if (mask != 0)
+            return ptr + __builtin_ctz(mask);
+        ptr += 32;
+    }
+    return skip_code_sse2(ptr, end);
+}
+
+__attribute__((target("avx2")))
+static const char *skip_any3_avx2(const char *ptr, const char *end, int c1, int c2, int c3)
+{
+    __m256i v1 = _mm256_set1_epi8((char)c1);
+    __m256i v2 = _mm256_set1_epi8((char)c2);
+    __m256i v3 = _mm256_set1_epi8((char)c3);
+    while (end - ptr >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)ptr);
+        __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, v1),
+                                                    _mm256_cmpeq_epi8(v, v2)),
+                                    _mm256_cmpeq_epi8(v, v3));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if (mask != 0)
+            return ptr + __builtin_ctz(mask);
+        ptr += 32;
+    }
+    return skip_any3_sse2(ptr, end, c1, c2, c3);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t count_newlines_avx2(const char *ptr, const char *end)
+{
+    size_t n = 0;
+    __m256i nl = _mm256_set1_epi8('\n');
+    while (end - ptr >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)ptr);
+        n += (size_t)__builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+        ptr += 32;
+    }
+    return n + count_newlines_sse2(ptr, end);
+}
+
+static const SkipImpl skip_avx2 =
+{
+    "AVX2", skip_code_avx2, skip_any3_avx2, count_newlines_avx2
+};
+
+__attribute__((target("avx512f,avx512bw")))
+static const char *skip_code_avx512(const char *ptr, const char *end)
+{
+    while (end - ptr >= 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)ptr);
+        __mmask64 m = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('/'));
+        m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"'));
+        m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\''));
+        m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\'));
+        m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('*'));
+        m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('.'));
+        m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('L'));
+        m |= _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('R'));
+        m |= _mm512_cmpeq_epi8_mask(_mm512_or_si512(v, _mm512_set1_epi8(0x20)),
+                                    _mm512_set1_epi8('u'));
+        m |= _mm512_cmplt_epu8_mask(_mm512_sub_epi8(v, _mm512_set1_epi8('0')),
+                                    _mm512_set1_epi8(10));
+        if (m != 0)
+            return ptr + __builtin_ctzll(m);
+        ptr += 64;
+    }
+    return skip_code_avx2(ptr, end);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static const char *skip_any3_avx512(const char *ptr, const char *end, int c1, int c2, int c3)
+{
+    __m512i v1 = _mm512_set1_epi8((char)c1);
+    __m512i v2 = _mm512_set1_epi8((char)c2);
+    __m512i v3 = _mm512_set1_epi8((char)c3);
+    while (end - ptr >= 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)ptr);
+        __mmask64 m = _mm512_cmpeq_epi8_mask(v, v1) |
+                      _mm512_cmpeq_epi8_mask(v, v2) |
+                      _mm512_cmpeq_epi8_mask(v, v3);
+        if (m != 0)
+            return ptr + __builtin_ctzll(m);
+        ptr += 64;
+    }
+    return skip_any3_avx2(ptr, end, c1, c2, c3);
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+static size_t count_newlines_avx512(const char *ptr, const char *end)
+{
+    size_t n = 0;
+    __m512i nl = _mm512_set1_epi8('\n');
+    while (end - ptr >= 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)ptr);
+        n += (size_t)__builtin_popcountll(_mm512_cmpeq_epi8_mask(v, nl));
+        ptr += 64;
+    }
+    return n + count_newlines_avx2(ptr, end);
+}
+
+static const SkipImpl skip_avx512 =
+{
+    "AVX-512", skip_code_avx512, skip_any3_avx512, count_newlines_avx512
+};
+
+#endif /* SKIP_X86 */
+
+static void skip_select(void)
+{
+    const SkipImpl *ip = &skip_scalar;
+#if defined(SKIP_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        ip = &skip_avx512;
+    else if (__builtin_cpu_supports("avx2"))
+        ip = &skip_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+        ip = &skip_sse2;
+#endif /* SKIP_X86 */
+    impl = ip;
+}
+
+const char *scc_skip_init(void)
+{
+    pthread_once(&impl_once, skip_select);
+    return impl->name;
+}
+
+const char *scc_skip_code(const char *ptr, const char *end)
+{
+    pthread_once(&impl_once, skip_select);
+    return (*impl->code)(ptr, end);
+}
+
+const char *scc_skip_any3(const char *ptr, const char *end, int c1, int c2, int c3)
+{
+    pthread_once(&impl_once, skip_select);
+    return (*impl->any3)(ptr, end, c1, c2, c3);
+}
+
+size_t scc_count_newlines(const char *ptr, const char *end)
+{
+    pthread_once(&impl_once, skip_select);
+    return (*impl->count)(ptr, end);
+}
+
+#ifdef TEST
+
+/*
+** Test program
+** -- checks every implementation the CPU supports against the scalar
+**    code, using random buffers of random lengths.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char alphabet[] = "abcXYZ_ \t\n/*\"'\\.09LRUu()";
+
+static int check_impl(const SkipImpl *ip)
+{
+    char buffer[300];
+    int fail = 0;
+
+    for (int i = 0; i < 100000; i++)
+    {
+        size_t len = (size_t)rand() % sizeof(buffer);
+        int density = rand() % 64 + 1;
+        for (size_t j = 0; j < len; j++)
+        {
+            if (rand() % density == 0)
+                buffer[j] = alphabet[rand() % (sizeof(alphabet) - 1)];
+            else
+                buffer[j] = (char)(rand() % 3 == 0 ? 'a' + rand() % 8 : rand() % 256);
+        }
+        size_t off = len > 0 ? (size_t)rand() % len : 0;
+        const char *ptr = buffer + off;
+        const char *end = buffer + len;
+        if ((*ip->code)(ptr, end) != skip_code_scalar(ptr, end) ||
+            (*ip->any3)(ptr, end, '*', '/', '\n') != skip_any3_scalar(ptr, end, '*', '/', '\n') ||
+            (*ip->count)(ptr, end) != count_newlines_scalar(ptr, end))
+        {
+            fail++;
+        }
+    }
+    printf("%s %s\n", (fail == 0) ? "== PASS ==" : "!! FAIL !!", ip->name);
+    return fail;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    printf("Selected: %s\n", scc_skip_init());
+    fail += check_impl(&skip_scalar);
+#if defined(SKIP_X86)
+    if (__builtin_cpu_supports("sse2"))
+        fail += check_impl(&skip_sse2);
+    if (__builtin_cpu_supports("avx2"))
+        fail += check_impl(&skip_avx2);
+    if (__builtin_cpu_supports("avx512bw"))
+        fail += check_impl(&skip_avx512);
+#endif /* SKIP_X86 */
+    return (fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif /* TEST */
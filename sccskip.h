@@ -0,0 +1,49 @@
+/*
+@(#)File:           $RCSfile: sccskip.h,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/16 23:20:00 $
+@(#)Purpose:        Fast-forward scanning of SCC input buffers
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+@(#)Product:        SCC Version 8.0.3 (2022-05-30)
+*/
+
+/*TABSTOP=4*/
+
+#ifndef SCCSKIP_H_INCLUDED
+#define SCCSKIP_H_INCLUDED
+
+#ifdef MAIN_PROGRAM
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_sccskip_h[];
+const char jlss_id_sccskip_h[] = "@(#)$Id: sccskip.h,v 1.1 2026/10/16 23:20:00 jleffler Exp $";
+#endif /* lint */
+#endif /* MAIN_PROGRAM */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Bytes that stop scc_skip_code(), indexed by unsigned char value */
+extern const bool scc_skip_code_stop[UCHAR_MAX + 1];
+
+/*
+** Each skip function returns a pointer to the first byte in the range
+** [ptr, end) that matters in the relevant lexical context, or end if
+** there is no such byte.  The implementation (scalar, SSE2, AVX2 or
+** AVX-512) is chosen on first use, or by calling scc_skip_init().
+**
+** scc_skip_code():   / " ' \ * . digits, and the prefix letters L R U u.
+** scc_skip_any3():   any of c1, c2, c3 (repeat a value for smaller sets).
+*/
+extern const char *scc_skip_code(const char *ptr, const char *end);
+extern const char *scc_skip_any3(const char *ptr, const char *end, int c1, int c2, int c3);
+
+/* Number of newlines in the range [ptr, end) */
+extern size_t scc_count_newlines(const char *ptr, const char *end);
+
+/* Select implementation; returns name of instruction set in use */
+extern const char *scc_skip_init(void);
+
+#endif /* SCCSKIP_H_INCLUDED */
@@ -26,6 +26,16 @@
 ** HAVE_GETTIMEOFDAY    - Define if gettimeofday() is available (microseconds)
 ** HAVE_SYSLOG_H        - Define if <syslog.h> is available
 ** HAVE_SYSLOG          - Define if syslog() is available
+**
+** Thread safety:
+** Each thread formats its messages in a buffer of its own, and each
+** message is written whole with a single write(2) (or passed whole to
+** syslog() or the sink), so messages from different threads are not
+** interleaved, without relying on the locking of stdio streams.
+** The time stamp is formatted by strftime() at most once a second in
+** each thread.  The settings (arg0, log options, time format, error
+** stream, file descriptor, syslog and sink) are shared by all threads,
+** and should be set before the threads that report errors start.
 */
 
 #include "posixver.h"
@@ -50,6 +60,15 @@ extern int getpid(void);
 #endif
 enum { MAX_MSGLEN = ERR_MAXMSGLEN };
 
+/* Storage that is separate in each thread, where that is possible */
+#if __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL  _Thread_local
+#elif defined(__GNUC__)
+#define THREAD_LOCAL  __thread
+#else
+#define THREAD_LOCAL  /* If only */
+#endif /* __STDC_VERSION__ || __GNUC__ */
+
 /* Find sub-second timing mechanism */
 #if defined(HAVE_CLOCK_GETTIME)
 /* Uses <time.h> */
@@ -89,7 +108,8 @@ enum { ERR_LOGOPTS = ERR_NOFLUSH | ERR_EXIT | ERR_ABORT | ERR_LOGTIME |
 static int   err_flags = 0;     /* Default error flags (ERR_STAMP, ERR_PID, etc) */
 
 /* Where do messages go?
-**  if   (defined USE_STDERR_SYSLOG && use_syslog != 0) ==> syslog
+**  if   (err_sink != 0)                     ==> caller-supplied sink
+**  elif (defined USE_STDERR_SYSLOG && use_syslog != 0) ==> syslog
 **  elif (err_fd >= 0)                       ==> file descriptor
 **  else                                     ==> file pointer
 */
@@ -100,6 +120,21 @@ static FILE *errout =  0;
 #ifdef USE_STDERR_FILEDESC
 static int   err_fd = -1;
 #endif /* USE_STDERR_FILEDESC */
+static ErrSink err_sink = 0;    /* Caller-supplied sink, used before all others */
+static void   *err_sink_data = 0;
+
+/* The message being formatted by this thread */
+static THREAD_LOCAL char err_msgbuf[MAX_MSGLEN];
+
+/* The time stamp of this thread, formatted for the second tm_sec */
+typedef struct TimeStamp
+{
+    time_t      tm_sec;
+    const char *tm_fmt;
+    size_t      tm_len;
+    char        tm_str[32];
+} TimeStamp;
+static THREAD_LOCAL TimeStamp err_stamp;
 
 /*
 ** err_???_print() functions are named systematically, and are all static.
@@ -164,6 +199,12 @@ const char *err_gettimeformat(void)
     return tm_format;
 }
 
+/* Current error output - without setting errout, which other threads may read */
+static FILE *err_output(void)
+{
+    return((errout != 0) ? errout : stderr);
+}
+
 /* Change the definition of 'stderr', reporting on the old one too */
 /* NB: using err_stderr((FILE *)0) simply reports the current 'stderr' */
 FILE *(err_stderr)(FILE *newerr)
@@ -192,6 +233,27 @@ int (err_use_fd)(int new_fd)
 }
 #endif /* USE_STDERR_FILEDESC */
 
+/*
+** Send messages to a sink supplied by the caller instead of any other
+** destination; a null sink restores the normal destinations.  The sink
+** is given each message whole, formatted as it would have been written,
+** with the flags it was reported with.  It may be called from several
+** threads at once, and must not report errors through these functions.
+*/
+void (err_setsink)(ErrSink sink, void *data)
+{
+    err_sink = sink;
+    err_sink_data = data;
+}
+
+/* Return the current sink (null if there is none) and its data */
+ErrSink (err_getsink)(void **data)
+{
+    if (data != 0)
+        *data = err_sink_data;
+    return(err_sink);
+}
+
 #if defined(USE_STDERR_SYSLOG)
 /*
 ** Configure the use of syslog
@@ -363,11 +425,24 @@ static Time now(void)
 
 /* Format a time string for now (using ISO8601 format by default) */
 /* The time format can be set via err_settimeformat() */
+/* The whole seconds are formatted again only when they change */
 static char *err_time(int flags, char *buffer, size_t buflen)
 {
     Time clk = now();
-    struct tm *tp = localtime(&clk.tv_sec);
-    size_t nb = strftime(buffer, buflen, tm_format, tp);
+    TimeStamp *ts = &err_stamp;
+    if (ts->tm_fmt != tm_format || ts->tm_sec != clk.tv_sec)
+    {
+        struct tm tm;
+        ts->tm_len = 0;
+        if (localtime_r(&clk.tv_sec, &tm) != 0)
+            ts->tm_len = strftime(ts->tm_str, sizeof(ts->tm_str), tm_format, &tm);
+        ts->tm_str[ts->tm_len] = '\0';
+        ts->tm_sec = clk.tv_sec;
+        ts->tm_fmt = tm_format;
+    }
+    size_t nb = (ts->tm_len < buflen) ? ts->tm_len : buflen - 1;
+    memcpy(buffer, ts->tm_str, nb);
+    buffer[nb] = '\0';
     if (flags & (ERR_NANO | ERR_MICRO | ERR_MILLI))
     {
         char subsec[12];
@@ -435,19 +510,72 @@ static size_t err_fmtmsg(char *buffer, size_t buflen, int flags, int errnum,
     return((size_t)(curpos - buffer));
 }
 
+/* Format a message - ellipsis */
+static size_t err_efmtmsg(char *buffer, size_t buflen, int flags, int errnum,
+                          const char *format, ...)
+{
+    va_list args;
+    size_t msglen;
+    va_start(args, format);
+    msglen = err_fmtmsg(buffer, buflen, flags, errnum, format, args);
+    va_end(args);
+    return(msglen);
+}
+
+/* Write a whole message to a file descriptor - one write() unless it is interrupted */
+static void err_write(int fd, const char *msgbuf, size_t msglen)
+{
+    while (msglen > 0)
+    {
+        ssize_t nbytes = write(fd, msgbuf, msglen);
+        if (nbytes < 0 && errno == EINTR)
+            continue;
+        if (nbytes <= 0)
+            break;
+        msgbuf += nbytes;
+        assert(nbytes > 0 && msglen >= (size_t)nbytes);
+        msglen -= (size_t)nbytes;
+    }
+}
+
 /*
 ** err_stdio - report error via stdio
-** Using fflush(fp) ensures that the message is flushed even if the
-** stream is fully buffered.
-** No longer need explicit flockfile() and funlockfile() because there's
-** only a single call to fwrite() and that must lock the stream anyway.
+** Anything already buffered on the stream is flushed, and the message
+** is written with write() on the file descriptor of the stream.  The
+** message is formatted before the lock on the stream is taken, and the
+** lock is held while it is written, so it is not split or interleaved
+** with those of other threads, even when it is too long to be written
+** to a pipe at once.  A stream without a file descriptor gets a single
+** fwrite() and fflush().
 */
-static void (err_stdio)(FILE *fp, int flags, int errnum, const char *format, va_list args)
+static void err_putmsg(FILE *fp, const char *buffer, size_t msglen)
 {
-    char buffer[MAX_MSGLEN];
-    size_t msglen = err_fmtmsg(buffer, sizeof(buffer), flags, errnum, format, args);
-    fwrite(buffer, sizeof(char), msglen, fp);
+    int fd = fileno(fp);
+    flockfile(fp);
     fflush(fp);
+    if (fd >= 0)
+        err_write(fd, buffer, msglen);
+    else
+    {
+        fwrite(buffer, sizeof(char), msglen, fp);
+        fflush(fp);
+    }
+    funlockfile(fp);
+}
+
+static void (err_stdio)(FILE *fp, int flags, int errnum, const char *format, va_list args)
+{
+    char *buffer = err_msgbuf;
+    size_t msglen = err_fmtmsg(buffer, sizeof(err_msgbuf), flags, errnum, format, args);
+    err_putmsg(fp, buffer, msglen);
+}
+
+/* err_sinkmsg() - report error via the caller's sink */
+static void (err_sinkmsg)(int flags, int errnum, const char *format, va_list args)
+{
+    char *buffer = err_msgbuf;
+    size_t msglen = err_fmtmsg(buffer, sizeof(err_msgbuf), flags, errnum, format, args);
+    (*err_sink)(err_sink_data, flags, buffer, msglen);
 }
 
 #if defined(USE_STDERR_SYSLOG)
@@ -459,10 +587,10 @@ static void (err_stdio)(FILE *fp, int flags, int errnum, const char *format, va_
 */
 static void (err_syslog)(int flags, int errnum, const char *format, va_list args)
 {
-    char buffer[MAX_MSGLEN];
+    char *buffer = err_msgbuf;
     int priority;
 
-    err_fmtmsg(buffer, sizeof(buffer), flags & ~(ERR_NOARG0|ERR_PID|ERR_LOGTIME),
+    err_fmtmsg(buffer, sizeof(err_msgbuf), flags & ~(ERR_NOARG0|ERR_PID|ERR_LOGTIME),
                errnum, format, args);
 
     if (flags & ERR_ABORT)
@@ -479,20 +607,9 @@ static void (err_syslog)(int flags, int errnum, const char *format, va_list args
 /* err_filedes() - report error via file descriptor */
 static void (err_filedes)(int fd, int flags, int errnum, const char *format, va_list args)
 {
-    char buffer[MAX_MSGLEN];
-    size_t msglen = err_fmtmsg(buffer, sizeof(buffer), flags, errnum, format, args);
-    ssize_t nbytes;
-    char *msgbuf = buffer;
-
-    while (msglen > 0)
-    {
-        nbytes = write(fd, msgbuf, msglen);
-        if (nbytes <= 0)
-            break;
-        msgbuf += nbytes;
-        assert(nbytes > 0 && msglen >= (size_t)nbytes);
-        msglen -= (size_t)nbytes;
-    }
+    char *buffer = err_msgbuf;
+    size_t msglen = err_fmtmsg(buffer, sizeof(err_msgbuf), flags, errnum, format, args);
+    err_write(fd, buffer, msglen);
 }
 #endif /* USE_STDERR_FILEDESC */
 
@@ -502,6 +619,9 @@ static void (err_vrf_print)(FILE *fp, int flags, int errnum, const char *format,
     if ((flags & ERR_NOFLUSH) == 0)
         fflush(0);
 
+    if (err_sink != 0)
+        err_sinkmsg(flags, errnum, format, args);
+    else
 #if defined(USE_STDERR_SYSLOG)
     if (use_syslog)
         err_syslog(flags, errnum, format, args);
@@ -553,9 +673,7 @@ void (err_logmsg)(FILE *fp, int flags, int estat, const char *format, ...)
 /* Print error message to current error output - no return */
 static NORETURN void (err_vxn_print)(int flags, int errnum, int estat, const char *format, va_list args)
 {
-    if (errout == 0)
-        errout = stderr;
-    err_vxf_print(errout, flags, errnum, estat, format, args);
+    err_vxf_print(err_output(), flags, errnum, estat, format, args);
 }
 
 /* Print error message to current error output - no return */
@@ -581,16 +699,12 @@ static void err_erf_print(FILE *fp, int flags, const char *format, ...)
 /* Print message using current error file - may return */
 void (err_print)(int flags, int estat, const char *format, va_list args)
 {
-    if (errout == 0)
-        errout = stderr;
-    err_vlogmsg(errout, flags, estat, format, args);
+    err_vlogmsg(err_output(), flags, estat, format, args);
 }
 
 static void err_vrn_print(int flags, int errnum, const char *format, va_list args)
 {
-    if (errout == 0)
-        errout = stderr;
-    err_vrf_print(errout, flags, errnum, format, args);
+    err_vrf_print(err_output(), flags, errnum, format, args);
 }
 
 /* Report warning including message from errno */
@@ -663,6 +777,73 @@ void (err_report)(int flags, int estat, const char *format, ...)
     va_end(args);
 }
 
+/*
+** Report several messages together - each line of lines is a message,
+** and gets the prefix (program name, time, pid) that flags call for.
+** They are written with a single write() (or given to the sink in one
+** call), so that a batch costs one system call and is not interleaved
+** with the messages of other threads.  With syslog, or if there is no
+** memory for the batch, each line is reported on its own.
+*/
+void (err_reportlines)(int flags, const char *lines, size_t len)
+{
+    FILE *fp = err_output();
+    char prefix[128];
+    size_t plen = err_efmtmsg(prefix, sizeof(prefix), flags & ~ERR_ERRNO, 0, "%s", "");
+    const char *end = lines + len;
+    size_t nlines = 0;
+    char *buffer;
+
+    for (const char *eol = lines; eol < end && (eol = memchr(eol, '\n', (size_t)(end - eol))) != 0; eol++)
+        nlines++;
+    if (len > 0 && end[-1] != '\n')
+        nlines++;
+#if defined(USE_STDERR_SYSLOG)
+    buffer = use_syslog ? 0 : malloc(len + nlines * plen);
+#else
+    buffer = malloc(len + nlines * plen);
+#endif /* USE_STDERR_SYSLOG */
+    if (buffer == 0)
+    {
+        for (const char *bol = lines; bol < end; )
+        {
+            const char *eol = memchr(bol, '\n', (size_t)(end - bol));
+            eol = (eol == 0) ? end : eol + 1;
+            err_erf_print(fp, flags & ~ERR_ERRNO, "%.*s", (int)(eol - bol), bol);
+            flags |= ERR_NOFLUSH;
+            bol = eol;
+        }
+    }
+    else
+    {
+        char *curpos = buffer;
+        for (const char *bol = lines; bol < end; )
+        {
+            const char *eol = memchr(bol, '\n', (size_t)(end - bol));
+            eol = (eol == 0) ? end : eol + 1;
+            memcpy(curpos, prefix, plen);
+            memcpy(curpos + plen, bol, (size_t)(eol - bol));
+            curpos += plen + (size_t)(eol - bol);
+            bol = eol;
+        }
+        size_t msglen = (size_t)(curpos - buffer);
+        if ((flags & ERR_NOFLUSH) == 0)
+            fflush(0);
+        if (err_sink != 0)
+            (*err_sink)(err_sink_data, flags, buffer, msglen);
+        else
+#if defined(USE_STDERR_FILEDESC)
+        if (err_fd >= 0)
+            err_write(err_fd, buffer, msglen);
+        else
+#endif /* USE_STDERR_FILEDESC */
+            err_putmsg(fp, buffer, msglen);
+        free(buffer);
+    }
+    if (flags & (ERR_ABORT|ERR_EXIT))
+        err_terminate(flags, ERR_STAT);
+}
+
 /* Format possibly multi-line usage message */
 void err_fmt_usage(size_t buflen, char *buffer, const char *s1)
 {
@@ -129,6 +129,7 @@ extern void err_print(int flags, int estat, const char *format, va_list args);
 extern void err_printversion(const char *program, const char *verinfo);
 extern void err_remark(const char *format, ...) PRINTFLIKE(1, 2);
 extern void err_report(int flags, int estat, const char *format, ...) PRINTFLIKE(3, 4);
+extern void err_reportlines(int flags, const char *lines, size_t len);
 extern void err_sysrem(const char *format, ...) PRINTFLIKE(1, 2);
 extern void err_sysremark(int errnum, const char *format, ...) PRINTFLIKE(2, 3);
 
@@ -139,6 +140,11 @@ extern int  err_setlogopts(int new_opts);   /* Set default log options */
 extern const char *err_settimeformat(const char *new_fmt);
 extern const char *err_gettimeformat(void);
 
+/* Messages sent to a sink supplied by the caller - a null sink turns it off */
+typedef void (*ErrSink)(void *data, int flags, const char *msg, size_t msglen);
+extern void    err_setsink(ErrSink sink, void *data);
+extern ErrSink err_getsink(void **data);
+
 /* Format a possibly multi-line usage message - mostly internal */
 extern void err_fmt_usage(size_t buflen, char *buffer, const char *s1);
 
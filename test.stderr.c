@@ -0,0 +1,166 @@
+/*
+@(#)File:           $RCSfile: test.stderr.c,v $
+@(#)Version:        $Revision: 1.1 $
+@(#)Last changed:   $Date: 2026/10/17 23:00:00 $
+@(#)Purpose:        Test the error reporting routines from several threads
+@(#)Author:         J Leffler
+@(#)Copyright:      (C) JLSS 2026
+*/
+
+/*TABSTOP=4*/
+
+/*
+**  Included by stderr.c when it is compiled with -DTEST.
+**
+**  Each of the threads reports its messages with err_remark(), each
+**  message padded to a different length, while the others do the same.
+**  Every message is one line, "thread t message m x...x end", which
+**  must arrive whole and in order for the thread: the test script
+**  checks the lines written to standard error, or, with -s, collected
+**  by a sink and written to standard output at the end.  With -b n,
+**  each thread reports its messages n at a time with err_reportlines().
+*/
+
+#include <pthread.h>
+
+#ifndef lint
+/* Prevent over-aggressive optimizers from eliminating ID string */
+extern const char jlss_id_test_stderr_c[];
+const char jlss_id_test_stderr_c[] = "@(#)$Id: test.stderr.c,v 1.1 2026/10/17 23:00:00 jleffler Exp $";
+#endif /* lint */
+
+enum { MAX_THREADS = 64 };
+enum { MAX_PADDING = 2000 };
+enum { MAX_BATCH = 16 };
+
+/* Messages collected by the sink */
+typedef struct Collect
+{
+    pthread_mutex_t lock;
+    char           *data;
+    size_t          len;
+    size_t          size;
+    size_t          num_msgs;
+} Collect;
+
+static int num_msgs = 1000;
+static int batch = 0;
+static char padding[MAX_PADDING];
+
+static void collect(void *data, int flags, const char *msg, size_t msglen)
+{
+    Collect *cp = data;
+    (void)flags;
+    pthread_mutex_lock(&cp->lock);
+    if (msglen > cp->size - cp->len)
+    {
+        size_t new_size = cp->size * 2 + msglen;
+        char *new_data = realloc(cp->data, new_size);
+        if (new_data == 0)
+        {
+            pthread_mutex_unlock(&cp->lock);
+            abort();
+        }
+        cp->data = new_data;
+        cp->size = new_size;
+    }
+    memcpy(cp->data + cp->len, msg, msglen);
+    cp->len += msglen;
+    for (size_t i = 0; i < msglen; i++)
+    {
+        if (msg[i] == '\n')
+            cp->num_msgs++;
+    }
+    pthread_mutex_unlock(&cp->lock);
+}
+
+static void *reporter(void *arg)
+{
+    int thread = *(int *)arg;
+    static THREAD_LOCAL char lines[MAX_BATCH * (MAX_PADDING + 64)];
+    size_t len = 0;
+    for (int i = 0; i < num_msgs; i++)
+    {
+        int pad = (int)(((unsigned)thread * 101 + (unsigned)i * 37) % MAX_PADDING);
+        if (batch == 0)
+            err_remark("thread %d message %d %.*s end\n", thread, i, pad, padding);
+        else
+        {
+            len += (size_t)snprintf(lines + len, sizeof(lines) - len,
+                                    "thread %d message %d %.*s end\n", thread, i, pad, padding);
+            if ((i + 1) % batch == 0 || i == num_msgs - 1)
+            {
+                err_reportlines(ERR_REM | err_getlogopts(), lines, len);
+                len = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+static const char optstr[] = "b:hln:st:";
+static const char usestr[] = "[-hls][-b batch][-n messages][-t threads]";
+
+int main(int argc, char **argv)
+{
+    int opt;
+    int num_threads = 8;
+    int sflag = 0;
+    Collect messages = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0 };
+
+    err_setarg0(argv[0]);
+    while ((opt = getopt(argc, argv, optstr)) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            batch = atoi(optarg);
+            break;
+        case 'l':
+            err_setlogopts(ERR_LOG | ERR_MILLI);
+            break;
+        case 'n':
+            num_msgs = atoi(optarg);
+            break;
+        case 's':
+            sflag = 1;
+            break;
+        case 't':
+            num_threads = atoi(optarg);
+            break;
+        default:
+            err_usage(usestr);
+            break;
+        }
+    }
+    if (optind != argc || num_msgs < 0 || num_threads < 1 || num_threads > MAX_THREADS ||
+        batch < 0 || batch > MAX_BATCH)
+        err_usage(usestr);
+
+    memset(padding, 'x', sizeof(padding));
+    if (sflag)
+        err_setsink(collect, &messages);
+
+    pthread_t threads[MAX_THREADS];
+    int numbers[MAX_THREADS];
+    for (int t = 0; t < num_threads; t++)
+    {
+        numbers[t] = t;
+        if (pthread_create(&threads[t], 0, reporter, &numbers[t]) != 0)
+            err_syserr("failed to create thread %d: ", t);
+    }
+    for (int t = 0; t < num_threads; t++)
+        pthread_join(threads[t], 0);
+
+    if (sflag)
+    {
+        void *data;
+        if (err_getsink(&data) != collect || data != &messages ||
+            messages.num_msgs != (size_t)num_threads * (size_t)num_msgs)
+            err_error("sink received %zu messages\n", messages.num_msgs);
+        err_setsink(0, 0);
+        fwrite(messages.data, sizeof(char), messages.len, stdout);
+        free(messages.data);
+    }
+    return 0;
+}